@@ -0,0 +1,312 @@
+#ifndef CAFFEINE_ADT_PERSISTENTSLOTMAP_H
+#define CAFFEINE_ADT_PERSISTENTSLOTMAP_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include <immer/vector.hpp>
+
+namespace caffeine {
+
+namespace detail {
+  inline uint64_t next_slot_map_owner() {
+    static std::atomic<uint64_t> counter{1};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+  }
+} // namespace detail
+
+/**
+ * A slot_map that can be copied in O(1).
+ *
+ * This has the same interface and key semantics as slot_map. The entries are
+ * stored in an immer::vector so copies share all of their entries. Each value
+ * is stored behind a shared_ptr and is only copied the first time it is
+ * accessed mutably after the map has been copied.
+ */
+template <typename T>
+class persistent_slot_map {
+  /**
+   * Implementation notes
+   * ====================
+   * The free list and generation counters work exactly as they do in
+   * slot_map.
+   *
+   * To support mutable access each map has an owner id and each entry records
+   * the owner id of the map that created its value. A map may modify a value
+   * in place if it is the owner of that value. Copying a map (in either
+   * direction) gives both the source and the copy fresh owner ids so that
+   * neither of them can modify the values that they now share. Values are
+   * then copied lazily on mutable access.
+   */
+private:
+  static constexpr size_t no_head = ~static_cast<size_t>(0);
+
+  struct entry {
+    std::shared_ptr<T> value;
+    size_t gen = 0;
+    size_t next = no_head;
+    uint64_t owner = 0;
+  };
+
+  immer::vector<entry> entries_;
+  size_t head_ = no_head;
+  mutable uint64_t owner_ = detail::next_slot_map_owner();
+
+public:
+  using key_type = std::pair<size_t, size_t>;
+  using value_type = T;
+
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  persistent_slot_map() = default;
+  persistent_slot_map(const persistent_slot_map& O)
+      : entries_(O.entries_), head_(O.head_) {
+    O.owner_ = detail::next_slot_map_owner();
+  }
+  persistent_slot_map(persistent_slot_map&& O) noexcept
+      : entries_(std::move(O.entries_)), head_(O.head_), owner_(O.owner_) {
+    O.entries_ = immer::vector<entry>();
+    O.head_ = no_head;
+    O.owner_ = detail::next_slot_map_owner();
+  }
+
+  persistent_slot_map& operator=(const persistent_slot_map& O) {
+    if (this == &O)
+      return *this;
+
+    entries_ = O.entries_;
+    head_ = O.head_;
+    owner_ = detail::next_slot_map_owner();
+    O.owner_ = detail::next_slot_map_owner();
+    return *this;
+  }
+  persistent_slot_map& operator=(persistent_slot_map&& O) noexcept {
+    if (this == &O)
+      return *this;
+
+    entries_ = std::move(O.entries_);
+    head_ = O.head_;
+    owner_ = O.owner_;
+    O.entries_ = immer::vector<entry>();
+    O.head_ = no_head;
+    O.owner_ = detail::next_slot_map_owner();
+    return *this;
+  }
+  ~persistent_slot_map() = default;
+
+  reference at(const key_type& key) {
+    auto [index, gen] = unpack_key(key);
+    if (index >= entries_.size())
+      throw std::out_of_range("at");
+
+    const entry& entry = entries_[index];
+    if (entry.gen != gen || !entry.value)
+      throw std::out_of_range("at");
+
+    return mutable_value(index);
+  }
+  const_reference at(const key_type& key) const {
+    auto [index, gen] = unpack_key(key);
+    if (index >= entries_.size())
+      throw std::out_of_range("at");
+
+    const entry& entry = entries_[index];
+    if (entry.gen != gen || !entry.value)
+      throw std::out_of_range("at");
+
+    return *entry.value;
+  }
+
+  reference operator[](const key_type& key) {
+    auto [index, gen] = unpack_key(key);
+
+    assert(entries_[index].gen == gen);
+    (void)gen;
+    return mutable_value(index);
+  }
+  const_reference operator[](const key_type& key) const {
+    auto [index, gen] = unpack_key(key);
+
+    const entry& entry = entries_[index];
+    assert(entry.gen == gen);
+    (void)gen;
+    return *entry.value;
+  }
+
+  void clear() {
+    entries_ = immer::vector<entry>();
+    head_ = no_head;
+  }
+
+  template <typename... Args>
+  key_type emplace(Args&&... args) {
+    auto value = std::make_shared<T>(std::forward<Args>(args)...);
+
+    if (head_ == no_head) {
+      size_t index = entries_.size();
+      entries_ = std::move(entries_).push_back(
+          entry{std::move(value), 0, no_head, owner_});
+      return pack_key(index, 0);
+    }
+
+    size_t index = head_;
+    entry updated = entries_[index];
+    assert(!updated.value);
+
+    head_ = updated.next;
+    updated.value = std::move(value);
+    updated.next = no_head;
+    updated.owner = owner_;
+    entries_ = std::move(entries_).set(index, updated);
+
+    return pack_key(index, updated.gen);
+  }
+
+  key_type insert(const T& value) {
+    return emplace(value);
+  }
+  key_type insert(T&& value) {
+    return emplace(std::move(value));
+  }
+
+  std::optional<T> remove(const key_type& key) {
+    auto [index, gen] = unpack_key(key);
+
+    if (index >= entries_.size())
+      return std::nullopt;
+
+    entry updated = entries_[index];
+    if (!updated.value || updated.gen != gen)
+      return std::nullopt;
+
+    std::optional<T> result;
+    if (updated.owner == owner_)
+      result.emplace(std::move(*updated.value));
+    else
+      result.emplace(*updated.value);
+
+    updated.value = nullptr;
+    updated.gen += 1;
+    updated.next = head_;
+    head_ = index;
+    entries_ = std::move(entries_).set(index, updated);
+
+    return result;
+  }
+
+  class const_iterator {
+  private:
+    const persistent_slot_map<T>* map;
+    size_t index;
+
+    friend class persistent_slot_map<T>;
+
+    const_iterator(const persistent_slot_map<T>* map, size_t index)
+        : map(map), index(index) {
+      skip_empty();
+    }
+
+    void skip_empty() {
+      while (index < map->entries_.size() && !map->entries_[index].value)
+        index += 1;
+    }
+
+  public:
+    using pointer = const T*;
+    using reference = const T&;
+    using value_type = T;
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+    const_iterator() = default;
+
+    /**
+     * Get the key for the current entry.
+     */
+    key_type key() const {
+      return pack_key(index, map->entries_[index].gen);
+    }
+
+    reference operator*() const {
+      return *map->entries_[index].value;
+    }
+    pointer operator->() const {
+      return map->entries_[index].value.get();
+    }
+
+    bool operator==(const const_iterator& o) const {
+      return index == o.index;
+    }
+    bool operator!=(const const_iterator& o) const {
+      return !(*this == o);
+    }
+
+    const_iterator& operator++() {
+      index += 1;
+      skip_empty();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto prev = *this;
+      ++*this;
+      return prev;
+    }
+  };
+
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(this, entries_.size());
+  }
+
+  const_iterator find(const key_type& key) const {
+    auto [index, gen] = unpack_key(key);
+
+    if (index >= entries_.size())
+      return end();
+
+    const entry& entry = entries_[index];
+    if (!entry.value || entry.gen != gen)
+      return end();
+
+    return const_iterator(this, index);
+  }
+
+private:
+  // Get a reference to the value at index that is safe to modify, copying it
+  // first if it may be shared with another map.
+  T& mutable_value(size_t index) {
+    const entry& current = entries_[index];
+    if (current.owner == owner_)
+      return *current.value;
+
+    entry updated = current;
+    updated.value = std::make_shared<T>(*current.value);
+    updated.owner = owner_;
+    entries_ = std::move(entries_).set(index, updated);
+
+    return *entries_[index].value;
+  }
+
+  static constexpr key_type pack_key(size_t index, size_t gen) {
+    return std::make_pair(index, gen);
+  }
+
+  static constexpr std::pair<size_t, size_t> unpack_key(const key_type& key) {
+    return key;
+  }
+};
+
+} // namespace caffeine
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <immer/vector.hpp>
+
+namespace caffeine {
+
+/**
+ * A union-find structure whose copies share storage.
+ *
+ * This has the same interface as UnionFind but is backed by an immer::vector
+ * so copying it is O(1). Path compression still happens when calling the
+ * non-const find but it only copies the parts of the vector that it touches.
+ */
+template <typename T = size_t>
+class PersistentUnionFind {
+public:
+  PersistentUnionFind() = default;
+
+  T make_set() {
+    T id = parents.size();
+    parents = std::move(parents).push_back(id);
+    return id;
+  }
+
+  size_t size() const {
+    return parents.size();
+  }
+
+  const T& parent(T query) const {
+    return parents.at(static_cast<size_t>(query));
+  }
+
+  T update(T current) {
+    while (true) {
+      T p = parent(current);
+
+      if (current == p)
+        break;
+
+      T gp = parent(p);
+      if (gp != p)
+        parents = std::move(parents).set(static_cast<size_t>(current), gp);
+      current = gp;
+    }
+
+    return current;
+  }
+
+  T find(T current) const {
+    while (current != parent(current)) {
+      current = parent(current);
+    }
+
+    return current;
+  }
+  T find(T current) {
+    return update(current);
+  }
+
+  T do_union(T root1, T root2) {
+    parents = std::move(parents).set(static_cast<size_t>(root2), root1);
+    return root1;
+  }
+
+#ifdef CAFFEINE_EXPOSE_FOR_TESTING
+public:
+#else
+private:
+#endif
+  immer::vector<T> parents;
+};
+
+} // namespace caffeine
@@ -1,8 +1,15 @@
 #pragma once
 
-#include "caffeine/ADT/UnionFind.h"
+#include "caffeine/ADT/PersistentUnionFind.h"
+#include "caffeine/IR/EGraphCost.h"
+#include "caffeine/IR/IntAnalysis.h"
 #include "caffeine/IR/OperationBase.h"
 #include "caffeine/Support/Hashing.h"
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <initializer_list>
+#include <memory>
 #include <tsl/hopscotch_map.h>
 #include <tsl/hopscotch_set.h>
 
@@ -13,7 +20,8 @@ class Operation;
 
 namespace ematching {
   class EMatcher;
-}
+  struct SaturationBudget;
+} // namespace ematching
 } // namespace caffeine
 
 CAFFEINE_DECL_LLVM_HASHER(caffeine::ENode);
@@ -24,7 +32,15 @@ namespace caffeine {
 class ENode {
 public:
   std::shared_ptr<OperationData> data;
-  llvm::SmallVector<size_t, 2> operands = {};
+  // E-class ids are stored as 32-bit integers to keep e-nodes (and thus
+  // e-classes, parent lists, and the hashcons) compact. EGraph::create_eclass
+  // checks that ids never exceed this.
+  llvm::SmallVector<uint32_t, 2> operands = {};
+
+  ENode() = default;
+  ENode(std::shared_ptr<OperationData> data,
+        std::initializer_list<size_t> operands = {});
+  ENode(std::shared_ptr<OperationData> data, llvm::ArrayRef<size_t> operands);
 
   bool operator==(const ENode& node) const;
   bool operator!=(const ENode& node) const;
@@ -51,13 +67,31 @@ public:
   void clear();
 };
 
+// An e-node which has an e-class as one of its operands, along with the e-class
+// that the e-node belongs to.
+struct EParent {
+  ENode node;
+  uint32_t eclass;
+
+  bool operator==(const EParent& parent) const;
+  bool operator!=(const EParent& parent) const;
+
+  friend llvm::hash_code hash_value(const EParent& parent);
+};
+
 class EClass {
 public:
   std::vector<ENode> nodes;
-  tsl::hopscotch_map<ENode, size_t> parents;
+  // All e-nodes that use this e-class as an operand. This is a flat list
+  // which may contain duplicate or non-canonical entries after merges. They
+  // are cleaned up the next time this e-class is repaired.
+  immer::flex_vector<EParent> parents;
   EClassCache cache;
   // Gives the index of the constant value
   std::optional<size_t> constant_index = std::nullopt;
+  // Known bits and range of the values of this e-class. This is only present
+  // for e-classes with an integer type.
+  std::optional<IntAnalysis> analysis = std::nullopt;
 
   EClass(std::vector<ENode>&& nodes);
 
@@ -94,9 +128,25 @@ public:
  * equivalent forms being inserted from being mapped to that e-class, but it
  * does prevent any additional simplifications from being made to a node that is
  * already constant.
+ *
+ * Copying an e-graph is O(1). All of the internal state is kept in persistent
+ * containers which are shared between copies and individual e-classes are
+ * only copied once one of the e-graphs sharing them goes to modify them.
+ *
+ * The operation data of every e-node within the e-graph is interned so that
+ * equal e-nodes always share the same data. The intern table is part of the
+ * e-graph and is copied along with it so no locking is needed. E-nodes passed
+ * in from outside may use any data; they are interned when they are added.
  */
 class EGraph {
 public:
+  EGraph();
+  EGraph(const EGraph& egraph);
+  EGraph(EGraph&& egraph) = default;
+
+  EGraph& operator=(const EGraph& egraph);
+  EGraph& operator=(EGraph&& egraph) = default;
+
   /**
    * Canonicalize an eclass id.
    */
@@ -146,13 +196,42 @@ public:
 
   // Simplify the e-graph using all the rewrite rules within matcher.
   //
-  // The implementation of the e-graph assumes that it keep being called
-  // repeatedly with the same EMatcher instance. Calling it with different
-  // EMatcher instances will likely result in some rewrites being missed.
+  // Only e-classes that have been added or modified since the last call are
+  // matched against the rewrite rules. This means that the implementation
+  // assumes that it keeps being called repeatedly with the same EMatcher
+  // instance. Calling it with different EMatcher instances will likely result
+  // in some rewrites being missed.
   void simplify(const ematching::EMatcher& matcher);
+  void simplify(const ematching::EMatcher& matcher,
+                const ematching::SaturationBudget& budget);
 
   void constprop();
 
+  // Change the cost model used to pick which expression to extract from each
+  // e-class. This discards all cached extraction results. Copies of this
+  // e-graph share the same cost model.
+  void set_cost_model(std::shared_ptr<const ExtractionCostModel> model);
+
+  // The number of e-classes within the e-graph.
+  size_t size() const;
+
+  // Remove all e-classes that are not reachable from any of the roots.
+  //
+  // Ids are not renumbered so the ids of all the e-classes that are kept (along
+  // with any non-canonical ids that refer to them) remain valid. Ids of
+  // collected e-classes must not be used afterwards. Returns the number of
+  // e-classes that were removed.
+  size_t collect(llvm::ArrayRef<size_t> roots);
+
+  // Get the set of e-classes that have been added or modified since the last
+  // call to this method, and reset it.
+  //
+  // This includes everything that goes into the updated set used by simplify
+  // but, unlike that set, is not consumed by simplify. It is meant to allow
+  // results derived from the e-graph (e.g. extracted expressions) to be
+  // updated incrementally.
+  immer::set<size_t> take_changed();
+
   std::string DebugString() const;
   void DebugPrint() const;
 
@@ -165,12 +244,70 @@ private:
 
   size_t create_eclass(const ENode& node);
 
+  // Replace the data of the e-node with the equivalent interned data, adding
+  // it to the intern table if it is not already there.
+  ENode intern(ENode node);
+  // Replace the data of the e-node with the equivalent interned data. Returns
+  // std::nullopt if there is no such data, in which case the e-node cannot be
+  // within the e-graph.
+  std::optional<ENode> find_interned(ENode node) const;
+
+  // Compute the analysis for an e-node from the current analyses of its
+  // operands.
+  std::optional<IntAnalysis> analyze(const ENode& node) const;
+
+  // Propagate changes in the analyses of the given e-classes to all the
+  // e-classes that use them.
+  void propagate_analysis(std::vector<size_t>&& stack);
+
+  // Record that an e-class has been added or modified.
+  void mark_updated(size_t eclass);
+
+  // Get a mutable reference to the e-class with the given canonical id,
+  // copying it first if it is shared with another e-graph.
+  EClass* get_mut(size_t id);
+
+  // Remove the e-class with the given canonical id and return its contents.
+  EClass take(size_t id);
+
 private:
-  UnionFind<size_t> union_find;
-  tsl::hopscotch_map<ENode, size_t, LLVMHasher> hashcons;
-  std::unordered_map<size_t, EClass> classes;
-  tsl::hopscotch_set<size_t> updated;
+  // An e-class along with the e-graph that is allowed to modify it in place.
+  // Any other e-graph must make its own copy before modifying it.
+  struct ClassEntry {
+    uint64_t owner;
+    std::shared_ptr<EClass> eclass;
+  };
+
+  // Hashes and compares operation data by value.
+  struct DataHasher {
+    size_t operator()(const std::shared_ptr<OperationData>& data) const;
+  };
+  struct DataEqual {
+    bool operator()(const std::shared_ptr<OperationData>& lhs,
+                    const std::shared_ptr<OperationData>& rhs) const;
+  };
+
+  // Hashes and compares e-nodes with interned data. Since equal data is always
+  // the same object these only need to look at the data pointer.
+  struct InternedHasher {
+    size_t operator()(const ENode& node) const;
+  };
+  struct InternedEqual {
+    bool operator()(const ENode& lhs, const ENode& rhs) const;
+  };
+
+  PersistentUnionFind<size_t> union_find;
+  immer::set<std::shared_ptr<OperationData>, DataHasher, DataEqual> interned;
+  immer::map<ENode, size_t, InternedHasher, InternedEqual> hashcons;
+  immer::map<size_t, ClassEntry> classes;
+  immer::set<size_t> updated;
+  immer::set<size_t> changed;
   std::vector<size_t> worklist;
+  std::shared_ptr<const ExtractionCostModel> cost_model;
+
+  // Copying an e-graph gives both the copy and the original a new owner tag
+  // so that neither will modify e-classes that they now share.
+  mutable uint64_t owner;
 
   friend class EGraphMatcher;
   friend class EGraphExtractor;
@@ -198,7 +335,6 @@ public:
 private:
   EClassCost eval_cost(size_t eclass_id);
   uint64_t eval_cost(const ENode& node);
-  uint64_t eval_cost(Operation::Opcode opcode);
 
   void update_cached(size_t eclass, const OpRef& expr);
   void update_cached(size_t eclass, EClassCost cost);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "caffeine/IR/OperationBase.h"
+#include "caffeine/IR/Type.h"
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace caffeine {
+
+/**
+ * Cost model used when extracting expressions out of an e-graph.
+ *
+ * For every e-class the extractor picks the e-node which minimizes the sum of
+ * its own cost and the costs of its operands. A cost model only has to give
+ * the cost of a single operation on its own.
+ */
+class ExtractionCostModel {
+public:
+  virtual ~ExtractionCostModel() = default;
+
+  // The cost of a single operation. bitwidth is the widest of the result and
+  // operand bitwidths (see type_bitwidth).
+  virtual uint64_t cost(Operation::Opcode opcode, uint32_t bitwidth) const = 0;
+
+  // The number of bits used to represent a value of the given type when
+  // computing costs, or 0 if it has no meaningful bitwidth.
+  static uint32_t type_bitwidth(const Type& type);
+
+  // The model used by e-graphs that haven't been given a different one.
+  static std::shared_ptr<const ExtractionCostModel> default_model();
+};
+
+/**
+ * Cost model which counts the number of operations in an expression.
+ *
+ * Symbolic constants are expensive so a large non-symbolic expression is
+ * always preferred over a symbolic constant.
+ */
+class UniformCostModel : public ExtractionCostModel {
+public:
+  uint64_t cost(Operation::Opcode opcode, uint32_t bitwidth) const override;
+};
+
+/**
+ * Cost model which approximates the time the solver spends on each operation.
+ *
+ * Each opcode has a base cost and a cost per bit of its bitwidth so that,
+ * e.g., a 64-bit multiplication is more expensive than a 64-bit addition
+ * which is in turn more expensive than an 8-bit addition. The default weights
+ * are hand-tuned. Better weights can be fitted to measured solver times by
+ * tools/cost-calibrate from a log written with caffeine --query-log.
+ *
+ * Symbolic constants always have the same fixed cost as in UniformCostModel.
+ * Their cost reflects that extraction should avoid them and not how long the
+ * solver takes to deal with them.
+ *
+ * Weights are stored as text with one opcode per line:
+ *
+ *   # comment
+ *   <opcode> <base> <per-bit>
+ *
+ * where <opcode> is the name of an Operation::Opcode (e.g. Mul or ICmpUlt) or
+ * "default" for the weight used by opcodes that aren't listed.
+ */
+class WeightedCostModel : public ExtractionCostModel {
+public:
+  struct Weight {
+    double base = 1.0;
+    double per_bit = 0.0;
+
+    bool operator==(const Weight& other) const;
+    bool operator!=(const Weight& other) const;
+  };
+
+  // Create a model with the default hand-tuned weights.
+  WeightedCostModel();
+
+  uint64_t cost(Operation::Opcode opcode, uint32_t bitwidth) const override;
+
+  const Weight& weight(Operation::Opcode opcode) const;
+  void set_weight(Operation::Opcode opcode, const Weight& weight);
+
+  const Weight& default_weight() const;
+  void set_default_weight(const Weight& weight);
+
+  // Parse a set of weights. Opcodes which are not listed keep their default
+  // hand-tuned weights. Returns std::nullopt and sets error if the input is
+  // malformed.
+  static std::optional<WeightedCostModel> load(std::istream& is,
+                                               std::string& error);
+  void save(std::ostream& os) const;
+
+  // The name of an opcode as used in weight files and query logs.
+  static std::string_view opcode_name(Operation::Opcode opcode);
+  static std::optional<Operation::Opcode> parse_opcode(std::string_view name);
+
+private:
+  std::unordered_map<Operation::Opcode, Weight> weights;
+  Weight fallback;
+};
+
+} // namespace caffeine
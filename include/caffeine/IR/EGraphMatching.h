@@ -2,6 +2,7 @@
 
 #include "caffeine/IR/OperationBase.h"
 #include "caffeine/Support/Hashing.h"
+#include <chrono>
 #include <functional>
 #include <optional>
 #include <unordered_map>
@@ -26,6 +27,24 @@ using EMatcherUpdater = std::function<void(ematching::GraphAccessor& egraph,
 
 namespace ematching {
 
+  // Limits on the amount of work done by a single call to EGraph::simplify.
+  //
+  // A limit of 0 means that there is no limit. When the budget is exhausted
+  // simplify returns early and any e-classes that have not yet been matched
+  // are matched during the next call instead.
+  struct SaturationBudget {
+    // Stop once at least this many e-classes have been added to the e-graph
+    // during this call.
+    size_t max_classes = 0;
+    // Maximum number of rounds of matching and rewriting.
+    size_t max_iterations = 0;
+    std::chrono::milliseconds max_time{0};
+
+    // The number of times simplify has stopped early due to its budget being
+    // exhausted, across all e-graphs.
+    static uint64_t exhausted_count();
+  };
+
   // A custom filter for a subclause for any other conditions beyond filtering
   // based on opcode.
   //
@@ -264,6 +283,13 @@ namespace ematching {
     // (load (store ?a ?b ?c) ?d) -> (select (icmp.eq ?b ?d) ?c (load ?a ?d))
     void load_store_elimination(EMatcherBuilder& builder);
 
+    // (loadN (storeN ?a ?b ?c) ?b) -> ?c
+    // (loadN (store ?a ?b ?c) ?d) -> (loadN ?a ?d) if the bytes don't overlap
+    void multi_load_store_elimination(EMatcherBuilder& builder);
+
+    // (load (storeN ?a ?b ?c) ?d) -> the stored byte at ?d or (load ?a ?d)
+    void load_multi_store_elimination(EMatcherBuilder& builder);
+
     void shift_elimination(EMatcherBuilder& builder);
   } // namespace reductions
 
@@ -274,12 +300,24 @@ namespace ematching {
     const Clause& clause(size_t clause) const;
     const SubClause& subclause(size_t subclause) const;
 
+    // Get the top-level subclauses that could match an e-node with the given
+    // opcode. Each subclause only appears once, even if it is the top-level
+    // subclause for multiple clauses.
+    llvm::ArrayRef<size_t> roots(Operation::Opcode opcode) const;
+
   private:
     std::vector<Clause> clauses;
     std::vector<SubClause> subclauses;
     std::vector<bool> captures;
 
-    std::unordered_map<Operation::Opcode, std::vector<size_t>> subindex;
+    // Dispatch table for the top-level subclauses of all clauses, keyed by
+    // opcode. Subclauses that match any opcode are included within every entry
+    // and are also kept separately for opcodes that have no entry. Together
+    // with the deduplication of subclauses this means that matching an e-node
+    // only looks at the rules that could apply to it, no matter how many rules
+    // there are.
+    std::unordered_map<Operation::Opcode, std::vector<size_t>> dispatch;
+    std::vector<size_t> wildcard_roots;
 
     friend class EMatcherBuilder;
     friend class caffeine::EGraphMatcher;
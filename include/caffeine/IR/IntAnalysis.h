@@ -0,0 +1,75 @@
+#pragma once
+
+#include "caffeine/IR/OperationBase.h"
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/ConstantRange.h>
+#include <optional>
+
+namespace caffeine {
+
+class ENode;
+
+/**
+ * Facts about the possible values of an integer-typed e-class.
+ *
+ * This tracks which bits are known to be zero or one in every possible value
+ * along with a range containing all possible values. The range is a wrapping
+ * range so it bounds both the unsigned and the signed interpretation of the
+ * value.
+ *
+ * The facts are derived purely from the structure of the expressions in an
+ * e-class so they hold on every path. They never take assertions into
+ * account.
+ */
+class IntAnalysis {
+public:
+  llvm::APInt known_zero;
+  llvm::APInt known_one;
+  llvm::ConstantRange range;
+
+  // Create an analysis that knows nothing about the value.
+  explicit IntAnalysis(uint32_t bitwidth);
+  // Create an analysis for a value that is exactly known.
+  explicit IntAnalysis(const llvm::APInt& value);
+
+  uint32_t bitwidth() const;
+
+  // The value of the e-class, if it can only have a single value.
+  std::optional<llvm::APInt> constant() const;
+
+  // Combine this with other facts about the same value. Returns whether this
+  // analysis became more precise.
+  //
+  // If the facts contradict each other (which can only happen for values that
+  // cannot exist, e.g. on infeasible paths) then this analysis is left as-is.
+  bool refine(const IntAnalysis& other);
+
+  // Compute the analysis for an e-node from the analyses of its operands.
+  //
+  // Operands that are not integers have a null analysis. Returns std::nullopt
+  // if the e-node does not have an integer type.
+  static std::optional<IntAnalysis>
+  evaluate(const ENode& node, llvm::ArrayRef<const IntAnalysis*> operands);
+
+  // Decide a comparison between two values. Returns std::nullopt if the
+  // analyses are not precise enough to tell what the result is.
+  static std::optional<bool> compare(Operation::Opcode opcode,
+                                     const IntAnalysis& lhs,
+                                     const IntAnalysis& rhs);
+
+  bool operator==(const IntAnalysis& other) const;
+  bool operator!=(const IntAnalysis& other) const;
+
+private:
+  IntAnalysis(const llvm::APInt& known_zero, const llvm::APInt& known_one,
+              const llvm::ConstantRange& range);
+
+  // Make the known bits and the range consistent with each other.
+  void normalize();
+
+  // Whether the known bits or the range show that no value is possible.
+  bool is_contradiction() const;
+};
+
+} // namespace caffeine
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <llvm/ADT/APInt.h>
+
+namespace caffeine {
+
+/**
+ * Whether the num_bytes bytes starting at offset and the store_bytes bytes
+ * starting at store_offset don't overlap.
+ *
+ * Offsets wrap around the same way as they do in the solver. Offsets with
+ * different bit widths are conservatively treated as overlapping.
+ */
+inline bool is_disjoint(const llvm::APInt& offset, uint64_t num_bytes,
+                        const llvm::APInt& store_offset, uint64_t store_bytes) {
+  if (offset.getBitWidth() != store_offset.getBitWidth())
+    return false;
+  return (offset - store_offset).uge(store_bytes) &&
+         (store_offset - offset).uge(num_bytes);
+}
+
+} // namespace caffeine
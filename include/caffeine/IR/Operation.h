@@ -402,6 +402,57 @@ public:
   static bool classof(const Operation* op);
 };
 
+/**
+ * Multi-byte memory load operation.
+ *
+ * This loads an integer made up of num_bytes() consecutive bytes starting at
+ * offset within a data array. It is equivalent to loading each byte
+ * individually and then combining them according to the byte order but keeps
+ * the expression (and the solver query) much smaller.
+ */
+class MultiLoadOp : public Operation {
+private:
+  MultiLoadOp(Type t, const OpRef& data, const OpRef& offset,
+              bool little_endian);
+
+public:
+  const OpRef& data() const;
+  const OpRef& offset() const;
+
+  bool is_little_endian() const;
+  uint32_t num_bytes() const;
+
+  static OpRef Create(Type t, const OpRef& data, const OpRef& offset,
+                      bool little_endian);
+
+  static bool classof(const Operation* op);
+};
+
+/**
+ * Multi-byte memory store operation.
+ *
+ * This writes the bytes of value into num_bytes() consecutive bytes starting
+ * at offset within a data array and yields the new array.
+ */
+class MultiStoreOp : public ArrayBase {
+private:
+  MultiStoreOp(const OpRef& data, const OpRef& offset, const OpRef& value,
+               bool little_endian);
+
+public:
+  const OpRef& data() const;
+  const OpRef& offset() const;
+  const OpRef& value() const;
+
+  bool is_little_endian() const;
+  uint32_t num_bytes() const;
+
+  static OpRef Create(const OpRef& data, const OpRef& offset,
+                      const OpRef& value, bool little_endian);
+
+  static bool classof(const Operation* op);
+};
+
 /**
  * Undefined value.
  *
@@ -38,6 +38,8 @@ static_assert(sizeof(FCmpOp) == sizeof(Operation));
 static_assert(sizeof(AllocOp) == sizeof(Operation));
 static_assert(sizeof(LoadOp) == sizeof(Operation));
 static_assert(sizeof(StoreOp) == sizeof(Operation));
+static_assert(sizeof(MultiLoadOp) == sizeof(Operation));
+static_assert(sizeof(MultiStoreOp) == sizeof(Operation));
 static_assert(sizeof(Undef) == sizeof(Operation));
 static_assert(sizeof(FixedArray) == sizeof(Operation));
 static_assert(sizeof(ConstantArray) == sizeof(Operation));
@@ -263,6 +265,48 @@ inline const OpRef& StoreOp::value() const {
   return operand_at(2);
 }
 
+/***************************************************
+ * MultiLoadOp                                     *
+ ***************************************************/
+inline const OpRef& MultiLoadOp::data() const {
+  return operand_at(0);
+}
+
+inline const OpRef& MultiLoadOp::offset() const {
+  return operand_at(1);
+}
+
+inline bool MultiLoadOp::is_little_endian() const {
+  return opcode() == LoadLE;
+}
+
+inline uint32_t MultiLoadOp::num_bytes() const {
+  return type().bitwidth() / 8;
+}
+
+/***************************************************
+ * MultiStoreOp                                    *
+ ***************************************************/
+inline const OpRef& MultiStoreOp::data() const {
+  return operand_at(0);
+}
+
+inline const OpRef& MultiStoreOp::offset() const {
+  return operand_at(1);
+}
+
+inline const OpRef& MultiStoreOp::value() const {
+  return operand_at(2);
+}
+
+inline bool MultiStoreOp::is_little_endian() const {
+  return opcode() == StoreLE;
+}
+
+inline uint32_t MultiStoreOp::num_bytes() const {
+  return value()->type().bitwidth() / 8;
+}
+
 /***************************************************
  * classof method function impls                   *
  ***************************************************/
@@ -302,9 +346,16 @@ inline bool FCmpOp::classof(const Operation* op) {
          op->opcode() <= detail::opcode(fcmp_base, 3, 0xF);
 }
 
+inline bool MultiLoadOp::classof(const Operation* op) {
+  return op->opcode() == LoadLE || op->opcode() == LoadBE;
+}
+inline bool MultiStoreOp::classof(const Operation* op) {
+  return op->opcode() == StoreLE || op->opcode() == StoreBE;
+}
+
 inline bool ArrayBase::classof(const Operation* op) {
   return op->opcode() == Alloc || op->opcode() == Store ||
-         op->opcode() == FixedArray;
+         op->opcode() == FixedArray || MultiStoreOp::classof(op);
 }
 
 #undef CAFFEINE_OP_DECL_CLASSOF
@@ -16,6 +16,18 @@ private:
   using BaseType = OpVisitor<OperationSimplifier, OpRef>;
 
 public:
+  /**
+   * Chains of at least min_snapshot_depth stores at concrete offsets on top of
+   * an array with at most max_snapshot_size elements are collapsed into a
+   * FixedArray.
+   *
+   * Shorter chains are left alone. Elements of the snapshot that were not
+   * written by the chain become loads from the array below it, and the solver
+   * has to constrain each of them individually.
+   */
+  static constexpr uint64_t min_snapshot_depth = 64;
+  static constexpr uint64_t max_snapshot_size = 1024;
+
   OpRef visit(Operation& op);
 
   OpRef visitOperation(Operation& op);
@@ -57,6 +69,8 @@ public:
   OpRef visitAllocOp(AllocOp& op);
   OpRef visitLoadOp(LoadOp& op);
   OpRef visitStoreOp(StoreOp& op);
+  OpRef visitMultiLoadOp(MultiLoadOp& op);
+  OpRef visitMultiStoreOp(MultiStoreOp& op);
 
   OpRef visitFixedArray(FixedArray& op);
 
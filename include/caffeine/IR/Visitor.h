@@ -98,6 +98,8 @@ public:
   RetTy visitAllocOp (transform_t<AllocOp> & O) { return CAFFEINE_OP_DELEGATE(ArrayBase); }
   RetTy visitStoreOp (transform_t<StoreOp> & O) { return CAFFEINE_OP_DELEGATE(ArrayBase); }
   RetTy visitLoadOp  (transform_t<LoadOp>  & O) { return CAFFEINE_OP_DELEGATE(Operation); }
+  RetTy visitMultiStoreOp(transform_t<MultiStoreOp>& O) { return CAFFEINE_OP_DELEGATE(ArrayBase); }
+  RetTy visitMultiLoadOp (transform_t<MultiLoadOp> & O) { return CAFFEINE_OP_DELEGATE(Operation); }
 
   RetTy visitFCmpOp  (transform_t<FCmpOp>  & O) { return CAFFEINE_OP_DELEGATE(BinaryOp); }
   RetTy visitICmpOp  (transform_t<ICmpOp>  & O) { return CAFFEINE_OP_DELEGATE(BinaryOp); }
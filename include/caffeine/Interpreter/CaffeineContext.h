@@ -1,6 +1,7 @@
 #pragma once
 
 #include "caffeine/ADT/StringMap.h"
+#include "caffeine/IR/EGraphMatching.h"
 #include "caffeine/Interpreter/TypeidDb.h"
 #include <llvm/IR/Intrinsics.h>
 #include <memory>
@@ -15,10 +16,6 @@ class SolverBuilder;
 class FailureLogger;
 class CoverageTracker;
 
-namespace ematching {
-  class EMatcher;
-}
-
 /**
  * @brief Options controlling various behaviours of the caffeine interpreter.
  *
@@ -44,6 +41,27 @@ struct CaffeineOptions {
    */
   uint64_t malloc_alignment = 16;
 
+  /**
+   * @brief Limits on the work done when simplifying the e-graph before each
+   * solver query.
+   *
+   * Work that doesn't fit within the budget is deferred to the next query
+   * instead of being dropped. There is no time limit by default since that
+   * would make runs nondeterministic.
+   */
+  ematching::SaturationBudget saturation_budget = {
+      1 << 20, 32, std::chrono::milliseconds(0)};
+
+  /**
+   * @brief How much the e-graph of a context may grow before unreachable
+   * e-classes are garbage collected.
+   *
+   * A collection happens once the e-graph has more than this many times the
+   * number of e-classes that were live after the previous collection. Setting
+   * this to 0 disables garbage collection.
+   */
+  double egraph_gc_growth_factor = 2.0;
+
   CaffeineOptions() = default;
 };
 
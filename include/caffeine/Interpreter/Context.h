@@ -16,6 +16,7 @@
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 namespace llvm {
 class GlobalVariable;
@@ -39,6 +40,28 @@ public:
 private:
   uint64_t constant_num_ = 0;
 
+  // The number of e-classes that were left after the last garbage collection.
+  size_t egraph_live_ = 0;
+
+  // The model from the most recent SAT solver result along this path. Queries
+  // that this model already satisfies are answered without invoking the
+  // solver. It is shared (not copied) between forks.
+  //
+  // Forks may be picked up by other worker threads so this is always a copy
+  // of the solver's model that doesn't depend on the solver that produced it.
+  std::shared_ptr<const Model> model_;
+
+  // The result of the last call to extract_assertions along with the e-class
+  // ids that it was extracted from. This allows later calls to only extract
+  // the assertions that have been added since then. It is shared between
+  // forks and copied before being modified if any other context holds it.
+  struct ExtractedAssertions {
+    std::vector<size_t> ids;
+    size_t proven = 0;
+    AssertionList list;
+  };
+  std::shared_ptr<ExtractedAssertions> extracted_;
+
 public:
   Context(llvm::Function* func);
   // Create a context for a function and provide initial values for it's
@@ -133,12 +156,52 @@ public:
    */
   void print_backtrace(std::ostream& OS) const;
 
+  /**
+   * Extract all the assertions in this context from the e-graph.
+   *
+   * The non-const version reuses the extracted assertions from the previous
+   * call as long as none of the e-classes they were extracted from have been
+   * modified since.
+   */
   AssertionList extract_assertions();
   AssertionList extract_assertions() const;
 
+  /**
+   * Remove all e-classes from the e-graph that are no longer reachable from
+   * any value held by this context.
+   *
+   * The values considered are the assertions, the variables within each stack
+   * frame, the globals, the address, size, and data of every allocation, and
+   * the named constants. E-class ids held by these remain valid afterwards.
+   * Nothing is collected while there is an external frame on the stack since
+   * external frames may hold values that aren't visible here.
+   *
+   * If growth_factor is nonzero then this only collects once the e-graph has
+   * grown to more than growth_factor times the number of e-classes that were
+   * live after the previous collection. Returns the number of e-classes that
+   * were removed.
+   */
+  size_t collect_garbage(double growth_factor = 0.0);
+
+  /**
+   * Get the model from the most recent SAT solver result on this path, if
+   * there is one.
+   */
+  const std::shared_ptr<const Model>& last_model() const {
+    return model_;
+  }
+
 private:
   void init_args(llvm::ArrayRef<OpRef> args);
 
+  // Whether the last model satisfies all of the assertions and extra.
+  bool model_satisfies(const AssertionList& assertions,
+                       const Assertion& extra) const;
+
+  // The value of a boolean e-class, if the e-graph analysis has been able to
+  // determine it.
+  std::optional<bool> known_value(size_t eclass_id) const;
+
   // TODO: Temporary until context redesign is completed
   friend class ExprEvaluator;
 };
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "caffeine/ADT/FunctionView.h"
 #include "caffeine/IR/OperationBase.h"
+#include "caffeine/Memory/PagedArray.h"
 #include "caffeine/Support/UnsupportedOperation.h"
+#include <optional>
 
 namespace caffeine {
 
@@ -57,6 +60,10 @@ public:
  * Any of address, size, or data may be either concrete, symbolic, or, for data,
  * some combination of the two.
  *
+ * When the size of the allocation is concrete, its data is kept in a
+ * PagedArray so that accesses at concrete offsets don't need to build array
+ * expressions.
+ *
  * See the docs for MemHeap for the invariants that are asserted for a new
  * allocation and the procedure that is used for resolving a pointer to an
  * allocation.
@@ -66,6 +73,9 @@ private:
   OpRef address_;
   OpRef size_;
   OpRef data_;
+  // The contents of the allocation. If present, this takes the place of
+  // data_.
+  std::optional<PagedArray> pages_;
 
   AllocationKind kind_;
   AllocationPermissions perms_;
@@ -84,8 +94,16 @@ public:
   AllocationPermissions permissions() const;
   void permissions(AllocationPermissions new_perm);
 
-  const OpRef& data() const;
-  OpRef& data();
+  /**
+   * Get an array expression for the contents of this allocation.
+   */
+  OpRef data() const;
+
+  /**
+   * Call the visitor for all the expressions that make up the contents of
+   * this allocation without building the full array expression.
+   */
+  void visit_data(function_view<void(const OpRef&)> visitor) const;
 
   const OpRef& address() const;
   OpRef& address();
@@ -135,7 +153,45 @@ public:
   void write(const OpRef& offset, llvm::Type* type, const LLVMValue& value,
              const MultiHeap& heap, const llvm::DataLayout& layout);
 
+  /**
+   * Copy len bytes from src at src_offset into this allocation at offset.
+   *
+   * All the bytes are read before any of them are written so src may be this
+   * allocation, even if the two ranges overlap. When both offsets are
+   * concrete this copies directly between the pages of the two allocations
+   * without building any array expressions.
+   *
+   * Does not assert that either range is inbounds. Callers of this method
+   * should add the assertions first.
+   */
+  void copy(const OpRef& offset, const Allocation& src,
+            const OpRef& src_offset, uint64_t len);
+
+  /**
+   * Set len bytes starting at offset to byte, which must be an i8.
+   *
+   * Does not assert that the range is inbounds. Callers of this method should
+   * add the assertion first.
+   */
+  void fill(const OpRef& offset, const OpRef& byte, uint64_t len);
+
   void DebugPrint() const;
+
+private:
+  // The offset of an access as an integer, if the access is at a concrete
+  // offset and entirely within the paged data of this allocation.
+  std::optional<uint64_t> paged_offset(const OpRef& offset,
+                                       uint64_t width) const;
+
+  // Read or write an integer made up of width bytes directly from the pages
+  // of this allocation. These return null/false if the access is not at a
+  // concrete offset, in which case the caller needs to fall back to using
+  // the array expression. load_bytes also returns null if some of the bytes
+  // are symbolic and don't make up a single previously stored value.
+  OpRef load_bytes(const OpRef& offset, uint32_t width,
+                   bool little_endian) const;
+  bool store_bytes(const OpRef& offset, const OpRef& value,
+                   bool little_endian);
 };
 
 inline bool operator!(AllocationPermissions perm) {
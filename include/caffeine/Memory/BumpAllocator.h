@@ -1,10 +1,10 @@
 #pragma once
 
 #include "caffeine/Memory/Heap.h"
+#include <immer/set.hpp>
 #include <llvm/ADT/APInt.h>
 #include <llvm/ADT/Hashing.h>
 #include <optional>
-#include <unordered_set>
 
 namespace caffeine {
 class BumpAllocator : public ConcreteAllocator {
@@ -15,7 +15,9 @@ private:
     }
   };
 
-  std::unordered_set<llvm::APInt, llvm_hash> allocations;
+  // This is a persistent set so that copying the allocator along with the
+  // rest of the heap is cheap.
+  immer::set<llvm::APInt, llvm_hash> allocations;
   llvm::APInt current;
 
   llvm::APInt base;
@@ -1,15 +1,19 @@
 #ifndef CAFFEINE_MEMORY_MEMHEAP_H
 #define CAFFEINE_MEMORY_MEMHEAP_H
 
-#include "caffeine/ADT/SlotMap.h"
+#include "caffeine/ADT/PersistentSlotMap.h"
 #include "caffeine/IR/Operation.h"
 #include "caffeine/Memory/Allocator.h"
 #include "caffeine/Memory/BumpAllocator.h"
 #include "caffeine/Support/UnsupportedOperation.h"
 #include <climits>
+#include <immer/flex_vector.hpp>
+#include <immer/set.hpp>
 #include <llvm/ADT/APInt.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
 #include <llvm/IR/DataLayout.h>
+#include <optional>
 #include <vector>
 
 #include "caffeine/Memory/Allocation.h"
@@ -29,9 +33,38 @@ class MemHeap {
 private:
   enum { Symbolic, Init, Uninit };
 
-  slot_map<Allocation> allocs_;
+  // An allocation with a concrete address and size. The end address is
+  // exclusive.
+  struct IndexEntry {
+    llvm::APInt start;
+    llvm::APInt end;
+    AllocId alloc;
+  };
+
+  struct AllocIdHash {
+    size_t operator()(const AllocId& id) const {
+      return llvm::hash_combine(id.first, id.second);
+    }
+  };
+
+  // All of the heap state is stored in persistent containers so that copying
+  // a heap (and thus forking a context) does not need to copy every live
+  // allocation. Allocations are only copied once they are modified.
+  persistent_slot_map<Allocation> allocs_;
+  // Allocations with a concrete address and size, sorted by start address.
+  // Live allocations never overlap so this is sorted by end address as well.
+  immer::flex_vector<IndexEntry> addr_index_;
+  // Allocations that could not be placed in addr_index_.
+  immer::set<AllocId, AllocIdHash> unindexed_;
+  // Allocations whose address is not disjoint from those of all other
+  // allocations by construction. Every new allocation needs explicit
+  // non-overlap assertions against these.
+  immer::set<AllocId, AllocIdHash> overlapping_;
   unsigned index_;
   std::variant<std::monostate, BumpAllocator, std::monostate> allocator_;
+  // The id of the next free symbolic address region. Region ids are never
+  // reused so that pointers to freed allocations never alias new ones.
+  uint64_t next_region_ = 1;
 
 public:
   MemHeap(unsigned index, bool concrete = true);
@@ -41,11 +74,25 @@ public:
   Allocation& operator[](const AllocId& alloc);
   const Allocation& operator[](const AllocId& alloc) const;
 
+  /**
+   * Iterate over all the live allocations within this heap.
+   */
+  persistent_slot_map<Allocation>::const_iterator begin() const;
+  persistent_slot_map<Allocation>::const_iterator end() const;
+
   /**
    * Creates a new allocation that has a distinct address from all currently
    * live allocations.
    *
    * This will add the corresponding assertions to the context as well.
+   *
+   * Allocations are placed, in order of preference, at a concrete address in
+   * the upper half of the address space, or at a symbolic offset within their
+   * own region of the lower half of the address space. Both of these are
+   * disjoint from every other allocation by construction. If the heap runs
+   * out of regions, or the size might not fit within a region, then the
+   * address becomes fully symbolic and the new allocation is asserted to not
+   * overlap any of the existing ones.
    */
   AllocId allocate(const OpRef& size, const OpRef& alignment, const OpRef& data,
                    AllocationKind kind, AllocationPermissions permissions,
@@ -76,6 +123,15 @@ public:
   Assertion check_valid(const Pointer& value, uint32_t width);
   Assertion check_valid(const Pointer& value, const OpRef& width);
 
+  /**
+   * Same as check_valid above except that the assertion only mentions the
+   * allocations that the pointer could point to according to the value range
+   * the e-graph within ctx has computed for it. This keeps the assertion small
+   * when there are many allocations with concrete addresses.
+   */
+  Assertion check_valid(const Pointer& value, const OpRef& width,
+                        Context& ctx);
+
   /**
    * Get an assertion that checks whether the provided pointer points to the
    * start of any existing allocation.
@@ -98,7 +154,9 @@ public:
    *
    * # Cost
    * Unless the pointer has already been resolved to an allocation, this method
-   * requires a solver call for every possible allocation. Furthermore, it is
+   * requires a solver call for every possible allocation. Allocations with
+   * concrete addresses are only considered if they overlap the range of values
+   * that the e-graph analysis allows for the pointer. Furthermore, it is
    * likely to require that the interpreter fork for every returned allocation.
    * If at all possible, it is recommended to try and avoid needing to call this
    * method when an already known allocation can be preserved across multiple
@@ -113,7 +171,47 @@ public:
 private:
   BuddyAllocator* allocator();
 
-  OpRef alloc_addr(const OpRef& size, const OpRef& align, Context& ctx);
+  /**
+   * Attempt to allocate a concrete address for a new allocation.
+   *
+   * This only succeeds if the size and alignment are known constants and the
+   * concrete allocator has not yet run out of space.
+   */
+  std::optional<OpRef> concrete_addr(const OpRef& size, const OpRef& align,
+                                     Context& ctx);
+
+  /**
+   * Attempt to allocate a new region for a symbolic allocation and return an
+   * address within it.
+   *
+   * Regions divide up the lower half of the address space. The address is a
+   * symbolic offset from the region base and the assertions needed to keep
+   * the allocation within the region are added to the context.
+   *
+   * A quarter of the pointer bits select the region so each region covers
+   * 2^47 bytes with 64-bit pointers but only 8 MiB with 32-bit pointers.
+   * Returns std::nullopt if there are no regions left or if the size is not
+   * known to fit within a region on every path.
+   */
+  std::optional<OpRef> region_addr(const OpRef& size, Context& ctx);
+
+#ifdef CAFFEINE_EXPOSE_FOR_TESTING
+public:
+#else
+private:
+#endif
+  /**
+   * Get the allocations that a pointer with the given absolute value could
+   * point within such that there are at least width bytes remaining in the
+   * allocation.
+   *
+   * Allocations with a concrete address are filtered using the range of
+   * possible values of the pointer so this is only a superset of the
+   * allocations that the solver would accept.
+   */
+  llvm::SmallVector<AllocId, 4> candidates(const OpRef& value,
+                                           const OpRef& width,
+                                           Context& ctx) const;
 };
 
 class MemHeapMgr {
@@ -150,6 +248,12 @@ public:
   MemHeap& function_heap();
   const MemHeap& function_heap() const;
 
+  /**
+   * Iterate over all the heaps that have been created so far.
+   */
+  llvm::SmallDenseMap<unsigned, MemHeap>::const_iterator begin() const;
+  llvm::SmallDenseMap<unsigned, MemHeap>::const_iterator end() const;
+
   /**
    * Get the allocation that this pointer corresponds to.
    *
@@ -160,6 +264,8 @@ public:
 
   Assertion check_valid(const Pointer& value, uint32_t width);
   Assertion check_valid(const Pointer& value, const OpRef& width);
+  Assertion check_valid(const Pointer& value, const OpRef& width,
+                        Context& ctx);
   Assertion check_starts_allocation(const Pointer& value);
 
   llvm::SmallVector<Pointer, 1> resolve(std::shared_ptr<Solver> solver,
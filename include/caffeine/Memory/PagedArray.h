@@ -0,0 +1,125 @@
+#pragma once
+
+#include "caffeine/ADT/FunctionView.h"
+#include "caffeine/IR/OperationBase.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace caffeine {
+
+/**
+ * The backing store for the data of an allocation with a concrete size.
+ *
+ * Representing the contents of an allocation as a single array expression
+ * means that every write wraps the whole array in another store and every
+ * read has to walk back down that chain of stores. Instead, this keeps the
+ * bytes written at concrete offsets in fixed-size pages on top of a base
+ * array expression. Each page holds the concrete value of every byte within
+ * it along with an expression for the bytes that are symbolic.
+ *
+ * Pages are shared between copies of a PagedArray (e.g. when a context is
+ * forked) and are only copied when one of the copies writes to them.
+ *
+ * The full array expression is only built when it is actually needed, for
+ * instance to read from or write to a symbolic offset. Writes to a symbolic
+ * offset fold all the pages back into the base array.
+ */
+class PagedArray {
+public:
+  static constexpr uint64_t PageSize = 256;
+
+  /**
+   * Create a paged array on top of an existing array expression with the
+   * given (concrete) number of bytes.
+   */
+  PagedArray(const OpRef& base, uint64_t size);
+
+  uint64_t size() const;
+
+  /**
+   * Read the byte at a concrete offset. The offset must be in bounds.
+   */
+  OpRef load(uint64_t offset) const;
+
+  /**
+   * Read the byte at a concrete offset if its value is concrete. The offset
+   * must be in bounds.
+   */
+  std::optional<uint8_t> load_concrete(uint64_t offset) const;
+
+  /**
+   * Write a byte at a concrete offset. The offset must be in bounds and the
+   * byte must be an i8 expression.
+   */
+  void store(uint64_t offset, const OpRef& byte);
+
+  /**
+   * Copy len bytes from src starting at src_offset into this array starting
+   * at offset. Both ranges must be in bounds.
+   *
+   * All the bytes are read before any of them are written so src may be this
+   * array, even if the ranges overlap. Whole pages that line up between the
+   * two arrays are shared instead of being copied.
+   */
+  void copy(uint64_t offset, const PagedArray& src, uint64_t src_offset,
+            uint64_t len);
+
+  /**
+   * Set len bytes starting at offset to byte. The range must be in bounds
+   * and the byte must be an i8 expression.
+   */
+  void fill(uint64_t offset, uint64_t len, const OpRef& byte);
+
+  /**
+   * Get an array expression with the current contents of this array.
+   *
+   * This is a chain of stores on top of the base array for the bytes that
+   * have been written. The result is cached so repeated calls are cheap.
+   */
+  OpRef materialize() const;
+
+  /**
+   * Replace the entire contents of this array with an array expression.
+   */
+  void overwrite(const OpRef& base);
+
+  /**
+   * Call the visitor for all the expressions that this array refers to.
+   */
+  void visit(function_view<void(const OpRef&)> visitor) const;
+
+private:
+  struct Page {
+    std::array<uint8_t, PageSize> bytes;
+    // Expressions for the symbolic bytes within the page. This is empty if
+    // every byte in the page is concrete. Otherwise it has PageSize entries
+    // with the concrete bytes being null.
+    std::vector<OpRef> symbolic;
+    // The bytes that have been written since the page was created from the
+    // base array. Only these need to be stored on top of the base array when
+    // materializing it.
+    std::bitset<PageSize> written;
+  };
+
+  OpRef base_;
+  uint64_t size_;
+  std::map<uint64_t, std::shared_ptr<Page>> pages_;
+
+  // The materialized array, if it has been built since the last write.
+  mutable OpRef cache_;
+
+  // Get a page that is safe to modify, creating it from the base array or
+  // copying it if it is shared with another array.
+  Page& page_mut(uint64_t index);
+
+  // Set a byte without updating the materialized array.
+  void put(uint64_t offset, const OpRef& byte);
+  void put(uint64_t offset, uint8_t byte);
+};
+
+} // namespace caffeine
@@ -1,14 +1,17 @@
 #pragma once
 
+#include "caffeine/ADT/UnionFind.h"
 #include "caffeine/ADT/WeakMap.h"
+#include "caffeine/IR/Assertion.h"
 #include "caffeine/IR/Operation.h"
+#include "caffeine/Model/AssertionList.h"
 #include <llvm/ADT/SmallVector.h>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace caffeine {
-class Assertion;
-class AssertionList;
 
 /**
  * Utility class to extract only the assertions required to prove the unproven
@@ -23,11 +26,47 @@ class AssertionList;
  * The algorithm implemented here is described in "Green: reducing, reusing and
  * recycling constraints in program analysis" by Visser et Al.
  * (https://doi.org/10.1145/2393596.2393665).
+ *
+ * Incremental Components
+ * ======================
+ * Two assertions are dependent if they share a symbol, either directly or
+ * through a chain of other assertions. The slicer tracks the connected
+ * components of the symbols within the proven prefix of the assertion list
+ * using a union-find. Since the proven prefix only ever grows along a single
+ * path, the union-find is kept between calls and only the newly proven
+ * assertions are added to it. If a list comes in whose proven prefix doesn't
+ * extend the previous one then the state is rebuilt from scratch.
+ *
+ * Unproven assertions (and extra) are never added to the persistent state
+ * since they are usually rolled back after the query.
  */
 class ConstraintSlicer {
+public:
+  /**
+   * A set of assertions that shares no symbols with the rest of the query.
+   */
+  struct Component {
+    AssertionList assertions;
+    Assertion extra;
+    // All the symbols referenced within the assertions of this component.
+    std::vector<Symbol> symbols;
+    // Whether this component contains any unproven assertions or extra.
+    bool unproven = false;
+  };
+
 private:
+  static constexpr size_t npos = SIZE_MAX;
+
   weak_map<const Operation, llvm::SmallVector<Symbol, 4>> mapping_cache;
 
+  // The proven prefix that the union-find below was built from.
+  std::vector<Assertion> proven_;
+  // For each assertion in proven_, the ID of one of its symbols or npos if it
+  // doesn't contain any symbols.
+  std::vector<size_t> proven_symbol_;
+  std::unordered_map<Symbol, size_t> symbol_ids_;
+  UnionFind<size_t> components_;
+
 public:
   ConstraintSlicer() = default;
 
@@ -39,6 +78,16 @@ public:
    */
   AssertionList slice(const AssertionList& assertions, const Assertion& extra);
 
+  /**
+   * Split the whole query (assertions + extra) into independent components
+   * that can be solved separately. Each component keeps the proven/unproven
+   * split of the original list.
+   *
+   * Components containing unproven assertions or extra come first.
+   */
+  std::vector<Component> partition(const AssertionList& assertions,
+                                   const Assertion& extra);
+
   /**
    * Get a list of all constants that are contained within the provided
    * expression.
@@ -46,6 +95,11 @@ public:
   llvm::ArrayRef<Symbol> contained_constants(const OpRef& expr);
 
 private:
+  // Bring the union-find up to date with the proven prefix of assertions.
+  void sync_proven(const AssertionList& assertions);
+  void add_proven(const Assertion& assertion);
+  void reset();
+
   void calc_contained_constants(const OpRef& expr,
                                 std::unordered_set<Symbol>& out);
 };
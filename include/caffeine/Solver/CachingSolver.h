@@ -0,0 +1,92 @@
+#pragma once
+
+#include "caffeine/ADT/SetTrie.h"
+#include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/Solver/Solver.h"
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace caffeine {
+
+struct CachingSolverOptions {
+  // The maximum number of sets stored in the UNSAT cache before it is cleared.
+  size_t max_unsat = 4096;
+  // The maximum number of exact SAT results that are stored before they are
+  // cleared.
+  size_t max_sat = 4096;
+  // The number of recent SAT models that are tried against every query.
+  size_t max_models = 16;
+
+  constexpr CachingSolverOptions() = default;
+};
+
+/**
+ * Solver which memoizes the results of queries made to the solver below it.
+ *
+ * Queries are keyed on the set of assertions that make them up (including
+ * extra). This means that it works best when placed below the canonicalizing
+ * and slicing solvers so that equivalent queries end up with identical
+ * assertion sets.
+ *
+ * Beyond exact matches, this solver also uses the following rules to answer
+ * queries without invoking the inner solver (the same rules used by KLEE's
+ * counterexample cache):
+ * - If a subset of the query is known to be UNSAT then the query is UNSAT.
+ * - If a model from a previous SAT result satisfies every assertion in the
+ *   query then the query is SAT.
+ *
+ * The cache is bounded. Once it grows beyond its limits all the cached entries
+ * are thrown away.
+ */
+class CachingSolver : public Solver {
+public:
+  using Key = std::vector<Assertion>;
+
+  CachingSolver(const std::shared_ptr<Solver>& inner,
+                const CachingSolverOptions& options = CachingSolverOptions());
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+  void interrupt() override;
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  // Build the sorted, deduplicated key for a query. Trivially true assertions
+  // are left out of the key.
+  static Key make_key(const AssertionList& assertions, const Assertion& extra);
+
+private:
+  // Try to answer the query from the cache. Returns Unknown if the cache isn't
+  // able to answer the query. If need_model is true then a SAT result will only
+  // be returned if there is a model available for it.
+  SolverResult lookup(const Key& key, bool need_model);
+  void record(Key&& key, const SolverResult& result);
+
+  std::shared_ptr<const Model> find_model(const Key& key);
+
+private:
+  std::shared_ptr<Solver> inner;
+  CachingSolverOptions options;
+
+  SetTrie<Assertion> unsat_;
+  size_t unsat_count_ = 0;
+
+  // Exact SAT results. The model may be null if the result came from a check
+  // call.
+  std::unordered_map<Key, std::shared_ptr<const Model>, KeyHash> sat_;
+  // Recently seen models, most recent first.
+  std::deque<std::shared_ptr<const Model>> models_;
+
+  // Needed for ModelEvaluator. Assertions passed to the solver have already
+  // been extracted from the e-graph so this is always empty.
+  EGraph egraph_;
+};
+
+} // namespace caffeine
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/IR/Symbol.h"
+#include "caffeine/Solver/Solver.h"
+#include <atomic>
+#include <llvm/ADT/ArrayRef.h>
+#include <memory>
+#include <unordered_map>
+
+namespace caffeine {
+
+/**
+ * A model which directly stores a concrete value for each symbol.
+ */
+class AssignmentModel : public Model {
+private:
+  std::unordered_map<Symbol, Value> values;
+
+public:
+  AssignmentModel() = default;
+
+  /**
+   * Copy the values of all the symbols referenced by the assertions out of
+   * another model.
+   *
+   * The result doesn't refer back to the original model. Unlike the models
+   * produced by Z3 it can outlive the solver that produced it and be used
+   * from any thread. Returns nullptr if one of the symbols is an array whose
+   * size isn't supported by ModelEvaluator.
+   */
+  static std::shared_ptr<AssignmentModel>
+  extract(const Model& model, llvm::ArrayRef<Assertion> assertions,
+          const EGraph& egraph);
+  static std::shared_ptr<AssignmentModel>
+  extract(const Model& model, const AssertionList& assertions,
+          const Assertion& extra, const EGraph& egraph);
+
+  void assign(const Symbol& symbol, Value value);
+
+  Value lookup(const Symbol& symbol,
+               std::optional<size_t> size = std::nullopt) const override;
+};
+
+struct EnumeratingSolverOptions {
+  // The maximum number of distinct symbols a query may contain.
+  size_t max_symbols = 2;
+  // The maximum bitwidth of any symbol within the query. Every value of each
+  // symbol gets evaluated while narrowing so this is kept small.
+  uint32_t max_bitwidth = 8;
+  // The maximum number of joint assignments that will be tried after the
+  // domain of each symbol has been narrowed down.
+  size_t max_candidates = 1 << 16;
+
+  constexpr EnumeratingSolverOptions() = default;
+};
+
+/**
+ * Solver which decides tiny queries by brute force instead of calling into
+ * the inner solver.
+ *
+ * Queries which only reference a few narrow integer symbols (such as those
+ * produced by resolving pointers or switch instructions) are quick to decide
+ * by evaluating the assertions over every possible assignment. Doing so avoids
+ * the fixed overhead of setting up a query in Z3, which dominates for these
+ * queries.
+ *
+ * The domain of each symbol is first narrowed down using the assertions that
+ * only reference that one symbol. Any remaining assertions are then checked
+ * against every combination of the narrowed domains. Queries which reference
+ * too many symbols, contain arrays or floating-point values, or which still
+ * have too many candidate assignments after narrowing are forwarded to the
+ * inner solver unchanged.
+ *
+ * This solver should be placed directly above the base solver, below the
+ * slicing solver, so that it sees queries that have already been split into
+ * independent components.
+ */
+class EnumeratingSolver : public Solver {
+public:
+  EnumeratingSolver(
+      const std::shared_ptr<Solver>& inner,
+      const EnumeratingSolverOptions& options = EnumeratingSolverOptions());
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+  void interrupt() override;
+
+private:
+  // Attempt to decide the query locally. Returns Unknown if this solver isn't
+  // able to handle the query.
+  SolverResult decide(const AssertionList& assertions, const Assertion& extra);
+
+private:
+  std::shared_ptr<Solver> inner;
+  EnumeratingSolverOptions options;
+  std::atomic<bool> interrupted = false;
+
+  // Needed for ModelEvaluator. Assertions passed to the solver have already
+  // been extracted from the e-graph so this is always empty.
+  EGraph egraph_;
+};
+
+} // namespace caffeine
@@ -3,19 +3,52 @@
 #include "caffeine/IR/EGraph.h"
 #include "caffeine/IR/Value.h"
 #include "caffeine/IR/Visitor.h"
+#include <tsl/hopscotch_map.h>
+#include <vector>
 
 namespace caffeine {
 
 class Model;
 
+/**
+ * Evaluates expressions to concrete values using the assignments within a
+ * model.
+ *
+ * Results are memoized by operation identity for the lifetime of the
+ * evaluator, so every expression passed to visit must be kept alive for as
+ * long as the evaluator is in use.
+ */
 class ModelEvaluator : public ConstOpVisitor<ModelEvaluator, Value> {
 private:
   const Model* model;
   const EGraph* egraph;
 
+  tsl::hopscotch_map<const Operation*, Value> cache;
+  // Expressions extracted from the e-graph while evaluating. These are kept
+  // alive so that their addresses remain valid cache keys.
+  std::vector<OpRef> extracted;
+
 public:
   ModelEvaluator(const Model* model, const EGraph* egraph);
 
+  Value visit(const Operation& O);
+  Value visit(const Operation* O) {
+    return visit(*O);
+  }
+
+  /**
+   * Forget all memoized results. This needs to be called whenever the
+   * assignments within the model change.
+   */
+  void clear();
+
+  /**
+   * Whether every operation within expr is one that a ModelEvaluator knows how
+   * to evaluate. Evaluating an expression for which this returns false may
+   * abort.
+   */
+  static bool supports(const Operation& expr);
+
   Value visitOperation(const Operation& O);
 
 #define HANDLE_OPCLASS(opname, opclass) Value visit##opname(const opclass& O);
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "caffeine/ADT/WeakMap.h"
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/Solver/CachingSolver.h"
+#include "caffeine/Solver/Solver.h"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace caffeine {
+
+/**
+ * 128-bit structural hash of an expression or query.
+ *
+ * Unlike hash_value, this only depends on the structure of the expression
+ * (opcodes, types, constant values, and symbol names) so it is the same
+ * across runs of caffeine.
+ */
+struct QueryHash {
+  uint64_t lo = 0;
+  uint64_t hi = 0;
+
+  bool operator==(const QueryHash& other) const {
+    return lo == other.lo && hi == other.hi;
+  }
+  bool operator!=(const QueryHash& other) const {
+    return !(*this == other);
+  }
+};
+
+} // namespace caffeine
+
+namespace std {
+
+template <>
+struct hash<caffeine::QueryHash> {
+  size_t operator()(const caffeine::QueryHash& hash) const {
+    return static_cast<size_t>(hash.lo);
+  }
+};
+
+} // namespace std
+
+namespace caffeine {
+
+/**
+ * Append-only on-disk store of solver results.
+ *
+ * The existing contents of the file are memory-mapped when the store is
+ * opened and indexed by query hash. New results are appended to the end of
+ * the file and kept in memory for the rest of the run. Each record is a
+ * QueryRecord message (see src/Protos/solver.capnp) preceded by a small
+ * header containing its length and a checksum. A torn write at the end of the
+ * file (e.g. if caffeine was killed) is detected and dropped when the file is
+ * next opened.
+ *
+ * Multiple processes may append to the same file at once. Appends are
+ * serialized with an advisory file lock.
+ *
+ * All methods are thread-safe.
+ */
+class PersistentQueryStore {
+public:
+  struct Entry {
+    SolverResult::Kind kind;
+    // Model containing the values of all the symbols in the query. Always
+    // present for SAT entries.
+    std::shared_ptr<const Model> model;
+  };
+
+  // Open the store at the given path, creating it if it doesn't exist. Check
+  // is_open() afterwards to see whether this succeeded.
+  explicit PersistentQueryStore(const std::string& path);
+  ~PersistentQueryStore();
+
+  // Whether the backing file was opened successfully. None of the other
+  // methods may be called on a store which failed to open.
+  bool is_open() const {
+    return fd_ >= 0;
+  }
+
+  std::optional<Entry> lookup(const QueryHash& hash);
+  void insert(const QueryHash& hash, SolverResult::Kind kind,
+              const std::vector<std::pair<Symbol, Value>>& model);
+
+  // The number of distinct queries within the store.
+  size_t size() const;
+
+  PersistentQueryStore(const PersistentQueryStore&) = delete;
+  PersistentQueryStore& operator=(const PersistentQueryStore&) = delete;
+
+private:
+  void load();
+  static Entry decode(const void* data, size_t size);
+
+  int fd_ = -1;
+  const char* map_ = nullptr;
+  size_t map_size_ = 0;
+
+  mutable std::mutex mutex_;
+  // Offsets and sizes of the messages of records within the mapped region.
+  std::unordered_map<QueryHash, std::pair<size_t, size_t>> index_;
+  // Records that have been decoded or added during this run.
+  std::unordered_map<QueryHash, Entry> entries_;
+};
+
+/**
+ * Solver which looks up queries in a PersistentQueryStore before passing them
+ * on to the inner solver, and records the results of the inner solver in the
+ * store.
+ *
+ * Queries are keyed by a stable structural hash so that results can be reused
+ * by later runs on the same (or a slightly modified) program. This works best
+ * when placed below the slicing solver so that unrelated changes to a program
+ * don't change the hash of the queries that it makes.
+ */
+class PersistentCachingSolver : public Solver {
+public:
+  PersistentCachingSolver(const std::shared_ptr<Solver>& inner,
+                          const std::shared_ptr<PersistentQueryStore>& store);
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+  void interrupt() override;
+
+  // Compute the structural hash of a query. Returns std::nullopt if the query
+  // contains operations that can't be hashed in a stable manner.
+  std::optional<QueryHash> hash_query(const CachingSolver::Key& key);
+
+private:
+  std::optional<QueryHash> hash_expr(const OpRef& expr);
+
+  SolverResult solve(AssertionList& assertions, const Assertion& extra,
+                     bool need_model);
+
+private:
+  std::shared_ptr<Solver> inner;
+  std::shared_ptr<PersistentQueryStore> store;
+
+  weak_map<const Operation, std::optional<QueryHash>> hash_cache;
+
+  // Needed for evaluating models. Assertions passed to the solver have
+  // already been extracted from the e-graph so this is always empty.
+  EGraph egraph_;
+};
+
+} // namespace caffeine
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/Solver/Solver.h"
+#include "caffeine/Solver/Z3Solver.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace caffeine {
+
+/**
+ * Base solver which races several differently-configured solvers against each
+ * other.
+ *
+ * Each member solver gets its own worker thread. A query is handed to all of
+ * them at once and the first definitive (SAT or UNSAT) answer is returned. The
+ * remaining members are then interrupted and the query returns once all of
+ * them have stopped.
+ *
+ * Interrupting a member only cancels the query it is currently working on.
+ * Members are kept across queries so that incremental solvers keep their
+ * state. The winning model is copied into an AssignmentModel so that it stays
+ * valid no matter what the member solver does afterwards.
+ *
+ * Thread Safety
+ * =============
+ * Like all other solvers, a PortfolioSolver should only be used from one
+ * thread at a time. interrupt() may be called from any thread.
+ */
+class PortfolioSolver : public Solver {
+public:
+  using Factory = std::function<std::shared_ptr<Solver>()>;
+
+  explicit PortfolioSolver(const std::vector<Factory>& factories);
+  // Race one Z3Solver for each of the provided configurations.
+  explicit PortfolioSolver(const std::vector<Z3SolverOptions>& configs);
+  ~PortfolioSolver();
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+
+  void interrupt() override;
+
+  PortfolioSolver(const PortfolioSolver&) = delete;
+  PortfolioSolver& operator=(const PortfolioSolver&) = delete;
+
+private:
+  using Job = std::function<SolverResult(Solver&)>;
+
+  struct Member {
+    std::shared_ptr<Solver> solver;
+    std::thread thread;
+
+    // The job waiting to be picked up by this member's worker thread.
+    Job job;
+    bool running = false;
+  };
+
+  SolverResult race(AssertionList& assertions, const Assertion& extra,
+                    bool need_model);
+  void run_worker(size_t index);
+
+  std::vector<Member> members_;
+
+  // Needed for extracting models. Assertions passed to the solver have
+  // already been extracted from the e-graph so this is always empty.
+  EGraph egraph_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+
+  bool shutdown_ = false;
+  size_t pending_ = 0;
+  std::optional<SolverResult> winner_;
+};
+
+} // namespace caffeine
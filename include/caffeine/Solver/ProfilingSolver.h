@@ -0,0 +1,201 @@
+#pragma once
+
+#include "caffeine/IR/OperationBase.h"
+#include "caffeine/Query/ConstraintSlicer.h"
+#include "caffeine/Solver/Solver.h"
+#include <array>
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+class Instruction;
+}
+
+namespace caffeine {
+
+/**
+ * Tracks the instruction on whose behalf solver queries are currently being
+ * made on this thread.
+ *
+ * The interpreter opens a Scope around its solver calls so that solver layers
+ * (e.g. ProfilingSolver) can attribute queries to the instruction that issued
+ * them.
+ */
+class QuerySite {
+public:
+  // The instruction issuing queries on this thread, or nullptr if unknown.
+  static const llvm::Instruction* current();
+
+  class Scope {
+  public:
+    explicit Scope(const llvm::Instruction* inst);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const llvm::Instruction* prev;
+  };
+};
+
+/**
+ * Statistics about solver queries collected from any number of
+ * ProfilingSolvers.
+ *
+ * All methods are thread-safe.
+ */
+class QueryProfile {
+public:
+  struct Record {
+    std::chrono::nanoseconds duration;
+    SolverResult::Kind result;
+    const llvm::Instruction* inst;
+
+    // The number of assertions in the query, including extra.
+    size_t assertions;
+    // The number of assertions left after slicing away those that are
+    // independent of extra.
+    size_t sliced;
+    // The number of distinct expression nodes within the query.
+    size_t nodes;
+  };
+
+  // Latencies are bucketed by powers of two of microseconds.
+  static constexpr size_t num_buckets = 32;
+
+  struct SiteStats {
+    size_t count = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+    std::array<size_t, 3> results = {};
+    std::array<size_t, num_buckets> histogram = {};
+  };
+
+  explicit QueryProfile(size_t top_n = 20);
+
+  void record(const Record& record);
+
+  // Print a report of per-instruction latency histograms followed by the
+  // most expensive individual queries.
+  void report(std::ostream& os) const;
+
+private:
+  static size_t bucket_for(std::chrono::nanoseconds duration);
+
+  size_t top_n;
+
+  mutable std::mutex mutex;
+  std::unordered_map<const llvm::Instruction*, SiteStats> sites;
+  // Min-heap (by duration) of the most expensive queries seen so far.
+  std::vector<Record> top;
+};
+
+/**
+ * Log of solver query durations along with the operations that make up each
+ * query.
+ *
+ * Each query is written as a single line
+ *
+ *   <duration-ns> <opcode>:<count>:<bits> ...
+ *
+ * where count is the number of distinct expression nodes with that opcode and
+ * bits is the sum of their bitwidths (as computed by
+ * ExtractionCostModel::type_bitwidth). This is the input used by
+ * tools/cost-calibrate to fit the weights of a WeightedCostModel.
+ *
+ * All methods are thread-safe.
+ */
+class QueryLog {
+public:
+  struct Usage {
+    uint64_t count = 0;
+    uint64_t bits = 0;
+  };
+
+  struct Entry {
+    std::chrono::nanoseconds duration{0};
+    std::map<Operation::Opcode, Usage> usage;
+  };
+
+  // The log does not take ownership of the stream. It must outlive the log.
+  explicit QueryLog(std::ostream& os);
+
+  void record(const Entry& entry);
+
+  // Parse a single line of a query log. Returns std::nullopt if the line is
+  // malformed.
+  static std::optional<Entry> parse(std::string_view line);
+
+private:
+  std::mutex mutex;
+  std::ostream* os;
+};
+
+/**
+ * Solver which measures every query made through it and records the results
+ * into a QueryProfile.
+ *
+ * This should be placed at the top of the solver stack so that it measures
+ * the full cost of each query, including any caching or simplification done
+ * by the other solver layers.
+ */
+class ProfilingSolver : public Solver {
+public:
+  ProfilingSolver(const std::shared_ptr<Solver>& inner,
+                  const std::shared_ptr<QueryProfile>& profile);
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+  void interrupt() override;
+
+private:
+  template <typename F>
+  SolverResult measure(AssertionList& assertions, const Assertion& extra,
+                       F&& func);
+
+private:
+  std::shared_ptr<Solver> inner;
+  std::shared_ptr<QueryProfile> profile;
+  ConstraintSlicer slicer;
+};
+
+/**
+ * Solver which records the duration and contents of every query made through
+ * it into a QueryLog.
+ *
+ * This should be placed directly above the base solver. That way only the
+ * queries that actually reach it get logged, in the form they were sent,
+ * after slicing and simplification and without any cache hits.
+ */
+class QueryLoggingSolver : public Solver {
+public:
+  QueryLoggingSolver(const std::shared_ptr<Solver>& inner,
+                     const std::shared_ptr<QueryLog>& log);
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+  void interrupt() override;
+
+private:
+  template <typename F>
+  SolverResult measure(AssertionList& assertions, const Assertion& extra,
+                       F&& func);
+
+private:
+  std::shared_ptr<Solver> inner;
+  std::shared_ptr<QueryLog> log;
+};
+
+} // namespace caffeine
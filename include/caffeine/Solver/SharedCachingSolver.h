@@ -0,0 +1,111 @@
+#pragma once
+
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/Solver/CachingSolver.h"
+#include "caffeine/Solver/Solver.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace caffeine {
+
+struct SharedQueryCacheOptions {
+  // The number of independently locked shards that the cache is split into.
+  size_t shards = 16;
+  // The maximum number of entries stored across all shards. Once a shard is
+  // full the least recently used entry within it is evicted.
+  size_t max_entries = 1 << 16;
+
+  constexpr SharedQueryCacheOptions() = default;
+};
+
+/**
+ * Thread-safe store of query results which can be shared by the solvers of
+ * all worker threads.
+ *
+ * Operations are hash-consed globally so identical queries issued on
+ * different threads end up with identical keys. Entries keep the assertions
+ * in their key alive so that key identity stays valid for as long as the
+ * entry exists.
+ *
+ * The cache is split into shards, each with its own lock and LRU list, to
+ * keep contention between workers low.
+ */
+class SharedQueryCache {
+public:
+  using Key = CachingSolver::Key;
+
+  struct Entry {
+    SolverResult::Kind kind;
+    // A self-contained model for SAT results. This is null if the result was
+    // recorded without a model.
+    std::shared_ptr<const Model> model;
+  };
+
+  explicit SharedQueryCache(
+      const SharedQueryCacheOptions& options = SharedQueryCacheOptions());
+
+  std::optional<Entry> lookup(const Key& key);
+  void insert(Key&& key, Entry&& entry);
+
+  size_t size() const;
+
+  SharedQueryCache(const SharedQueryCache&) = delete;
+  SharedQueryCache& operator=(const SharedQueryCache&) = delete;
+
+private:
+  struct Shard {
+    using LRUList = std::list<std::pair<Key, Entry>>;
+
+    mutable std::mutex mutex;
+    // Most recently used entries are at the front.
+    LRUList lru;
+    std::unordered_map<Key, LRUList::iterator, CachingSolver::KeyHash> index;
+  };
+
+  Shard& shard_for(size_t hash);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  size_t shard_capacity_;
+};
+
+/**
+ * Solver which answers queries using a SharedQueryCache and records the
+ * results of the inner solver into it.
+ *
+ * Models produced by the inner solver may not be safe to use from other
+ * threads (e.g. Z3 models are tied to their context) so models are converted
+ * into a compact copy holding the values of the query's symbols before they
+ * are stored in the cache.
+ */
+class SharedCachingSolver : public Solver {
+public:
+  SharedCachingSolver(const std::shared_ptr<Solver>& inner,
+                      const std::shared_ptr<SharedQueryCache>& cache);
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override;
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override;
+  void interrupt() override;
+
+private:
+  SolverResult lookup(const SharedQueryCache::Key& key, bool need_model);
+  void record(SharedQueryCache::Key&& key, const SolverResult& result);
+
+  std::shared_ptr<const Model> compact(const SharedQueryCache::Key& key,
+                                       const Model& model);
+
+private:
+  std::shared_ptr<Solver> inner;
+  std::shared_ptr<SharedQueryCache> cache;
+
+  // Needed for evaluating models. Assertions passed to the solver have
+  // already been extracted from the e-graph so this is always empty.
+  EGraph egraph_;
+};
+
+} // namespace caffeine
@@ -1,20 +1,48 @@
+#pragma once
+
 #include "caffeine/ADT/WeakMap.h"
 #include "caffeine/IR/Operation.h"
 #include "caffeine/Query/ConstraintSlicer.h"
 #include "caffeine/Solver/Solver.h"
 #include <llvm/ADT/SmallVector.h>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace caffeine {
 
+/**
+ * A model made up of the models for several independent sets of assertions.
+ *
+ * Each symbol is looked up in the model of the component that it belongs to.
+ */
+class StitchedModel : public Model {
+private:
+  std::vector<std::shared_ptr<const Model>> models;
+  std::unordered_map<Symbol, size_t> owners;
+
+public:
+  StitchedModel(std::vector<std::shared_ptr<const Model>>&& models,
+                std::unordered_map<Symbol, size_t>&& owners);
+
+  Value lookup(const Symbol& symbol, std::optional<size_t> size) const override;
+};
+
 class SlicingSolver : public Solver {
 private:
   ConstraintSlicer slicer;
   std::shared_ptr<Solver> inner;
+  bool stitch_models;
 
 public:
-  SlicingSolver(const std::shared_ptr<Solver>& inner);
+  /**
+   * If stitch_models is true then resolve will split the query into
+   * independent components, solve each one separately, and merge the resulting
+   * models. Otherwise resolve passes the full query to the inner solver.
+   */
+  SlicingSolver(const std::shared_ptr<Solver>& inner,
+                bool stitch_models = true);
 
   SolverResult check(AssertionList& assertions,
                      const Assertion& extra) override;
@@ -22,6 +22,7 @@ class LLVMValue;
 class Symbol;
 class ModelEvaluator;
 class EGraph;
+class StitchedModel;
 
 /**
  * A set of concrete value assignments to constants that satisfy the set of
@@ -71,6 +72,7 @@ protected:
 
   friend class ExprEvaluator;
   friend class ModelEvaluator;
+  friend class StitchedModel;
 };
 
 /**
@@ -90,7 +92,7 @@ public:
   enum Kind { UNSAT, SAT, Unknown };
 
 public:
-  SolverResult(Kind kind, std::unique_ptr<Model> model = nullptr);
+  SolverResult(Kind kind, std::shared_ptr<const Model> model = nullptr);
 
   bool operator==(Kind kind) const;
   bool operator!=(Kind kind) const;
@@ -99,6 +101,9 @@ public:
   // Get the model associated with this SolverResult. If this result doesn't
   // contain a model then returns nullptr.
   const Model* model() const;
+  // Get a shared reference to the model so that it can outlive this
+  // SolverResult. Returns nullptr if this result doesn't contain a model.
+  const std::shared_ptr<const Model>& shared_model() const;
 
   /**
    * Evaluate an expression using this model. Returns an appropriate constant
@@ -115,7 +120,7 @@ public:
 
 private:
   Kind kind_;
-  std::unique_ptr<Model> model_;
+  std::shared_ptr<const Model> model_;
 };
 
 /**
@@ -142,10 +147,17 @@ public:
    *    wouldn't be valid to perform that simplification. Note, however, that
    *    the final SAT/UNSAT result should take extra into account.
    *
+   * Models
+   * ======
+   * A SAT result from check may carry a model but it is not required to. When
+   * present, the model is only guaranteed to satisfy the assertions that the
+   * solver actually considered (e.g. a slice of the full query) so callers
+   * must validate it before relying on it.
+   *
    * Default Implementation
    * ======================
-   * By default this is implemented by calling resolve and then throwing away
-   * the model.
+   * By default this is implemented by calling resolve and passing along
+   * whatever model it returns.
    *
    * Solver adapters should forward this method (after performing any applicable
    * modifications to the assertions) as it may be more efficient for some
@@ -234,6 +246,8 @@ public:
   SolverBuilder(const BaseFn& base);
 
   static SolverBuilder with_default();
+  // The default solver stack on top of a custom base solver.
+  static SolverBuilder with_default(const BaseFn& base);
 
   // Add a new solver to the top of the solver stack.
   SolverBuilder& with(const InterFn& func);
@@ -5,6 +5,8 @@
 #include <tsl/hopscotch_map.h>
 #include <z3++.h>
 
+#include <vector>
+
 namespace caffeine {
 
 using Z3SymbolName = std::variant<std::string, uint64_t>;
@@ -17,6 +19,12 @@ private:
   Z3ConstMap* constMap;
   tsl::hopscotch_map<const Operation*, z3::expr> cache;
 
+  // Constraints that were added directly to the solver while converting
+  // expressions (e.g. the contents of a FixedArray). These are recorded so
+  // that incremental users can re-add them if the scope they were asserted in
+  // is popped while the cached expression remains live.
+  std::vector<z3::expr> side_constraints;
+
   // Used for temporary constants that are needed as an implementation detail
   // but aren't otherwise exposed to clients.
   uint32_t tmpConstNum = (1u << 30) / 2;
@@ -33,6 +41,20 @@ public:
 
   z3::expr visitOperation(const Operation& op);
 
+  /**
+   * Take all side constraints that have been added to the solver since the
+   * last call to this method.
+   *
+   * Cached expressions may depend on these so if the solver scope they were
+   * added in gets popped then they must be re-added before the cached
+   * expression is used again.
+   */
+  std::vector<z3::expr> take_side_constraints() {
+    std::vector<z3::expr> result = std::move(side_constraints);
+    side_constraints.clear();
+    return result;
+  }
+
 #define HANDLE_OPCLASS(opname, opclass)                                        \
   z3::expr visit##opname(const opclass& op);
 #include "caffeine/IR/Operation.def"
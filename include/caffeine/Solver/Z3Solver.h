@@ -3,7 +3,9 @@
 
 #include "caffeine/Solver/Solver.h"
 
+#include <cstddef>
 #include <memory>
+#include <string>
 
 namespace z3 {
 class context;
@@ -16,6 +18,44 @@ namespace caffeine {
 class Model;
 class Assertion;
 
+struct Z3SolverOptions {
+  /**
+   * The Z3 tactic used to build the solver for each query (e.g. "default",
+   * "qfbv", "qfabv"). In incremental mode any tactic other than "default" is
+   * turned into a solver once and reused.
+   */
+  std::string tactic = "default";
+
+  // Let Z3 automatically select and configure the solver.
+  bool auto_config = true;
+
+  /**
+   * Keep a single z3::solver alive across queries instead of building a fresh
+   * one for every query.
+   *
+   * In incremental mode the solver keeps a stack of push/pop scopes that
+   * mirror the assertion list it was last given: the proven prefix of the list
+   * lives in its own scopes and the unproven tail (which is what gets rolled
+   * back by AssertionList::restore) lives in the topmost one. Each query only
+   * pops the scopes which no longer match and asserts the new suffix. The
+   * extra assertion is passed as an assumption so it never needs a scope of
+   * its own.
+   *
+   * Converted Z3 expressions are also cached by operation identity across
+   * queries.
+   */
+  bool incremental = false;
+
+  /**
+   * The maximum number of root expressions that the incremental solver will
+   * keep alive before it throws away all of its state and starts over. This
+   * bounds the memory used by the expression cache.
+   */
+  size_t max_retained = 1 << 14;
+
+  Z3SolverOptions() = default;
+};
+
 class Z3Solver : public Solver {
 private:
   class Impl;
@@ -25,6 +65,7 @@ private:
 
 public:
   Z3Solver();
+  explicit Z3Solver(const Z3SolverOptions& options);
   ~Z3Solver();
 
   Z3Solver(Z3Solver&& solver) noexcept;
@@ -38,6 +79,11 @@ public:
 
   void interrupt() override;
 
+private:
+  SolverResult resolve_incremental(AssertionList& assertions,
+                                   const Assertion& extra);
+
+public:
   // Evaluate an expression to a z3::expr. This is exposed for testing purposes.
   z3::context& context();
   z3::expr evaluate(const OpRef& expr, z3::solver& solver);
@@ -3,14 +3,32 @@
 #include "caffeine/IR/Operation.h"
 #include "caffeine/IR/OperationData.h"
 #include "caffeine/Support/LLVMFmt.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
+#include <immer/flex_vector_transient.hpp>
 #include <limits>
+#include <utility>
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/IR/Function.h>
 
 namespace caffeine {
 
+ENode::ENode(std::shared_ptr<OperationData> data,
+             std::initializer_list<size_t> operands)
+    : ENode(std::move(data), llvm::ArrayRef<size_t>(operands)) {}
+ENode::ENode(std::shared_ptr<OperationData> data,
+             llvm::ArrayRef<size_t> operands)
+    : data(std::move(data)) {
+  this->operands.reserve(operands.size());
+  for (size_t operand : operands) {
+    CAFFEINE_ASSERT(operand <= UINT32_MAX);
+    this->operands.push_back(static_cast<uint32_t>(operand));
+  }
+}
+
 bool ENode::operator==(const ENode& node) const {
   if (operands != node.operands)
     return false;
@@ -50,6 +68,17 @@ llvm::hash_code hash_value(const ENode& node) {
       llvm::hash_combine_range(node.operands.begin(), node.operands.end()));
 }
 
+bool EParent::operator==(const EParent& parent) const {
+  return eclass == parent.eclass && node == parent.node;
+}
+bool EParent::operator!=(const EParent& parent) const {
+  return !(*this == parent);
+}
+
+llvm::hash_code hash_value(const EParent& parent) {
+  return llvm::hash_combine(parent.node, parent.eclass);
+}
+
 void EClassCache::clear() {
   *this = EClassCache();
 }
@@ -84,8 +113,14 @@ void EClass::merge(EClass&& eclass) {
 
   nodes.insert(nodes.end(), std::move_iterator(eclass.nodes.begin()),
                std::move_iterator(eclass.nodes.end()));
-  for (auto it = eclass.parents.begin(); it != eclass.parents.end(); ++it) {
-    parents.emplace(it.key(), it.value());
+  // Duplicates are removed when this e-class is next repaired.
+  parents = std::move(parents) + eclass.parents;
+
+  if (eclass.analysis.has_value()) {
+    if (analysis.has_value())
+      analysis->refine(*eclass.analysis);
+    else
+      analysis = std::move(eclass.analysis);
   }
 
   if (eclass.constant_index.has_value()) {
@@ -126,6 +161,39 @@ Type EClass::type() const {
   return nodes.front().data->type();
 }
 
+static uint64_t next_owner() {
+  static std::atomic<uint64_t> counter{0};
+  return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+EGraph::EGraph()
+    : cost_model(ExtractionCostModel::default_model()), owner(next_owner()) {}
+EGraph::EGraph(const EGraph& egraph)
+    : union_find(egraph.union_find), interned(egraph.interned),
+      hashcons(egraph.hashcons), classes(egraph.classes),
+      updated(egraph.updated), changed(egraph.changed),
+      worklist(egraph.worklist), cost_model(egraph.cost_model),
+      owner(next_owner()) {
+  egraph.owner = next_owner();
+}
+
+EGraph& EGraph::operator=(const EGraph& egraph) {
+  if (this == &egraph)
+    return *this;
+
+  union_find = egraph.union_find;
+  interned = egraph.interned;
+  hashcons = egraph.hashcons;
+  classes = egraph.classes;
+  updated = egraph.updated;
+  changed = egraph.changed;
+  worklist = egraph.worklist;
+  cost_model = egraph.cost_model;
+  owner = next_owner();
+  egraph.owner = next_owner();
+  return *this;
+}
+
 size_t EGraph::find(size_t id) const {
   return union_find.find(id);
 }
@@ -134,18 +202,37 @@ size_t EGraph::find(size_t id) {
 }
 
 EClass* EGraph::get(size_t id) {
-  auto it = classes.find(find(id));
-  if (it != classes.end())
-    return &it->second;
-  return nullptr;
+  return get_mut(find(id));
 }
 const EClass* EGraph::get(size_t id) const {
-  auto it = classes.find(find(id));
-  if (it != classes.end())
-    return &it->second;
+  if (const ClassEntry* entry = classes.find(find(id)))
+    return entry->eclass.get();
   return nullptr;
 }
 
+EClass* EGraph::get_mut(size_t id) {
+  const ClassEntry* entry = classes.find(id);
+  if (!entry)
+    return nullptr;
+  if (entry->owner == owner)
+    return entry->eclass.get();
+
+  auto copy = std::make_shared<EClass>(*entry->eclass);
+  EClass* eclass = copy.get();
+  classes = std::move(classes).set(id, ClassEntry{owner, std::move(copy)});
+  return eclass;
+}
+
+EClass EGraph::take(size_t id) {
+  const ClassEntry* entry = classes.find(id);
+  CAFFEINE_ASSERT(entry, "attempted to take a nonexistent e-class");
+
+  EClass eclass = entry->owner == owner ? std::move(*entry->eclass)
+                                        : EClass(*entry->eclass);
+  classes = std::move(classes).erase(id);
+  return eclass;
+}
+
 size_t EGraph::merge(size_t id1, size_t id2) {
   id1 = find(id1);
   id2 = find(id2);
@@ -155,35 +242,35 @@ size_t EGraph::merge(size_t id1, size_t id2) {
 
   auto new_id = union_find.do_union(id1, id2);
 
-  classes.at(new_id).merge(std::move(classes.at(id2)));
-  classes.erase(id2);
+  EClass merged = take(id2);
+  get_mut(new_id)->merge(std::move(merged));
 
   worklist.push_back(new_id);
-  updated.insert(new_id);
+  mark_updated(new_id);
   return new_id;
 }
 
 ENode EGraph::canonicalize(const ENode& node) {
-  auto operands = node.operands;
-  for (size_t& operand : operands)
-    operand = find(operand);
+  ENode canonical = node;
+  for (uint32_t& operand : canonical.operands)
+    operand = static_cast<uint32_t>(find(operand));
 
-  return ENode{node.data, std::move(operands)};
+  return canonical;
 }
 
 size_t EGraph::add(const ENode& node) {
-  auto canonical = canonicalize(node);
-  auto it = hashcons.find(canonical);
-  if (it != hashcons.end())
-    return it->second;
+  auto canonical = intern(canonicalize(node));
+  if (const size_t* existing = hashcons.find(canonical))
+    return *existing;
 
   auto eclass_id = create_eclass(canonical);
   for (size_t child : canonical.operands) {
-    classes.at(child).parents.emplace(canonical, eclass_id);
+    EClass* eclass = get_mut(child);
+    eclass->parents = std::move(eclass->parents)
+                          .push_back({canonical, uint32_t(eclass_id)});
   }
 
-  hashcons.emplace(canonical, eclass_id);
-  updated.insert(eclass_id);
+  mark_updated(eclass_id);
 
   return eclass_id;
 }
@@ -201,24 +288,32 @@ size_t EGraph::add(const Operation& op) {
   return add(ENode{op.data(), std::move(operands)});
 }
 
-size_t EGraph::add_merge(size_t eclass_id, const ENode& node) {
-  auto [it, inserted] = hashcons.emplace(node, eclass_id);
-  if (!inserted)
-    return merge(eclass_id, it->second);
+size_t EGraph::add_merge(size_t eclass_id, const ENode& input) {
+  ENode node = intern(input);
+  if (const size_t* existing = hashcons.find(node))
+    return merge(eclass_id, *existing);
+  hashcons = std::move(hashcons).set(node, eclass_id);
+
+  EClass tmp{{node}};
+  tmp.analysis = analyze(node);
 
-  EClass& eclass = classes.at(eclass_id);
-  eclass.merge(EClass{{node}});
+  EClass& eclass = *get_mut(eclass_id);
+  eclass.merge(std::move(tmp));
 
   worklist.push_back(eclass_id);
-  updated.insert(eclass_id);
+  mark_updated(eclass_id);
   return eclass_id;
 }
 
 std::optional<size_t> EGraph::classof(const ENode& node) const {
-  auto it = hashcons.find(node);
-  if (it == hashcons.end())
+  auto interned_node = find_interned(node);
+  if (!interned_node)
+    return std::nullopt;
+
+  const size_t* id = hashcons.find(*interned_node);
+  if (!id)
     return std::nullopt;
-  return find(it->second);
+  return find(*id);
 }
 
 void EGraph::rebuild() {
@@ -228,14 +323,16 @@ void EGraph::rebuild() {
   llvm::SmallVector<size_t> cache_stack;
 
   std::vector<size_t> todo;
+  std::vector<size_t> analysis_stack;
   while (!worklist.empty()) {
     swap(todo, worklist);
 
     for (size_t eclass : todo) {
       eclass = find(eclass);
       repair(eclass);
+      analysis_stack.push_back(eclass);
 
-      for (const auto& [node, parent] : classes.at(eclass).parents) {
+      for (const auto& [node, parent] : get(eclass)->parents) {
         cache_stack.push_back(parent);
       }
     }
@@ -243,6 +340,8 @@ void EGraph::rebuild() {
     todo.clear();
   }
 
+  propagate_analysis(std::move(analysis_stack));
+
   // Clear out cached values for expressions that have been modified.
   while (!cache_stack.empty()) {
     size_t id = cache_stack.pop_back_val();
@@ -252,7 +351,7 @@ void EGraph::rebuild() {
     EClass* eclass = get(id);
 
     eclass->cache.clear();
-    updated.insert(id);
+    mark_updated(id);
 
     for (const auto& [node, parent] : eclass->parents) {
       if (!cache_visited.contains(parent))
@@ -262,7 +361,7 @@ void EGraph::rebuild() {
 }
 
 void EGraph::repair(size_t eclass_id) {
-  EClass& eclass = classes.at(eclass_id);
+  EClass& eclass = *get_mut(eclass_id);
 
   if (eclass.is_constant())
     unparent(eclass_id);
@@ -275,31 +374,36 @@ void EGraph::repair(size_t eclass_id) {
   for (const auto& [p_node, p_eclass] : eclass.parents) {
     auto canonical = canonicalize(p_node);
 
-    hashcons.erase(p_node);
-    hashcons.insert_or_assign(canonical, find(p_eclass));
+    hashcons = std::move(hashcons).erase(p_node);
+    hashcons = std::move(hashcons).set(canonical, find(p_eclass));
   }
 
-  tsl::hopscotch_map<ENode, size_t> new_parents;
-  new_parents.reserve(eclass.parents.size());
+  // Deduplicate the parent list. Parents that have become congruent are merged.
+  tsl::hopscotch_map<ENode, size_t, InternedHasher, InternedEqual> seen;
+  seen.reserve(eclass.parents.size());
   for (const auto& [p_node, p_eclass] : eclass.parents) {
     auto canonical = canonicalize(p_node);
 
-    auto it = new_parents.find(canonical);
-    if (it != new_parents.end()) {
+    auto it = seen.find(canonical);
+    if (it != seen.end()) {
       it.value() = merge(p_eclass, it->second);
     } else {
-      new_parents.insert({canonical, find(p_eclass)});
+      seen.emplace(std::move(canonical), find(p_eclass));
     }
   }
 
-  eclass.parents = new_parents;
+  auto new_parents = immer::flex_vector<EParent>().transient();
+  for (const auto& [node, parent] : seen)
+    new_parents.push_back({node, uint32_t(find(parent))});
+
+  eclass.parents = new_parents.persistent();
 
   for (ENode& node : eclass.nodes)
     node = canonicalize(node);
 }
 
 void EGraph::unparent(size_t eclass_id) {
-  EClass& eclass = classes.at(eclass_id);
+  EClass& eclass = *get_mut(eclass_id);
   CAFFEINE_ASSERT(eclass.is_constant());
 
   if (eclass.nodes.size() == 1)
@@ -307,7 +411,14 @@ void EGraph::unparent(size_t eclass_id) {
 
   for (const ENode& node : eclass.nodes) {
     for (size_t operand : node.operands) {
-      get(operand)->parents.erase(node);
+      EClass* child = get(operand);
+
+      auto remaining = immer::flex_vector<EParent>().transient();
+      for (const EParent& parent : child->parents) {
+        if (parent.node != node)
+          remaining.push_back(parent);
+      }
+      child->parents = remaining.persistent();
     }
   }
 
@@ -316,14 +427,220 @@ void EGraph::unparent(size_t eclass_id) {
   eclass.constant_index = 0;
 }
 
+void EGraph::mark_updated(size_t eclass) {
+  updated = std::move(updated).insert(eclass);
+  changed = std::move(changed).insert(eclass);
+}
+
+std::optional<IntAnalysis> EGraph::analyze(const ENode& node) const {
+  llvm::SmallVector<const IntAnalysis*, 3> operands;
+  operands.reserve(node.operands.size());
+
+  for (size_t operand : node.operands) {
+    const EClass* eclass = get(operand);
+    operands.push_back(eclass->analysis ? &*eclass->analysis : nullptr);
+  }
+
+  return IntAnalysis::evaluate(node, operands);
+}
+
+// The number of times that an e-class can have its analysis refined within a
+// single call to rebuild. Ranges can shrink by a single value each time they
+// go around a cycle in the e-graph so this keeps rebuild from taking forever
+// in that case.
+static constexpr unsigned max_refinements = 8;
+
+void EGraph::propagate_analysis(std::vector<size_t>&& stack) {
+  tsl::hopscotch_map<size_t, unsigned> refinements;
+
+  while (!stack.empty()) {
+    size_t id = find(stack.back());
+    stack.pop_back();
+
+    // Updating a parent may replace this e-class if it is its own parent so
+    // the parent list is copied first.
+    immer::flex_vector<EParent> parents = std::as_const(*this).get(id)->parents;
+    for (const auto& [node, parent] : parents) {
+      std::optional<IntAnalysis> facts = analyze(node);
+      if (!facts)
+        continue;
+
+      size_t parent_id = find(parent);
+      const EClass* eclass = std::as_const(*this).get(parent_id);
+      if (!eclass->analysis)
+        continue;
+
+      IntAnalysis refined = *eclass->analysis;
+      if (!refined.refine(*facts))
+        continue;
+      if (refinements[parent_id]++ >= max_refinements)
+        continue;
+
+      get_mut(parent_id)->analysis = std::move(refined);
+      mark_updated(parent_id);
+      stack.push_back(parent_id);
+    }
+  }
+}
+
+void EGraph::set_cost_model(std::shared_ptr<const ExtractionCostModel> model) {
+  CAFFEINE_ASSERT(model);
+  cost_model = std::move(model);
+
+  // Iterate over a snapshot since get_mut may replace entries in classes.
+  auto snapshot = classes;
+  for (const auto& [id, entry] : snapshot) {
+    const EClassCache& cache = entry.eclass->cache;
+    if (cache.expr || cache.cost)
+      get_mut(id)->cache.clear();
+  }
+}
+
+size_t EGraph::size() const {
+  return classes.size();
+}
+
+size_t EGraph::collect(llvm::ArrayRef<size_t> roots) {
+  // Everything below assumes that the hashcons and parent lists are canonical.
+  rebuild();
+
+  tsl::hopscotch_set<size_t> live;
+  std::vector<size_t> stack;
+  for (size_t root : roots)
+    stack.push_back(find(root));
+
+  while (!stack.empty()) {
+    size_t id = stack.back();
+    stack.pop_back();
+
+    if (!live.insert(id).second)
+      continue;
+
+    for (const ENode& node : std::as_const(*this).get(id)->nodes) {
+      for (size_t operand : node.operands) {
+        size_t child = find(operand);
+        if (!live.contains(child))
+          stack.push_back(child);
+      }
+    }
+  }
+
+  auto is_dead = [&](size_t id) { return !live.contains(find(id)); };
+
+  std::vector<size_t> dead;
+  for (const auto& [id, entry] : classes) {
+    if (!live.contains(id))
+      dead.push_back(id);
+  }
+  for (size_t id : dead)
+    classes = std::move(classes).erase(id);
+
+  std::vector<ENode> stale;
+  for (const auto& [node, id] : hashcons) {
+    if (is_dead(id) || llvm::any_of(node.operands, is_dead))
+      stale.push_back(node);
+  }
+  for (const ENode& node : stale)
+    hashcons = std::move(hashcons).erase(node);
+
+  // Every e-node that is still within the e-graph is in the hashcons so only
+  // data used by those needs to be kept around.
+  interned = {};
+  for (const auto& [node, id] : hashcons) {
+    if (node.data)
+      interned = std::move(interned).insert(node.data);
+  }
+
+  // Live e-classes may still be used by e-nodes within dead e-classes. Only
+  // e-classes where that is the case need to be modified (and thus copied).
+  auto dead_parent = [&](const EParent& parent) {
+    return is_dead(parent.eclass);
+  };
+  for (size_t id : live) {
+    const EClass* eclass = std::as_const(*this).get(id);
+    if (std::none_of(eclass->parents.begin(), eclass->parents.end(),
+                     dead_parent))
+      continue;
+
+    auto remaining = immer::flex_vector<EParent>().transient();
+    for (const EParent& parent : eclass->parents) {
+      if (!dead_parent(parent))
+        remaining.push_back(parent);
+    }
+    get_mut(id)->parents = remaining.persistent();
+  }
+
+  for (immer::set<size_t>* set : {&updated, &changed}) {
+    for (size_t id : immer::set<size_t>(*set)) {
+      if (is_dead(id))
+        *set = std::move(*set).erase(id);
+    }
+  }
+
+  return dead.size();
+}
+
+immer::set<size_t> EGraph::take_changed() {
+  return std::exchange(changed, immer::set<size_t>());
+}
+
 size_t EGraph::create_eclass(const ENode& node) {
   size_t id = union_find.make_set();
-  classes.emplace(id, EClass{{node}});
-  hashcons.emplace(node, id);
+  CAFFEINE_ASSERT(id <= UINT32_MAX, "ran out of 32-bit e-class ids");
+
+  auto eclass = std::make_shared<EClass>(EClass{{node}});
+  eclass->analysis = analyze(node);
+
+  classes = std::move(classes).set(id, ClassEntry{owner, std::move(eclass)});
+  hashcons = std::move(hashcons).set(node, id);
   worklist.push_back(id);
   return id;
 }
 
+ENode EGraph::intern(ENode node) {
+  if (!node.data)
+    return node;
+
+  if (const auto* data = interned.find(node.data))
+    node.data = *data;
+  else
+    interned = std::move(interned).insert(node.data);
+
+  return node;
+}
+
+std::optional<ENode> EGraph::find_interned(ENode node) const {
+  if (!node.data)
+    return node;
+
+  const auto* data = interned.find(node.data);
+  if (!data)
+    return std::nullopt;
+
+  node.data = *data;
+  return node;
+}
+
+size_t EGraph::DataHasher::operator()(
+    const std::shared_ptr<OperationData>& data) const {
+  return LLVMHasher()(*data);
+}
+bool EGraph::DataEqual::operator()(
+    const std::shared_ptr<OperationData>& lhs,
+    const std::shared_ptr<OperationData>& rhs) const {
+  return lhs == rhs || *lhs == *rhs;
+}
+
+size_t EGraph::InternedHasher::operator()(const ENode& node) const {
+  return static_cast<size_t>(llvm::hash_combine(
+      node.data.get(),
+      llvm::hash_combine_range(node.operands.begin(), node.operands.end())));
+}
+bool EGraph::InternedEqual::operator()(const ENode& lhs,
+                                       const ENode& rhs) const {
+  return lhs.data == rhs.data && lhs.operands == rhs.operands;
+}
+
 OpRef EGraph::extract(size_t id) {
   return EGraphExtractor(this).extract(id);
 }
@@ -340,10 +657,10 @@ OpRef EGraph::extract(const Operation& op) const {
 
 std::string EGraph::DebugString() const {
   std::string result = "EGraph {\n";
-  for (const auto& [eclass_id, eclass] : classes) {
+  for (const auto& [eclass_id, entry] : classes) {
     fmt::format_to(std::back_inserter(result), "  eclass {}:\n", eclass_id);
 
-    for (const ENode& enode : eclass.nodes) {
+    for (const ENode& enode : entry.eclass->nodes) {
       std::string opcode{Operation::opcode_name(enode.opcode())};
       std::transform(opcode.begin(), opcode.end(), opcode.begin(),
                      [](unsigned char c) { return std::tolower(c); });
@@ -416,25 +733,15 @@ EClassCost EGraphExtractor::eval_cost(size_t eclass_id) {
   return {cost, index};
 }
 uint64_t EGraphExtractor::eval_cost(const ENode& node) {
-  uint64_t cost = eval_cost(node.data->opcode());
-  for (size_t operand : node.operands)
+  uint32_t bitwidth = ExtractionCostModel::type_bitwidth(node.type());
+  uint64_t cost = 0;
+  for (size_t operand : node.operands) {
     cost += eval_cost(operand).cost;
-  return cost;
-}
-uint64_t EGraphExtractor::eval_cost(Operation::Opcode opcode) {
-  using Opcode = Operation::Opcode;
-
-  switch (opcode) {
-  // Symbolic constants are expensive, better to use a large non-symbolic
-  // expression instead.
-  case Opcode::ConstantNamed:
-  case Opcode::ConstantNumbered:
-  case Opcode::ConstantArray:
-    return 1 << 16;
-
-  default:
-    return 1;
+    bitwidth = std::max(bitwidth, ExtractionCostModel::type_bitwidth(
+                                      graph->get(operand)->type()));
   }
+
+  return cost + graph->cost_model->cost(node.opcode(), bitwidth);
 }
 
 void EGraphExtractor::update_cached(size_t eclass_id, const OpRef& expr) {
@@ -476,7 +783,9 @@ OpRef EGraphExtractor::extract(size_t id) {
     return it->second;
 
   auto [cost, index] = eval_cost(id);
-  const ENode& node = eclass.nodes.at(index);
+  // Caching the cost may have replaced the e-class if it was shared with
+  // another e-graph so we need to look it up again here.
+  const ENode& node = graph->get(id)->nodes.at(index);
 
   llvm::SmallVector<OpRef, 4> operands;
   operands.reserve(node.operands.size());
@@ -1,8 +1,9 @@
 #include "caffeine/IR/EGraph.h"
 #include "caffeine/IR/OperationData.h"
+#include "caffeine/IR/Value.h"
 #include <optional>
-#include <queue>
 #include <type_traits>
+#include <utility>
 
 namespace caffeine {
 
@@ -14,15 +15,25 @@ public:
     if (id != egraph->find(id))
       return;
 
-    if (constants.contains(id))
+    const EClass& eclass = *std::as_const(*egraph).get(id);
+    if (eclass.is_constant())
       return;
 
-    EClass& eclass = *egraph->get(id);
+    // The analysis may show that the e-class only has one possible value even
+    // if none of its e-nodes have constant operands.
+    if (eclass.analysis) {
+      if (std::optional<llvm::APInt> value = eclass.analysis->constant()) {
+        size_t constant =
+            egraph->add(ENode{std::make_shared<ConstantIntData>(*value)});
+        id = egraph->merge(constant, id);
+        egraph->worklist.push_back(id);
+        return;
+      }
+    }
 
-    for (ENode& node : eclass.nodes) {
+    for (const ENode& node : eclass.nodes) {
       if (auto merged = tryFoldNode(node)) {
         id = egraph->merge(*merged, id);
-        constants.insert(id);
         egraph->worklist.push_back(id);
         break;
       }
@@ -43,10 +54,10 @@ private:
       case Operation::Add:  INT_FOLD(args[0] + args[1]);
       case Operation::Sub:  INT_FOLD(args[0] - args[1]);
       case Operation::Mul:  INT_FOLD(args[0] * args[1]);
-      case Operation::UDiv: INT_FOLD(args[1] == 0 ? args[0].udiv(args[1]) : args[1]);
-      case Operation::SDiv: INT_FOLD(args[1] == 0 ? args[0].sdiv(args[1]) : args[1]);
-      case Operation::URem: INT_FOLD(args[1] == 0 ? args[0].urem(args[1]) : args[1]);
-      case Operation::SRem: INT_FOLD(args[1] == 0 ? args[0].srem(args[1]) : args[1]);
+      case Operation::UDiv: INT_FOLD(Value::bvudiv(args[0], args[1]).apint());
+      case Operation::SDiv: INT_FOLD(Value::bvsdiv(args[0], args[1]).apint());
+      case Operation::URem: INT_FOLD(Value::bvurem(args[0], args[1]).apint());
+      case Operation::SRem: INT_FOLD(Value::bvsrem(args[0], args[1]).apint());
 
       case Operation::And:  INT_FOLD(args[0] & args[1]);
       case Operation::Or:   INT_FOLD(args[0] | args[1]);
@@ -71,6 +82,8 @@ private:
       case Operation::ZExt:  INT_FOLD(args[0].zext(node.type().bitwidth()));
       case Operation::SExt:  INT_FOLD(args[0].sext(node.type().bitwidth()));
       case Operation::Trunc: INT_FOLD(args[0].trunc(node.type().bitwidth()));
+
+      case Operation::Select: return foldSelect(node);
       // clang-format on
 
     default:
@@ -78,14 +91,15 @@ private:
     }
   }
   std::optional<size_t> foldSelect(const ENode& node) {
-    if (!constants.contains(egraph->find(node.operands[0])))
+    const EClass* cond = std::as_const(*egraph).get(node.operands[0]);
+    if (!cond->analysis)
+      return std::nullopt;
+
+    std::optional<llvm::APInt> value = cond->analysis->constant();
+    if (!value)
       return std::nullopt;
 
-    bool value = llvm::cast<ConstantIntData>(
-                     egraph->get(node.operands[0])->nodes.at(0).data.get())
-                     ->value()
-                     .getBoolValue();
-    return value ? node.operands[1] : node.operands[2];
+    return value->getBoolValue() ? node.operands[1] : node.operands[2];
   }
 
   template <typename F>
@@ -111,7 +125,7 @@ private:
   std::optional<R> tryFoldConstIntOperands(const ENode& node, F&& func) {
     bool operands_are_constant = std::all_of(
         node.operands.begin(), node.operands.end(), [&](size_t operand) {
-          return constants.contains(egraph->find(operand));
+          return std::as_const(*egraph).get(operand)->is_constant();
         });
 
     if (!operands_are_constant)
@@ -121,13 +135,13 @@ private:
     operands.reserve(node.operands.size());
 
     for (size_t opid : node.operands) {
-      EClass* operand = egraph->get(opid);
+      const EClass* operand = std::as_const(*egraph).get(opid);
 
       CAFFEINE_ASSERT(operand);
       CAFFEINE_ASSERT(operand->is_constant());
 
       operands.push_back(
-          llvm::cast<ConstantIntData>(operand->nodes.at(0).data.get())
+          llvm::cast<ConstantIntData>(operand->constant()->data.get())
               ->value());
     }
 
@@ -136,29 +150,17 @@ private:
 
 public:
   EGraph* egraph;
-  tsl::hopscotch_set<size_t> constants;
 };
 
 void EGraph::constprop() {
   EGraphConstantPropagator propagator{this};
-  std::queue<size_t> queue;
-
-  for (auto it = classes.begin(); it != classes.end(); ++it) {
-    auto& [id, eclass] = *it;
-
-    if (eclass.is_constant()) {
-      propagator.constants.insert(id);
-    } else {
-      queue.push(id);
-    }
-  }
-
-  while (!queue.empty()) {
-    size_t id = queue.front();
-    queue.pop();
 
+  // Only e-classes that have changed since the last round of simplification
+  // can have become foldable. Parents of e-classes that get folded here will
+  // be marked as updated by the next rebuild and visited by the next call.
+  immer::set<size_t> pending = updated;
+  for (size_t id : pending)
     propagator.visit(id);
-  }
 }
 
 } // namespace caffeine
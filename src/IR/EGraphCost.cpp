@@ -0,0 +1,211 @@
+#include "caffeine/IR/EGraphCost.h"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+namespace caffeine {
+
+namespace {
+  using Opcode = Operation::Opcode;
+
+  struct OpcodeName {
+    Opcode opcode;
+    std::string_view name;
+  };
+
+  constexpr OpcodeName opcode_names[] = {
+#define HANDLE_FULL_OP(opcode, opname, opclass, op_base, op_nargs, op_aux)     \
+  {Operation::opcode, #opcode},
+#include "caffeine/IR/Operation.def"
+  };
+
+  // Symbolic constants are expensive, better to use a large non-symbolic
+  // expression instead.
+  constexpr uint64_t symbolic_cost = 1 << 16;
+
+  bool is_symbolic(Opcode opcode) {
+    switch (opcode) {
+    case Opcode::ConstantNamed:
+    case Opcode::ConstantNumbered:
+    case Opcode::ConstantArray:
+      return true;
+    default:
+      return false;
+    }
+  }
+} // namespace
+
+/***************************************************
+ * ExtractionCostModel                             *
+ ***************************************************/
+uint32_t ExtractionCostModel::type_bitwidth(const Type& type) {
+  if (type.is_int() || type.is_array())
+    return type.bitwidth();
+  if (type.is_float())
+    return type.exponent_bits() + type.mantissa_bits();
+  return 0;
+}
+
+std::shared_ptr<const ExtractionCostModel>
+ExtractionCostModel::default_model() {
+  static const auto model = std::make_shared<const UniformCostModel>();
+  return model;
+}
+
+/***************************************************
+ * UniformCostModel                                *
+ ***************************************************/
+uint64_t UniformCostModel::cost(Operation::Opcode opcode, uint32_t) const {
+  return is_symbolic(opcode) ? symbolic_cost : 1;
+}
+
+/***************************************************
+ * WeightedCostModel                               *
+ ***************************************************/
+bool WeightedCostModel::Weight::operator==(const Weight& other) const {
+  return base == other.base && per_bit == other.per_bit;
+}
+bool WeightedCostModel::Weight::operator!=(const Weight& other) const {
+  return !(*this == other);
+}
+
+WeightedCostModel::WeightedCostModel() : fallback{1.0, 1.0 / 64} {
+  // Concrete constants cost the same no matter how wide they are.
+  for (Opcode opcode : {Opcode::ConstantInt, Opcode::ConstantFloat,
+                        Opcode::FunctionObject, Opcode::Undef})
+    weights[opcode] = {1.0, 0.0};
+
+  // Bit-blasting these produces circuits whose size grows faster than
+  // linearly in the bitwidth, which makes them much harder for the solver than
+  // additions or bitwise operations.
+  weights[Opcode::Mul] = {1.0, 1.0 / 4};
+  for (Opcode opcode :
+       {Opcode::UDiv, Opcode::SDiv, Opcode::URem, Opcode::SRem})
+    weights[opcode] = {1.0, 1.0 / 2};
+  for (Opcode opcode : {Opcode::Shl, Opcode::LShr, Opcode::AShr})
+    weights[opcode] = {1.0, 1.0 / 16};
+
+  for (Opcode opcode : {Opcode::FAdd, Opcode::FSub, Opcode::FMul, Opcode::FDiv,
+                        Opcode::FRem})
+    weights[opcode] = {4.0, 1.0 / 2};
+
+  for (Opcode opcode : {Opcode::Load, Opcode::Store, Opcode::LoadLE,
+                        Opcode::LoadBE, Opcode::StoreLE, Opcode::StoreBE})
+    weights[opcode] = {4.0, 1.0 / 16};
+}
+
+uint64_t WeightedCostModel::cost(Operation::Opcode opcode,
+                                 uint32_t bitwidth) const {
+  if (is_symbolic(opcode))
+    return symbolic_cost;
+
+  const Weight& w = weight(opcode);
+  double value = std::round(w.base + w.per_bit * bitwidth);
+
+  // Nothing should end up being more expensive than a symbolic constant
+  // otherwise extraction would start preferring them.
+  if (!(value < symbolic_cost))
+    return symbolic_cost - 1;
+  return std::max<uint64_t>(static_cast<uint64_t>(value), 1);
+}
+
+const WeightedCostModel::Weight&
+WeightedCostModel::weight(Operation::Opcode opcode) const {
+  auto it = weights.find(opcode);
+  if (it == weights.end())
+    return fallback;
+  return it->second;
+}
+void WeightedCostModel::set_weight(Operation::Opcode opcode,
+                                   const Weight& weight) {
+  weights[opcode] = weight;
+}
+
+const WeightedCostModel::Weight& WeightedCostModel::default_weight() const {
+  return fallback;
+}
+void WeightedCostModel::set_default_weight(const Weight& weight) {
+  fallback = weight;
+}
+
+std::optional<WeightedCostModel> WeightedCostModel::load(std::istream& is,
+                                                         std::string& error) {
+  WeightedCostModel model;
+  std::string line;
+
+  for (size_t lineno = 1; std::getline(is, line); ++lineno) {
+    line = line.substr(0, line.find('#'));
+
+    std::istringstream ss(line);
+    std::string name;
+    if (!(ss >> name))
+      continue;
+
+    Weight weight;
+    std::string rest;
+    if (!(ss >> weight.base >> weight.per_bit) || (ss >> rest)) {
+      error = fmt::format("line {}: expected '<opcode> <base> <per-bit>'",
+                          lineno);
+      return std::nullopt;
+    }
+
+    if (!std::isfinite(weight.base) || !std::isfinite(weight.per_bit) ||
+        weight.base < 0.0 || weight.per_bit < 0.0) {
+      error = fmt::format("line {}: weights must be non-negative", lineno);
+      return std::nullopt;
+    }
+
+    if (name == "default") {
+      model.set_default_weight(weight);
+      continue;
+    }
+
+    auto opcode = parse_opcode(name);
+    if (!opcode) {
+      error = fmt::format("line {}: unknown opcode '{}'", lineno, name);
+      return std::nullopt;
+    }
+
+    model.set_weight(*opcode, weight);
+  }
+
+  return model;
+}
+
+void WeightedCostModel::save(std::ostream& os) const {
+  fmt::print(os, "# <opcode> <base> <per-bit>\n");
+  fmt::print(os, "default {} {}\n", fallback.base, fallback.per_bit);
+
+  for (const auto& [opcode, name] : opcode_names) {
+    auto it = weights.find(opcode);
+    if (it == weights.end())
+      continue;
+
+    fmt::print(os, "{} {} {}\n", name, it->second.base, it->second.per_bit);
+  }
+}
+
+std::string_view WeightedCostModel::opcode_name(Operation::Opcode opcode) {
+  for (const auto& entry : opcode_names) {
+    if (entry.opcode == opcode)
+      return entry.name;
+  }
+
+  return "Unknown";
+}
+
+std::optional<Operation::Opcode>
+WeightedCostModel::parse_opcode(std::string_view name) {
+  for (const auto& entry : opcode_names) {
+    if (entry.name == name)
+      return entry.opcode;
+  }
+
+  return std::nullopt;
+}
+
+} // namespace caffeine
@@ -3,12 +3,16 @@
 #include "caffeine/IR/EGraph.h"
 #include "caffeine/IR/EGraphMatching.h"
 #include "caffeine/IR/OperationBase.h"
-#include <boost/range/combine.hpp>
-#include <boost/range/join.hpp>
+#include "caffeine/Support/Tracing.h"
+#include <atomic>
+#include <chrono>
 #include <fmt/format.h>
 #include <magic_enum.hpp>
+#include <string>
 #include <tsl/hopscotch_map.h>
+#include <tsl/hopscotch_set.h>
 #include <unordered_map>
+#include <utility>
 
 namespace caffeine {
 
@@ -24,28 +28,44 @@ public:
 
   const EMatcher* matcher;
   EGraph* egraph;
+  const SaturationBudget* budget;
 
-  // Map of clause -> eclass -> node index
-  std::unordered_map<size_t, std::unordered_multimap<size_t, size_t>>
-      potentials = {};
-  // Map of eclass -> clause
-  // Used to remove matches from an updated clause
-  std::unordered_map<size_t, std::vector<size_t>> reversed = {};
+  // Map of subclause -> eclass -> node index for all the (subclause, eclass)
+  // pairs that have been checked during the current iteration.
+  MatchData::MapData matches = {};
+  // The e-classes that have been checked against each subclause during the
+  // current iteration, whether they matched or not.
+  std::vector<tsl::hopscotch_set<size_t>> checked = {};
 
   // Map containing all subclauses that are captured.
   GraphAccessor::CapturesMap captures = {};
 
 public:
   void equality_saturation() {
+    auto block = CAFFEINE_TRACE_SPAN("EGraph::simplify");
+    auto start = std::chrono::steady_clock::now();
+    size_t start_classes = egraph->classes.size();
+    size_t iterations = 0;
+
     egraph->constprop();
     egraph->rebuild();
 
     while (!egraph->updated.empty()) {
-      update_potential_matches();
+      if (const char* reason = exhausted(iterations, start, start_classes)) {
+        // Whatever is left in the updated set will be picked up by the next
+        // call to simplify.
+        uint64_t hits = budget_hits.fetch_add(1, std::memory_order_relaxed);
+        block.annotate("budget_exhausted", reason);
+        block.annotate("budget_hits", std::to_string(hits + 1));
+        break;
+      }
+
+      iterations += 1;
+
       auto data = find_matches();
       auto work = matching_work_items(data);
 
-      egraph->updated.clear();
+      egraph->updated = {};
 
       GraphAccessor accessor(egraph, &data, &captures);
 
@@ -63,96 +83,127 @@ public:
       egraph->constprop();
       egraph->rebuild();
     }
-  }
-
-  // Methods for setting up potential matches
-  // ========================================
 
-  // Build the initial set of potential matches for the given e-class.
-  void update_eclass_potential_matches(size_t eclass_id) {
-    const EClass& eclass = *egraph->get(eclass_id);
+    block.annotate("iterations", std::to_string(iterations));
+  }
 
-    for (size_t clause_id : reversed[eclass_id]) {
-      potentials[clause_id].erase(eclass_id);
-    }
+  // Returns a description of the exhausted limit if the budget has been used
+  // up, or nullptr otherwise.
+  const char* exhausted(size_t iterations,
+                        std::chrono::steady_clock::time_point start,
+                        size_t start_classes) const {
+    if (budget->max_iterations != 0 && iterations >= budget->max_iterations)
+      return "iterations";
+    // Classes can be merged away so the graph may have shrunk since the
+    // start of this call.
+    if (budget->max_classes != 0 && egraph->classes.size() > start_classes &&
+        egraph->classes.size() - start_classes >= budget->max_classes)
+      return "classes";
+    if (budget->max_time != std::chrono::milliseconds::zero() &&
+        std::chrono::steady_clock::now() - start >= budget->max_time)
+      return "time";
+    return nullptr;
+  }
 
-    // Don't calculate any potential matches for e-classes which have expired.
-    if (egraph->find(eclass_id) != eclass_id)
-      return;
+  static std::atomic<uint64_t> budget_hits;
 
-    for (size_t node_id = 0; node_id < eclass.nodes.size(); ++node_id) {
-      const ENode& node = eclass.nodes[node_id];
+  // Methods for finding matches
+  // ===========================
 
-      for (size_t clause_id :
-           boost::range::join(matching_clauses(Operation::Invalid),
-                              matching_clauses(node.opcode()))) {
-        const EMatchSubClause& clause = matcher->subclauses[clause_id];
+  // Check whether a single e-node matches the subclause. Submatchers are
+  // checked against the e-classes of the operands through match.
+  bool match_node(const EMatchSubClause& subclause, const ENode& node) {
+    if (!subclause.is_potential_match(node))
+      return false;
+    if (subclause.submatchers.empty())
+      return true;
+    if (subclause.submatchers.size() != node.operands.size())
+      return false;
 
-        if (clause.is_potential_match(node)) {
-          potentials[clause_id].emplace(eclass_id, node_id);
-          reversed[eclass_id].push_back(clause_id);
-        }
-      }
+    for (size_t i = 0; i < node.operands.size(); ++i) {
+      if (!match(subclause.submatchers[i], node.operands[i]))
+        return false;
     }
+
+    return true;
   }
 
-  void update_potential_matches() {
-    if (potentials.empty()) {
-      for (const auto& [eclass, _] : egraph->classes)
-        update_eclass_potential_matches(eclass);
-    } else {
-      for (size_t eclass : egraph->updated)
-        update_eclass_potential_matches(eclass);
+  // Check whether any nodes within the e-class match the subclause and record
+  // them within matches.
+  //
+  // Only e-classes that are reachable from an updated e-class are ever looked
+  // at so the cost of an iteration is proportional to the size of the region
+  // of the e-graph that changed, not the size of the whole e-graph.
+  bool match(size_t subclause_id, size_t eclass_id) {
+    auto& clause_matches = matches[subclause_id];
+    if (!checked[subclause_id].insert(eclass_id).second)
+      return clause_matches.find(eclass_id) != clause_matches.end();
+
+    const EMatchSubClause& subclause = matcher->subclauses[subclause_id];
+    const EClass& eclass = *std::as_const(*egraph).get(eclass_id);
+    std::vector<size_t> found;
+
+    for (size_t node_id = 0; node_id < eclass.nodes.size(); ++node_id) {
+      if (match_node(subclause, eclass.nodes[node_id]))
+        found.push_back(node_id);
     }
-  }
 
-  // Find all matching subclauses and build an EMatcherData structure for them.
-  EMatcherData find_matches() {
-    MatchData::MapData matches;
-    matches.reserve(matcher->clauses.size());
+    if (found.empty())
+      return false;
 
-    for (size_t clause_id = 0; clause_id < matcher->subclauses.size();
-         ++clause_id) {
-      MatchData::ClauseData clause_matches;
+    clause_matches.emplace(eclass_id, std::move(found));
+    return true;
+  }
 
-      auto pit = potentials.find(clause_id);
-      if (pit == potentials.end()) {
-        matches.push_back(std::move(clause_matches));
-        continue;
+  // Match all the top-level subclauses against an e-class in a single pass
+  // over its e-nodes. Each e-node is only checked against the top-level
+  // subclauses that the matcher's dispatch table gives for its opcode.
+  void match_roots(size_t eclass_id) {
+    const EClass& eclass = *std::as_const(*egraph).get(eclass_id);
+
+    // All subclauses are marked as checked before looking at any e-nodes so
+    // that cycles back to this e-class behave the same as they do in match.
+    tsl::hopscotch_map<size_t, std::vector<size_t>> found;
+    for (const ENode& node : eclass.nodes) {
+      for (size_t root : matcher->roots(node.opcode())) {
+        if (checked[root].insert(eclass_id).second)
+          found.emplace(root, std::vector<size_t>());
       }
+    }
 
-      const auto& clause = matcher->subclauses[clause_id];
-      const auto& potentials = pit->second;
-
-      for (const auto& [eclass_id, enode_id] : potentials) {
-        const EClass& eclass = *egraph->get(eclass_id);
-        const ENode& enode = eclass.nodes.at(enode_id);
+    if (found.empty())
+      return;
 
-        if (!clause.submatchers.empty()) {
-          if (clause.submatchers.size() != enode.operands.size())
-            continue;
+    for (size_t node_id = 0; node_id < eclass.nodes.size(); ++node_id) {
+      const ENode& node = eclass.nodes[node_id];
 
-          for (auto value :
-               boost::range::combine(clause.submatchers, enode.operands)) {
-            auto subclause = boost::get<0>(value);
-            auto operand = boost::get<1>(value);
+      for (size_t root : matcher->roots(node.opcode())) {
+        auto it = found.find(root);
+        if (it == found.end())
+          continue;
 
-            if (matches.size() <= subclause)
-              goto do_continue;
+        if (match_node(matcher->subclauses[root], node))
+          it.value().push_back(node_id);
+      }
+    }
 
-            const auto& submatches = matches.at(subclause);
-            if (submatches.find(operand) == submatches.end())
-              goto do_continue;
-          }
-        }
+    for (auto it = found.begin(); it != found.end(); ++it) {
+      if (!it->second.empty())
+        matches[it->first].emplace(eclass_id, std::move(it.value()));
+    }
+  }
 
-        clause_matches[eclass_id].push_back(enode_id);
+  // Find all top-level clauses matching the e-classes that have been updated
+  // since the last iteration and build an EMatcherData structure for them.
+  EMatcherData find_matches() {
+    matches.assign(matcher->subclauses.size(), {});
+    checked.assign(matcher->subclauses.size(), {});
 
-      do_continue:
+    for (size_t eclass_id : egraph->updated) {
+      if (egraph->find(eclass_id) != eclass_id)
         continue;
-      }
 
-      matches.push_back(std::move(clause_matches));
+      match_roots(eclass_id);
     }
 
     return EMatcherData(std::move(matches));
@@ -173,11 +224,11 @@ public:
       for (const auto& [eclass_id, enodes] : matches) {
         if (egraph->find(eclass_id) != eclass_id)
           continue;
-        if (!egraph->updated.contains(eclass_id))
+        if (!egraph->updated.count(eclass_id))
           continue;
 
         for (size_t enode_id : enodes) {
-          const EClass* eclass = egraph->get(eclass_id);
+          const EClass* eclass = std::as_const(*egraph).get(eclass_id);
           const ENode& enode = eclass->nodes[enode_id];
 
           if (subclause.opcode != Operation::Invalid) {
@@ -198,13 +249,6 @@ public:
     return top_level;
   }
 
-  llvm::ArrayRef<size_t> matching_clauses(Operation::Opcode opcode) const {
-    auto it = matcher->subindex.find(opcode);
-    if (it == matcher->subindex.end())
-      return {};
-    return it->second;
-  }
-
   // Iterate through all combinations of captures and, for each one, call the
   // provided function once the captures map has all the required types.
   //
@@ -213,7 +257,7 @@ public:
   // down to 1 match.
   void all_captures(size_t subclause_id, size_t eclass_id, size_t enode_id,
                     const EMatcherData& data, function_view<void()> func) {
-    const EClass* eclass = egraph->get(eclass_id);
+    const EClass* eclass = std::as_const(*egraph).get(eclass_id);
     const ENode* enode = &eclass->nodes.at(enode_id);
     const SubClause& subclause = matcher->subclause(subclause_id);
 
@@ -249,7 +293,7 @@ public:
     }
 
     const SubClause& subclause = matcher->subclause(subclause_id);
-    const EClass* eclass = egraph->get(eclass_id);
+    const EClass* eclass = std::as_const(*egraph).get(eclass_id);
 
     auto matches = data.matches(subclause_id, eclass_id);
 
@@ -286,8 +330,17 @@ public:
   }
 };
 
+std::atomic<uint64_t> EGraphMatcher::budget_hits{0};
+
+uint64_t ematching::SaturationBudget::exhausted_count() {
+  return EGraphMatcher::budget_hits.load(std::memory_order_relaxed);
+}
+
 void EGraph::simplify(const EMatcher& matcher) {
-  EGraphMatcher g{&matcher, this};
+  simplify(matcher, SaturationBudget());
+}
+void EGraph::simplify(const EMatcher& matcher, const SaturationBudget& budget) {
+  EGraphMatcher g{&matcher, this, &budget};
   g.equality_saturation();
 }
 
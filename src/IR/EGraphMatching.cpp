@@ -1,7 +1,9 @@
 #include "caffeine/IR/EGraphMatching.h"
 #include "caffeine/IR/EGraph.h"
 #include "caffeine/IR/Operation.h"
+#include <algorithm>
 #include <fmt/format.h>
+#include <utility>
 
 namespace caffeine::ematching {
 
@@ -104,7 +106,7 @@ size_t GraphAccessor::merge(size_t id1, size_t id2) {
 }
 
 const EClass* GraphAccessor::get(size_t eclass) const {
-  return egraph->get(eclass);
+  return std::as_const(*egraph).get(eclass);
 }
 
 OpRef GraphAccessor::get_op(size_t eclass_id) const {
@@ -205,9 +207,25 @@ EMatcher EMatcherBuilder::build() {
 
   matcher.clauses = std::move(clauses);
 
-  for (size_t i = 0; i < matcher.subclauses.size(); ++i) {
-    const SubClause& clause = matcher.subclauses[i];
-    matcher.subindex[clause.opcode].push_back(i);
+  std::vector<size_t> roots;
+  roots.reserve(matcher.clauses.size());
+  for (const Clause& clause : matcher.clauses)
+    roots.push_back(clause.matcher);
+
+  std::sort(roots.begin(), roots.end());
+  roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+
+  for (size_t root : roots) {
+    Operation::Opcode opcode = matcher.subclauses[root].opcode;
+    if (opcode == Operation::Invalid)
+      matcher.wildcard_roots.push_back(root);
+    else
+      matcher.dispatch[opcode].push_back(root);
+  }
+
+  for (auto& [opcode, entry] : matcher.dispatch) {
+    entry.insert(entry.end(), matcher.wildcard_roots.begin(),
+                 matcher.wildcard_roots.end());
   }
 
   return matcher;
@@ -224,4 +242,11 @@ const SubClause& EMatcher::subclause(size_t subclause) const {
   return subclauses.at(subclause);
 }
 
+llvm::ArrayRef<size_t> EMatcher::roots(Operation::Opcode opcode) const {
+  auto it = dispatch.find(opcode);
+  if (it == dispatch.end())
+    return wildcard_roots;
+  return it->second;
+}
+
 } // namespace caffeine::ematching
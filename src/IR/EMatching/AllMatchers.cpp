@@ -79,6 +79,8 @@ void EMatcherBuilder::add_defaults() {
   reductions::trunc_zext_elimination(*this);
   reductions::select_constprop(*this);
   reductions::load_store_elimination(*this);
+  reductions::multi_load_store_elimination(*this);
+  reductions::load_multi_store_elimination(*this);
 }
 
 } // namespace caffeine::ematching
@@ -1,8 +1,84 @@
 #include "caffeine/IR/EGraph.h"
 #include "caffeine/IR/EGraphMatching.h"
+#include "caffeine/IR/MemoryRange.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/OperationData.h"
+#include <vector>
 
 namespace caffeine::ematching::reductions {
 
+namespace {
+  const llvm::APInt* constant_offset(GraphAccessor& egraph, size_t eclass) {
+    const ENode* node = egraph.get(eclass)->constant();
+    if (!node)
+      return nullptr;
+    if (const auto* data = llvm::dyn_cast<ConstantIntData>(node->data.get()))
+      return &data->value();
+    return nullptr;
+  }
+
+  bool is_multi_store(Operation::Opcode opcode) {
+    return opcode == Operation::StoreLE || opcode == Operation::StoreBE;
+  }
+
+  // The number of bytes written by a (possibly multi-byte) store.
+  uint32_t store_bytes(GraphAccessor& egraph, const ENode& store) {
+    if (store.opcode() == Operation::Store)
+      return 1;
+    return egraph.get(store.operands[2])->type().bitwidth() / 8;
+  }
+
+  // (loadN (storeN ?a ?b ?c) ?b) -> ?c
+  // (loadN (store[N] ?a ?b ?c) ?d) -> (loadN ?a ?d) if ?b and ?d are constants
+  //                                  and the stored and loaded bytes don't
+  //                                  overlap
+  void multi_load_elimination(EMatcherBuilder& builder,
+                              Operation::Opcode load_opcode,
+                              Operation::Opcode store_opcode) {
+    size_t load = builder.add_clause(load_opcode);
+
+    auto matcher = [=](GraphAccessor& egraph, size_t eclass_id,
+                       size_t node_id) {
+      // Copy everything out before modifying the e-graph since adding new
+      // e-nodes may invalidate references into it.
+      ENode load_enode = egraph.get(eclass_id)->nodes.at(node_id);
+      std::vector<ENode> stores = egraph.get(load_enode.operands[0])->nodes;
+
+      EGraph* graph = egraph.graph();
+      const llvm::APInt* offset =
+          constant_offset(egraph, load_enode.operands[1]);
+      uint32_t num_bytes = load_enode.type().bitwidth() / 8;
+
+      for (const ENode& store : stores) {
+        if (store.opcode() != Operation::Store &&
+            !is_multi_store(store.opcode()))
+          continue;
+
+        if (store.opcode() == store_opcode &&
+            graph->find(store.operands[1]) ==
+                graph->find(load_enode.operands[1]) &&
+            egraph.get(store.operands[2])->type() == load_enode.type()) {
+          egraph.merge(eclass_id, store.operands[2]);
+          continue;
+        }
+
+        const llvm::APInt* store_offset =
+            constant_offset(egraph, store.operands[1]);
+        if (!offset || !store_offset ||
+            !is_disjoint(*offset, num_bytes, *store_offset,
+                         store_bytes(egraph, store)))
+          continue;
+
+        egraph.add_merge(eclass_id,
+                         ENode{load_enode.data,
+                               {store.operands[0], load_enode.operands[1]}});
+      }
+    };
+
+    builder.add_matcher(load, matcher);
+  }
+} // namespace
+
 // (load (store ?a ?b ?c) ?d) -> (select (icmp.eq ?b ?d) ?c (load ?a ?d))
 void load_store_elimination(EMatcherBuilder& builder) {
   size_t any = builder.add_any();
@@ -32,4 +108,59 @@ void load_store_elimination(EMatcherBuilder& builder) {
   builder.add_matcher(load, matcher);
 }
 
+void multi_load_store_elimination(EMatcherBuilder& builder) {
+  multi_load_elimination(builder, Operation::LoadLE, Operation::StoreLE);
+  multi_load_elimination(builder, Operation::LoadBE, Operation::StoreBE);
+}
+
+// (load (storeN ?a ?b ?c) ?d) -> (trunc.i8 (lshr ?c k)) if ?b and ?d are
+//                                constants and ?d is within the stored bytes
+//                             -> (load ?a ?d) if ?b and ?d are constants and
+//                                ?d is outside of the stored bytes
+void load_multi_store_elimination(EMatcherBuilder& builder) {
+  size_t load = builder.add_clause(Operation::Load);
+
+  auto matcher = [=](GraphAccessor& egraph, size_t eclass_id, size_t node_id) {
+    ENode load_enode = egraph.get(eclass_id)->nodes.at(node_id);
+    const llvm::APInt* offset =
+        constant_offset(egraph, load_enode.operands[1]);
+    if (!offset)
+      return;
+
+    std::vector<ENode> stores = egraph.get(load_enode.operands[0])->nodes;
+    for (const ENode& store : stores) {
+      if (!is_multi_store(store.opcode()))
+        continue;
+
+      const llvm::APInt* store_offset =
+          constant_offset(egraph, store.operands[1]);
+      if (!store_offset ||
+          store_offset->getBitWidth() != offset->getBitWidth())
+        continue;
+
+      uint32_t num_bytes = store_bytes(egraph, store);
+      llvm::APInt index = *offset - *store_offset;
+
+      if (index.uge(num_bytes)) {
+        egraph.add_merge(eclass_id,
+                         ENode{load_enode.data,
+                               {store.operands[0], load_enode.operands[1]}});
+        continue;
+      }
+
+      uint64_t byte = store.opcode() == Operation::StoreLE
+                          ? index.getZExtValue()
+                          : num_bytes - 1 - index.getZExtValue();
+      egraph.add_merge(
+          eclass_id,
+          UnaryOp::CreateTrunc(
+              Type::int_ty(8),
+              BinaryOp::CreateLShr(egraph.get_op(store.operands[2]),
+                                   byte * 8)));
+    }
+  };
+
+  builder.add_matcher(load, matcher);
+}
+
 } // namespace caffeine::ematching::reductions
@@ -0,0 +1,367 @@
+#include "caffeine/IR/IntAnalysis.h"
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/IR/OperationData.h"
+#include "caffeine/Support/Assert.h"
+#include <algorithm>
+#include <utility>
+
+namespace caffeine {
+
+IntAnalysis::IntAnalysis(uint32_t bitwidth)
+    : known_zero(bitwidth, 0), known_one(bitwidth, 0),
+      range(bitwidth, /*isFullSet=*/true) {}
+IntAnalysis::IntAnalysis(const llvm::APInt& value)
+    : known_zero(~value), known_one(value), range(value) {}
+IntAnalysis::IntAnalysis(const llvm::APInt& known_zero,
+                         const llvm::APInt& known_one,
+                         const llvm::ConstantRange& range)
+    : known_zero(known_zero), known_one(known_one), range(range) {}
+
+uint32_t IntAnalysis::bitwidth() const {
+  return range.getBitWidth();
+}
+
+std::optional<llvm::APInt> IntAnalysis::constant() const {
+  if (const llvm::APInt* value = range.getSingleElement())
+    return *value;
+  if ((known_zero | known_one).isAllOnesValue())
+    return known_one;
+  return std::nullopt;
+}
+
+bool IntAnalysis::is_contradiction() const {
+  return known_zero.intersects(known_one) || range.isEmptySet();
+}
+
+void IntAnalysis::normalize() {
+  if (is_contradiction())
+    return;
+
+  // Every possible value is within [known_one, ~known_zero].
+  llvm::APInt max = ~known_zero;
+  if (!known_one.isNullValue() || !max.isAllOnesValue())
+    range = range.intersectWith(llvm::ConstantRange(known_one, max + 1));
+
+  if (range.isEmptySet())
+    return;
+
+  // All values within the range share the leading bits that are common to the
+  // smallest and largest values.
+  llvm::APInt umin = range.getUnsignedMin();
+  llvm::APInt umax = range.getUnsignedMax();
+  uint32_t prefix = (umin ^ umax).countLeadingZeros();
+  llvm::APInt common = llvm::APInt::getHighBitsSet(bitwidth(), prefix);
+
+  known_one |= umin & common;
+  known_zero |= ~umin & common;
+}
+
+bool IntAnalysis::refine(const IntAnalysis& other) {
+  CAFFEINE_ASSERT(bitwidth() == other.bitwidth());
+
+  IntAnalysis result{known_zero | other.known_zero, known_one | other.known_one,
+                     range.intersectWith(other.range)};
+  result.normalize();
+
+  if (result.is_contradiction())
+    return false;
+
+  // The intersection of two wrapping ranges is not always a subset of both of
+  // them. Only taking strictly smaller ranges ensures that repeatedly refining
+  // an analysis always terminates.
+  if (!result.range.isSizeStrictlySmallerThan(range))
+    result.range = range;
+
+  if (result == *this)
+    return false;
+
+  *this = std::move(result);
+  return true;
+}
+
+// The number of low bits that are known in the analysis.
+static uint32_t known_low_bits(const IntAnalysis& value) {
+  return (value.known_zero | value.known_one).countTrailingOnes();
+}
+
+template <typename F>
+static void fold_low_bits(IntAnalysis& result, const IntAnalysis& lhs,
+                          const IntAnalysis& rhs, F&& func) {
+  // Carries only propagate upwards so the low bits that are known in both
+  // operands are also known in the result.
+  uint32_t known = std::min(known_low_bits(lhs), known_low_bits(rhs));
+  llvm::APInt mask = llvm::APInt::getLowBitsSet(result.bitwidth(), known);
+  llvm::APInt value = func(lhs.known_one, rhs.known_one);
+
+  result.known_one |= value & mask;
+  result.known_zero |= ~value & mask;
+}
+
+// Division and remainder by zero follow SMT-LIB semantics (see Value::bvudiv
+// and Value::bvurem) so the range operations, which ignore a zero divisor, need
+// to be extended with the possible results of dividing by zero.
+static llvm::ConstantRange with_zero_divisor(const llvm::ConstantRange& result,
+                                             const IntAnalysis& divisor,
+                                             const llvm::ConstantRange& extra) {
+  if (!divisor.range.contains(llvm::APInt::getNullValue(divisor.bitwidth())))
+    return result;
+  return result.unionWith(extra);
+}
+
+static IntAnalysis resize(const IntAnalysis& value, uint32_t bitwidth,
+                          Operation::Opcode opcode) {
+  if (value.bitwidth() == bitwidth)
+    return value;
+
+  IntAnalysis result{bitwidth};
+  switch (opcode) {
+  case Operation::Trunc:
+    result.known_zero = value.known_zero.trunc(bitwidth);
+    result.known_one = value.known_one.trunc(bitwidth);
+    result.range = value.range.truncate(bitwidth);
+    break;
+  case Operation::ZExt:
+    result.known_zero = value.known_zero.zext(bitwidth);
+    result.known_zero.setBitsFrom(value.bitwidth());
+    result.known_one = value.known_one.zext(bitwidth);
+    result.range = value.range.zeroExtend(bitwidth);
+    break;
+  case Operation::SExt:
+    // If the sign bit is unknown then it is clear in both and so the new high
+    // bits are unknown as well.
+    result.known_zero = value.known_zero.sext(bitwidth);
+    result.known_one = value.known_one.sext(bitwidth);
+    result.range = value.range.signExtend(bitwidth);
+    break;
+  default:
+    CAFFEINE_UNREACHABLE();
+  }
+
+  return result;
+}
+
+std::optional<IntAnalysis>
+IntAnalysis::evaluate(const ENode& node,
+                      llvm::ArrayRef<const IntAnalysis*> operands) {
+  Type type = node.type();
+  if (!type.is_int())
+    return std::nullopt;
+
+  uint32_t bitwidth = type.bitwidth();
+  if (const auto* data = llvm::dyn_cast<ConstantIntData>(node.data.get()))
+    return IntAnalysis(data->value());
+
+  IntAnalysis result{bitwidth};
+  if (operands.empty() ||
+      std::any_of(operands.begin(), operands.end(),
+                  [](const IntAnalysis* operand) { return !operand; }))
+    return result;
+
+  const IntAnalysis& lhs = *operands[0];
+  const IntAnalysis& rhs = operands.size() > 1 ? *operands[1] : lhs;
+
+  switch (node.opcode()) {
+  case Operation::Add:
+    result.range = lhs.range.add(rhs.range);
+    fold_low_bits(result, lhs, rhs, [](const auto& a, const auto& b) {
+      return a + b;
+    });
+    break;
+  case Operation::Sub:
+    result.range = lhs.range.sub(rhs.range);
+    fold_low_bits(result, lhs, rhs, [](const auto& a, const auto& b) {
+      return a - b;
+    });
+    break;
+  case Operation::Mul:
+    result.range = lhs.range.multiply(rhs.range);
+    result.known_zero.setLowBits(
+        std::min(bitwidth, lhs.known_zero.countTrailingOnes() +
+                               rhs.known_zero.countTrailingOnes()));
+    break;
+  case Operation::UDiv:
+    result.range = with_zero_divisor(
+        lhs.range.udiv(rhs.range), rhs,
+        llvm::ConstantRange(llvm::APInt::getAllOnesValue(bitwidth)));
+    break;
+  case Operation::URem:
+    result.range =
+        with_zero_divisor(lhs.range.urem(rhs.range), rhs, lhs.range);
+    break;
+
+  case Operation::And:
+    result.known_zero = lhs.known_zero | rhs.known_zero;
+    result.known_one = lhs.known_one & rhs.known_one;
+    break;
+  case Operation::Or:
+    result.known_zero = lhs.known_zero & rhs.known_zero;
+    result.known_one = lhs.known_one | rhs.known_one;
+    break;
+  case Operation::Xor:
+    result.known_zero = (lhs.known_zero & rhs.known_zero) |
+                        (lhs.known_one & rhs.known_one);
+    result.known_one = (lhs.known_zero & rhs.known_one) |
+                       (lhs.known_one & rhs.known_zero);
+    break;
+  case Operation::Not:
+    result.known_zero = lhs.known_one;
+    result.known_one = lhs.known_zero;
+    break;
+
+  case Operation::Shl:
+  case Operation::LShr:
+  case Operation::AShr: {
+    // Shifting by at least the bitwidth is handled differently by LLVM's range
+    // operations so we give up on those.
+    if (rhs.range.getUnsignedMax().uge(bitwidth))
+      break;
+
+    if (node.opcode() == Operation::Shl)
+      result.range = lhs.range.shl(rhs.range);
+    else if (node.opcode() == Operation::LShr)
+      result.range = lhs.range.lshr(rhs.range);
+    else
+      result.range = lhs.range.ashr(rhs.range);
+
+    auto amount = rhs.constant();
+    if (!amount)
+      break;
+
+    uint32_t shift = amount->getZExtValue();
+    if (node.opcode() == Operation::Shl) {
+      result.known_zero = lhs.known_zero.shl(shift);
+      result.known_zero.setLowBits(shift);
+      result.known_one = lhs.known_one.shl(shift);
+    } else if (node.opcode() == Operation::LShr) {
+      result.known_zero = lhs.known_zero.lshr(shift);
+      result.known_zero.setHighBits(shift);
+      result.known_one = lhs.known_one.lshr(shift);
+    } else {
+      result.known_zero = lhs.known_zero.ashr(shift);
+      result.known_one = lhs.known_one.ashr(shift);
+    }
+    break;
+  }
+
+  case Operation::Trunc:
+  case Operation::ZExt:
+  case Operation::SExt:
+    result = resize(lhs, bitwidth, node.opcode());
+    break;
+
+  case Operation::Select: {
+    const IntAnalysis& tval = *operands[1];
+    const IntAnalysis& fval = *operands[2];
+
+    if (auto cond = lhs.constant())
+      return cond->getBoolValue() ? tval : fval;
+
+    result.known_zero = tval.known_zero & fval.known_zero;
+    result.known_one = tval.known_one & fval.known_one;
+    result.range = tval.range.unionWith(fval.range);
+    break;
+  }
+
+  case Operation::ICmpEq:
+  case Operation::ICmpNe:
+  case Operation::ICmpUgt:
+  case Operation::ICmpUge:
+  case Operation::ICmpUlt:
+  case Operation::ICmpUle:
+  case Operation::ICmpSgt:
+  case Operation::ICmpSge:
+  case Operation::ICmpSlt:
+  case Operation::ICmpSle:
+    if (auto value = compare(node.opcode(), lhs, rhs))
+      return IntAnalysis(llvm::APInt(1, *value));
+    break;
+
+  default:
+    break;
+  }
+
+  result.normalize();
+  if (result.is_contradiction())
+    return IntAnalysis(bitwidth);
+  return result;
+}
+
+std::optional<bool> IntAnalysis::compare(Operation::Opcode opcode,
+                                         const IntAnalysis& lhs,
+                                         const IntAnalysis& rhs) {
+  auto equal = [&]() -> std::optional<bool> {
+    auto lval = lhs.constant();
+    auto rval = rhs.constant();
+    if (lval && rval)
+      return *lval == *rval;
+
+    if (lhs.known_one.intersects(rhs.known_zero) ||
+        lhs.known_zero.intersects(rhs.known_one))
+      return false;
+    if (lhs.range.intersectWith(rhs.range).isEmptySet())
+      return false;
+    return std::nullopt;
+  };
+
+  // Decide a < b (or a <= b if inclusive) using the bounds on both sides.
+  auto less = [](const IntAnalysis& a, const IntAnalysis& b, bool is_signed,
+                 bool inclusive) -> std::optional<bool> {
+    auto min = [&](const IntAnalysis& v) {
+      return is_signed ? v.range.getSignedMin() : v.range.getUnsignedMin();
+    };
+    auto max = [&](const IntAnalysis& v) {
+      return is_signed ? v.range.getSignedMax() : v.range.getUnsignedMax();
+    };
+    auto lt = [&](const llvm::APInt& x, const llvm::APInt& y) {
+      return is_signed ? x.slt(y) : x.ult(y);
+    };
+    auto le = [&](const llvm::APInt& x, const llvm::APInt& y) {
+      return is_signed ? x.sle(y) : x.ule(y);
+    };
+
+    if (inclusive ? le(max(a), min(b)) : lt(max(a), min(b)))
+      return true;
+    if (inclusive ? lt(max(b), min(a)) : le(max(b), min(a)))
+      return false;
+    return std::nullopt;
+  };
+
+  switch (opcode) {
+  case Operation::ICmpEq:
+    return equal();
+  case Operation::ICmpNe:
+    if (auto value = equal())
+      return !*value;
+    return std::nullopt;
+
+  case Operation::ICmpUlt:
+    return less(lhs, rhs, false, false);
+  case Operation::ICmpUle:
+    return less(lhs, rhs, false, true);
+  case Operation::ICmpUgt:
+    return less(rhs, lhs, false, false);
+  case Operation::ICmpUge:
+    return less(rhs, lhs, false, true);
+  case Operation::ICmpSlt:
+    return less(lhs, rhs, true, false);
+  case Operation::ICmpSle:
+    return less(lhs, rhs, true, true);
+  case Operation::ICmpSgt:
+    return less(rhs, lhs, true, false);
+  case Operation::ICmpSge:
+    return less(rhs, lhs, true, true);
+
+  default:
+    return std::nullopt;
+  }
+}
+
+bool IntAnalysis::operator==(const IntAnalysis& other) const {
+  return known_zero == other.known_zero && known_one == other.known_one &&
+         range == other.range;
+}
+bool IntAnalysis::operator!=(const IntAnalysis& other) const {
+  return !(*this == other);
+}
+
+} // namespace caffeine
@@ -564,6 +564,53 @@ OpRef StoreOp::Create(const OpRef& data, const OpRef& offset,
   return constant_fold(StoreOp(data, offset, value));
 }
 
+/***************************************************
+ * MultiLoadOp                                     *
+ ***************************************************/
+MultiLoadOp::MultiLoadOp(Type t, const OpRef& data, const OpRef& offset,
+                         bool little_endian)
+    : Operation(std::make_unique<OperationData>(
+                    little_endian ? Opcode::LoadLE : Opcode::LoadBE, t),
+                {data, offset}) {}
+
+OpRef MultiLoadOp::Create(Type t, const OpRef& data, const OpRef& offset,
+                          bool little_endian) {
+  CAFFEINE_ASSERT(data, "data was null");
+  CAFFEINE_ASSERT(offset, "offset was null");
+  CAFFEINE_ASSERT(offset->type().is_int(),
+                  "Load offset must be a pointer-sized integer type");
+  CAFFEINE_ASSERT(t.is_int() && t.bitwidth() % 8 == 0 && t.bitwidth() > 8,
+                  "Multi-byte loads must load an integer of at least 2 bytes");
+
+  return constant_fold(MultiLoadOp(t, data, offset, little_endian));
+}
+
+/***************************************************
+ * MultiStoreOp                                    *
+ ***************************************************/
+MultiStoreOp::MultiStoreOp(const OpRef& data, const OpRef& offset,
+                           const OpRef& value, bool little_endian)
+    : ArrayBase(std::make_unique<OperationData>(
+                    little_endian ? Opcode::StoreLE : Opcode::StoreBE,
+                    data->type()),
+                {data, offset, value}) {}
+
+OpRef MultiStoreOp::Create(const OpRef& data, const OpRef& offset,
+                           const OpRef& value, bool little_endian) {
+  CAFFEINE_ASSERT(data, "data was null");
+  CAFFEINE_ASSERT(offset, "offset was null");
+  CAFFEINE_ASSERT(value, "value was null");
+
+  CAFFEINE_ASSERT(offset->type().is_int(),
+                  "Store offset must be a pointer-size integer type");
+
+  Type t = value->type();
+  CAFFEINE_ASSERT(t.is_int() && t.bitwidth() % 8 == 0 && t.bitwidth() > 8,
+                  "Multi-byte stores must store an integer of 2 or more bytes");
+
+  return constant_fold(MultiStoreOp(data, offset, value, little_endian));
+}
+
 /***************************************************
  * Undef                                           *
  ***************************************************/
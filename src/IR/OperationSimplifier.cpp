@@ -1,8 +1,11 @@
 #include "caffeine/IR/OperationSimplifier.h"
 #include "caffeine/Config.h"
 #include "caffeine/IR/Matching.h"
+#include "caffeine/IR/MemoryRange.h"
 #include "caffeine/IR/OperationCache.h"
 #include "caffeine/IR/Value.h"
+#include <optional>
+#include <vector>
 
 namespace caffeine {
 namespace {
@@ -76,6 +79,149 @@ namespace {
     }
     CAFFEINE_UNREACHABLE("unknown ICmpOpcode");
   }
+
+  constexpr uint64_t min_snapshot_depth =
+      OperationSimplifier::min_snapshot_depth;
+  constexpr uint64_t max_snapshot_size = OperationSimplifier::max_snapshot_size;
+
+  // Skip past all stores at concrete offsets at the top of a store chain that
+  // don't touch any of the num_bytes bytes starting at offset.
+  const OpRef& skip_disjoint_stores(const OpRef& array,
+                                    const llvm::APInt& offset,
+                                    uint64_t num_bytes) {
+    const OpRef* current = &array;
+    while ((*current)->is<StoreOp>() || (*current)->is<MultiStoreOp>()) {
+      const Operation& store = **current;
+      const auto* store_offset =
+          llvm::dyn_cast<ConstantInt>(store.operand_at(1).get());
+      if (!store_offset)
+        break;
+
+      uint64_t store_bytes = store.operand_at(2)->type().bitwidth() / 8;
+      if (!is_disjoint(offset, num_bytes, store_offset->value(), store_bytes))
+        break;
+      current = &store.operand_at(0);
+    }
+    return *current;
+  }
+
+  // Extract the byte at position index (in memory order) out of a value that
+  // is stored with the given byte order.
+  OpRef extract_byte(const OpRef& value, uint64_t index, bool little_endian) {
+    uint64_t num_bytes = value->type().bitwidth() / 8;
+    uint64_t shift = little_endian ? index : num_bytes - 1 - index;
+
+    return UnaryOp::CreateTrunc(Type::int_ty(8),
+                                BinaryOp::CreateLShr(value, shift * 8));
+  }
+
+  // Combine bytes (in memory order) into a single integer with the given byte
+  // order. This is the inverse of extract_byte.
+  OpRef combine_bytes(llvm::ArrayRef<OpRef> bytes, bool little_endian) {
+    Type type = Type::int_ty(bytes.size() * 8);
+    OpRef result = nullptr;
+
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      uint64_t shift = little_endian ? i : bytes.size() - 1 - i;
+      auto extended = BinaryOp::CreateShl(UnaryOp::CreateZExt(type, bytes[i]),
+                                          shift * 8);
+      result = result ? BinaryOp::CreateOr(result, extended) : extended;
+    }
+
+    return result;
+  }
+
+  // The number of elements within an array, if it is known.
+  //
+  // This only looks through a bounded number of stores so that it doesn't
+  // make building a long store chain quadratic.
+  std::optional<uint64_t> constant_array_size(const OpRef& array) {
+    const Operation* current = array.get();
+    for (uint64_t depth = 0;
+         current->is<StoreOp>() || current->is<MultiStoreOp>(); ++depth) {
+      if (depth >= min_snapshot_depth)
+        return std::nullopt;
+      current = current->operand_at(0).get();
+    }
+
+    if (const auto* fixedarray = llvm::dyn_cast<FixedArray>(current))
+      return fixedarray->data().size();
+    if (!current->is<AllocOp>() && !current->is<ConstantArray>())
+      return std::nullopt;
+
+    const auto* size =
+        llvm::dyn_cast<ConstantInt>(current->operand_at(0).get());
+    if (!size || size->value().getActiveBits() > 64)
+      return std::nullopt;
+    return size->value().getZExtValue();
+  }
+
+  // Collapse a chain of stores at concrete offsets into a dense FixedArray
+  // before another concrete store is added on top of it.
+  //
+  // This only happens once the chain reaches min_snapshot_depth stores, or
+  // if the array below the chain is already a FixedArray. Elements of the
+  // snapshot that weren't written by the chain are loads from the array below
+  // it.
+  //
+  // Returns nullptr if the chain should be kept, the array is too large, or
+  // any of the stores, including the new one at offset, is out of bounds.
+  // Otherwise the new store folds straight into the snapshot.
+  OpRef snapshot_store_chain(const OpRef& array, const llvm::APInt& offset) {
+    // A chain that is already deeper than the threshold failed to collapse
+    // when it reached it so there's no need to walk any further down.
+    const OpRef* tail = &array;
+    uint64_t depth = 0;
+    while (const auto* store = llvm::dyn_cast<StoreOp>(tail->get())) {
+      if (!store->offset()->is<ConstantInt>())
+        break;
+      if (++depth >= min_snapshot_depth)
+        return nullptr;
+      tail = &store->data();
+    }
+
+    // There's nothing to collapse.
+    if (tail == &array)
+      return nullptr;
+
+    const auto* fixedarray = llvm::dyn_cast<FixedArray>(tail->get());
+    if (!fixedarray && depth + 1 < min_snapshot_depth)
+      return nullptr;
+
+    auto size = constant_array_size(*tail);
+    if (!size || *size > max_snapshot_size || offset.uge(*size))
+      return nullptr;
+
+    std::vector<OpRef> data(*size);
+
+    // Stores closer to the top of the chain overwrite those below them.
+    for (const OpRef* current = &array; current != tail;) {
+      const auto& store = llvm::cast<StoreOp>(**current);
+      const auto& index = llvm::cast<ConstantInt>(*store.offset()).value();
+      if (index.uge(*size))
+        return nullptr;
+
+      OpRef& slot = data[index.getZExtValue()];
+      if (!slot)
+        slot = store.value();
+      current = &store.data();
+    }
+
+    Type index_ty = Type::int_ty(array->type().bitwidth());
+    for (size_t i = 0; i < data.size(); ++i) {
+      if (data[i])
+        continue;
+
+      if (fixedarray) {
+        data[i] = fixedarray->data()[i];
+      } else {
+        data[i] = LoadOp::Create(
+            *tail, ConstantInt::Create(llvm::APInt(index_ty.bitwidth(), i)));
+      }
+    }
+
+    return FixedArray::Create(index_ty, data);
+  }
 } // namespace
 
 #define TRY_CONST_INT(expr)                                                    \
@@ -492,8 +638,61 @@ OpRef OperationSimplifier::visitLoadOp(LoadOp& op) {
   const auto* fixedarray = llvm::dyn_cast<FixedArray>(op.data().get());
   const auto* offset_int = llvm::dyn_cast<ConstantInt>(op.offset().get());
 
+  if (offset_int &&
+      (op.data()->is<StoreOp>() || op.data()->is<MultiStoreOp>())) {
+    // Stores at other concrete offsets can't affect this load so we can look
+    // straight through them.
+    const auto& offset = offset_int->value();
+    const OpRef& current = skip_disjoint_stores(op.data(), offset, 1);
+
+    if (const auto* store = llvm::dyn_cast<StoreOp>(current.get())) {
+      const auto* store_offset =
+          llvm::dyn_cast<ConstantInt>(store->offset().get());
+
+      if (store_offset &&
+          llvm::APInt::isSameValue(store_offset->value(), offset))
+        return store->value();
+
+      // A single store at a symbolic offset on top of a FixedArray can be
+      // resolved without having to go through the solver's array theory.
+      if (!store_offset && store->data()->is<FixedArray>()) {
+        return SelectOp::Create(
+            ICmpOp::CreateICmpEQ(store->offset(), op.offset()), store->value(),
+            LoadOp::Create(store->data(), op.offset()));
+      }
+    }
+
+    if (const auto* store = llvm::dyn_cast<MultiStoreOp>(current.get())) {
+      const auto* store_offset =
+          llvm::dyn_cast<ConstantInt>(store->offset().get());
+
+      if (store_offset &&
+          store_offset->value().getBitWidth() == offset.getBitWidth()) {
+        return extract_byte(store->value(),
+                            (offset - store_offset->value()).getZExtValue(),
+                            store->is_little_endian());
+      }
+
+      // Same as above, except that any of the stored bytes could match.
+      if (!store_offset && store->data()->is<FixedArray>()) {
+        OpRef output = LoadOp::Create(store->data(), op.offset());
+        for (uint32_t i = 0; i < store->num_bytes(); ++i) {
+          output = SelectOp::Create(
+              ICmpOp::CreateICmpEQ(BinaryOp::CreateAdd(store->offset(), i),
+                                   op.offset()),
+              extract_byte(store->value(), i, store->is_little_endian()),
+              output);
+        }
+        return output;
+      }
+    }
+
+    if (&current != &op.data())
+      return LoadOp::Create(current, op.offset());
+  }
+
   if (fixedarray) {
-    if (offset_int) {
+    if (offset_int && offset_int->value().ult(fixedarray->data().size())) {
       return fixedarray->data()[offset_int->value().getLimitedValue()];
     }
 
@@ -519,7 +718,8 @@ OpRef OperationSimplifier::visitStoreOp(StoreOp& op) {
   const auto* offset_cnst = llvm::dyn_cast<ConstantInt>(op.offset().get());
   const auto* fixedarray = llvm::dyn_cast<FixedArray>(op.data().get());
 
-  if (offset_cnst && fixedarray) {
+  if (offset_cnst && fixedarray &&
+      offset_cnst->value().ult(fixedarray->data().size())) {
     auto data = fixedarray->data().vec();
     data[offset_cnst->value().getLimitedValue()] = op.value();
     return FixedArray::Create(op.offset()->type(), data);
@@ -527,6 +727,94 @@ OpRef OperationSimplifier::visitStoreOp(StoreOp& op) {
     auto cached = OperationCache::default_cache()->intern(op.data());
     if (cached != op.data())
       return StoreOp::Create(cached, op.offset(), op.value());
+  } else if (offset_cnst) {
+    // Otherwise every store would add another level to the chain that all
+    // later loads and the solver have to walk through.
+    OpRef snapshot = snapshot_store_chain(op.data(), offset_cnst->value());
+    if (snapshot)
+      return StoreOp::Create(snapshot, op.offset(), op.value());
+  }
+
+  return this->visitArrayBase(op);
+}
+
+OpRef OperationSimplifier::visitMultiLoadOp(MultiLoadOp& op) {
+  const auto* offset_int = llvm::dyn_cast<ConstantInt>(op.offset().get());
+  const OpRef* current = &op.data();
+
+  if (offset_int) {
+    current = &skip_disjoint_stores(op.data(), offset_int->value(),
+                                    op.num_bytes());
+  }
+
+  // Loading back exactly what was stored just gives the stored value.
+  if (const auto* store = llvm::dyn_cast<MultiStoreOp>(current->get())) {
+    bool same_offset = store->offset() == op.offset();
+    if (!same_offset && offset_int) {
+      if (const auto* store_offset =
+              llvm::dyn_cast<ConstantInt>(store->offset().get()))
+        same_offset = llvm::APInt::isSameValue(store_offset->value(),
+                                               offset_int->value());
+    }
+
+    if (same_offset && store->value()->type() == op.type() &&
+        store->is_little_endian() == op.is_little_endian())
+      return store->value();
+  }
+
+  // Loads from arrays with known contents are better handled byte-by-byte if
+  // the offset is known or the array is small since then each byte load can be
+  // resolved without using the array theory.
+  if (const auto* fixedarray = llvm::dyn_cast<FixedArray>(current->get())) {
+    if (offset_int || fixedarray->data().size() < 1024) {
+      llvm::SmallVector<OpRef, 8> bytes;
+      for (uint32_t i = 0; i < op.num_bytes(); ++i)
+        bytes.push_back(
+            LoadOp::Create(*current, BinaryOp::CreateAdd(op.offset(), i)));
+      return combine_bytes(bytes, op.is_little_endian());
+    }
+
+    auto cached = OperationCache::default_cache()->intern(*current);
+    if (cached != *current) {
+      return MultiLoadOp::Create(op.type(), cached, op.offset(),
+                                 op.is_little_endian());
+    }
+  }
+
+  if (current != &op.data()) {
+    return MultiLoadOp::Create(op.type(), *current, op.offset(),
+                               op.is_little_endian());
+  }
+
+  return this->visitOperation(op);
+}
+OpRef OperationSimplifier::visitMultiStoreOp(MultiStoreOp& op) {
+  const auto* offset_cnst = llvm::dyn_cast<ConstantInt>(op.offset().get());
+
+  // Concrete stores into arrays of known size are split up into byte stores
+  // so that they get folded into the array's FixedArray snapshot.
+  if (offset_cnst) {
+    auto size = constant_array_size(op.data());
+    uint64_t offset = offset_cnst->value().getLimitedValue();
+
+    if (size && *size <= max_snapshot_size && offset <= *size &&
+        *size - offset >= op.num_bytes()) {
+      OpRef data = op.data();
+      for (uint32_t i = 0; i < op.num_bytes(); ++i) {
+        data = StoreOp::Create(
+            data, BinaryOp::CreateAdd(op.offset(), i),
+            extract_byte(op.value(), i, op.is_little_endian()));
+      }
+      return data;
+    }
+  }
+
+  if (op.data()->is<FixedArray>()) {
+    auto cached = OperationCache::default_cache()->intern(op.data());
+    if (cached != op.data()) {
+      return MultiStoreOp::Create(cached, op.offset(), op.value(),
+                                  op.is_little_endian());
+    }
   }
 
   return this->visitArrayBase(op);
@@ -10,6 +10,8 @@ OpRef ArrayBase::size() const {
   case ConstantArray:
     return operand_at(0);
   case Store:
+  case StoreLE:
+  case StoreBE:
     return llvm::cast<ArrayBase>(*operand_at(0)).size();
   case FixedArray:
     return ConstantInt::Create(
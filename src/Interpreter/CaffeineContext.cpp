@@ -185,6 +185,8 @@ Builder& Builder::with_default_intrinsics() {
   with_intrinsic(llvm::Intrinsic::smul_with_overflow,
                  Intrinsics::smul_with_overflow());
   with_intrinsic(llvm::Intrinsic::memset, Intrinsics::memset());
+  with_intrinsic(llvm::Intrinsic::memcpy, Intrinsics::memcpy());
+  with_intrinsic(llvm::Intrinsic::memmove, Intrinsics::memmove());
   with_intrinsic(llvm::Intrinsic::bswap, Intrinsics::bswap());
   with_intrinsic(llvm::Intrinsic::eh_typeid_for, Intrinsics::eh_typeid_for());
 
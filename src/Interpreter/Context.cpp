@@ -5,12 +5,17 @@
 #include "caffeine/Interpreter/ExprEval.h"
 #include "caffeine/Interpreter/StackFrame.h"
 #include "caffeine/Model/AssertionList.h"
+#include "caffeine/Solver/EnumeratingSolver.h"
+#include "caffeine/Solver/ModelEval.h"
 #include "caffeine/Support/LLVMFmt.h"
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <fmt/format.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/raw_ostream.h>
+#include <tsl/hopscotch_set.h>
+#include <utility>
 
 namespace caffeine {
 
@@ -94,7 +99,8 @@ void Context::pop() {
   if (stack.back().is_regular()) {
     auto& frame = stack.back().get_regular();
     for (auto [allocid, heap] : frame.allocations) {
-      CAFFEINE_ASSERT(heaps[heap][allocid].kind() == AllocationKind::Alloca,
+      CAFFEINE_ASSERT(std::as_const(heaps)[heap][allocid].kind() ==
+                          AllocationKind::Alloca,
                       "found non-stack allocation on the stack");
 
       heaps[heap].deallocate(allocid);
@@ -112,22 +118,93 @@ void Context::add(const Assertion& assertion) {
   assertions.insert(egraph.add(*assertion.value()));
 }
 
+bool Context::model_satisfies(const AssertionList& assertions,
+                              const Assertion& extra) const {
+  if (!model_)
+    return false;
+
+  auto supported = [](const Assertion& assertion) {
+    return assertion.is_empty() || ModelEvaluator::supports(*assertion.value());
+  };
+  if (!supported(extra) ||
+      !std::all_of(assertions.begin(), assertions.end(), supported))
+    return false;
+
+  ModelEvaluator evaluator{model_.get(), &egraph};
+  auto satisfied = [&](const Assertion& assertion) {
+    return assertion.is_empty() ||
+           evaluator.visit(*assertion.value()).apint().getBoolValue();
+  };
+
+  return satisfied(extra) &&
+         std::all_of(assertions.begin(), assertions.end(), satisfied);
+}
+
+std::optional<bool> Context::known_value(size_t eclass_id) const {
+  const EClass* eclass = egraph.get(eclass_id);
+  if (!eclass->analysis)
+    return std::nullopt;
+
+  if (std::optional<llvm::APInt> value = eclass->analysis->constant())
+    return value->getBoolValue();
+  return std::nullopt;
+}
+
 SolverResult Context::check(std::shared_ptr<Solver> solver,
                             const Assertion& extra) {
-  AssertionList assertions = extract_assertions();
+  AssertionList list = extract_assertions();
+  size_t extra_id = egraph.add(*extra.value());
+
+  // The e-graph analysis is often enough to decide the extra assertion (e.g.
+  // bounds checks on allocations with known addresses) in which case there is
+  // no need to invoke the solver.
+  if (std::optional<bool> known = known_value(extra_id)) {
+    if (!*known)
+      return SolverResult::UNSAT;
+    if (assertions.unproven().empty())
+      return SolverResult::SAT;
+  }
 
-  auto result = solver->check(assertions, egraph.extract(*extra.value()));
-  if (result == SolverResult::SAT)
+  Assertion extracted = egraph.extract(extra_id);
+  if (model_satisfies(list, extracted)) {
     assertions.mark_sat();
+    return SolverResult::SAT;
+  }
+
+  auto result = solver->check(list, extracted);
+  if (result == SolverResult::SAT) {
+    assertions.mark_sat();
+
+    // Solvers may attach a model to the result of check. It is only used as a
+    // candidate for future queries so it doesn't matter if it covers the
+    // whole query.
+    if (result.model())
+      model_ = AssignmentModel::extract(*result.model(), list, extracted,
+                                        egraph);
+  }
   return result;
 }
 SolverResult Context::resolve(std::shared_ptr<Solver> solver,
                               const Assertion& extra) {
-  AssertionList assertions = extract_assertions();
+  AssertionList list = extract_assertions();
+  size_t extra_id = egraph.add(*extra.value());
+
+  if (known_value(extra_id) == false)
+    return SolverResult::UNSAT;
 
-  auto result = solver->resolve(assertions, egraph.extract(*extra.value()));
-  if (result == SolverResult::SAT)
+  Assertion extracted = egraph.extract(extra_id);
+  if (model_satisfies(list, extracted)) {
     assertions.mark_sat();
+    return SolverResult(SolverResult::SAT, model_);
+  }
+
+  auto result = solver->resolve(list, extracted);
+  if (result == SolverResult::SAT) {
+    assertions.mark_sat();
+    if (result.model())
+      model_ = AssignmentModel::extract(*result.model(), list, extracted,
+                                        egraph);
+  }
   return result;
 }
 
@@ -136,17 +213,52 @@ AssertionList Context::extract_assertions() {
 
   assertions.canonicalize(egraph);
 
+  immer::set<size_t> changed = egraph.take_changed();
+  llvm::ArrayRef<size_t> proven = assertions.proven();
+
+  // The cached assertions can be reused if they were extracted from a prefix
+  // of the current assertions, none of their e-classes have been modified,
+  // and they don't straddle the proven/unproven boundary differently.
+  bool reusable = [&] {
+    if (!extracted_)
+      return false;
+
+    const auto& ids = extracted_->ids;
+    if (ids.size() > assertions.size())
+      return false;
+    if (ids.size() > proven.size() && extracted_->proven != proven.size())
+      return false;
+    if (!std::equal(ids.begin(), ids.end(), assertions.begin()))
+      return false;
+
+    return std::none_of(ids.begin(), ids.end(),
+                        [&](size_t id) { return changed.count(id) != 0; });
+  }();
+
+  if (!reusable) {
+    extracted_ = std::make_shared<ExtractedAssertions>();
+  } else if (extracted_.use_count() > 1) {
+    extracted_ = std::make_shared<ExtractedAssertions>(*extracted_);
+  }
+
+  ExtractedAssertions& cache = *extracted_;
   EGraphExtractor extractor{&egraph};
-  AssertionList list;
 
-  for (size_t assertion : assertions.proven())
-    list.insert(extractor.extract(assertion));
-  list.mark_sat();
+  if (cache.ids.size() <= proven.size()) {
+    for (size_t assertion : proven.drop_front(cache.ids.size())) {
+      cache.list.insert(extractor.extract(assertion));
+      cache.ids.push_back(assertion);
+    }
+    cache.list.mark_sat();
+  }
 
-  for (size_t assertion : assertions.unproven())
-    list.insert(extractor.extract(assertion));
+  for (size_t i = cache.ids.size(); i < assertions.size(); ++i) {
+    cache.list.insert(extractor.extract(assertions[i]));
+    cache.ids.push_back(assertions[i]);
+  }
+  cache.proven = proven.size();
 
-  return list;
+  return cache.list;
 }
 AssertionList Context::extract_assertions() const {
   EGraphExtractor extractor{&egraph};
@@ -162,6 +274,93 @@ AssertionList Context::extract_assertions() const {
   return list;
 }
 
+namespace {
+  // Walks all the values held by a context and records the ids of the e-graph
+  // nodes within them.
+  class RootCollector {
+  public:
+    std::vector<size_t> roots;
+
+    void visit(const OpRef& op) {
+      if (!op || !seen.insert(op.get()).second)
+        return;
+
+      if (const auto* node = llvm::dyn_cast<EGraphNode>(op.get())) {
+        roots.push_back(node->id());
+        return;
+      }
+
+      for (size_t i = 0; i < op->num_operands(); ++i)
+        visit(op->operand_at(i));
+    }
+
+    void visit(const LLVMScalar& scalar) {
+      if (scalar.is_pointer())
+        visit(scalar.pointer().offset());
+      else
+        visit(scalar.expr());
+    }
+
+    void visit(const LLVMValue& value) {
+      if (value.is_aggregate()) {
+        for (const LLVMValue& member : value.members())
+          visit(member);
+      } else {
+        for (const LLVMScalar& element : value.elements())
+          visit(element);
+      }
+    }
+
+  private:
+    tsl::hopscotch_set<const Operation*> seen;
+  };
+} // namespace
+
+// Graphs smaller than this are never collected since doing so would not free
+// enough memory to be worth the time.
+static constexpr size_t min_collect_size = 4096;
+
+size_t Context::collect_garbage(double growth_factor) {
+  if (growth_factor > 0.0) {
+    size_t threshold = std::max<size_t>(
+        min_collect_size, static_cast<size_t>(egraph_live_ * growth_factor));
+    if (egraph.size() <= threshold)
+      return 0;
+  }
+
+  RootCollector collector;
+  for (const StackFrame& frame : stack) {
+    // External frames may hold values in state that isn't visible here so we
+    // can't tell what is reachable while one is executing.
+    if (frame.is_external())
+      return 0;
+
+    for (const auto& [key, value] : frame.get_regular().variables)
+      collector.visit(value);
+  }
+
+  for (const auto& [key, value] : globals)
+    collector.visit(value);
+
+  for (const auto& entry : heaps) {
+    for (const Allocation& alloc : entry.getSecond()) {
+      collector.visit(alloc.address());
+      collector.visit(alloc.size());
+      alloc.visit_data([&](const OpRef& op) { collector.visit(op); });
+    }
+  }
+
+  for (const auto& [name, value] : constants)
+    collector.visit(value);
+
+  std::vector<size_t> roots = std::move(collector.roots);
+  roots.insert(roots.end(), assertions.begin(), assertions.end());
+
+  size_t removed = egraph.collect(roots);
+  egraph_live_ = egraph.size();
+  return removed;
+}
+
 uint64_t Context::next_constant() {
   // Constant numbers greater than 2^29-1 are reserved for the solvers
   // themselves to create internal constants. If this assertion fires
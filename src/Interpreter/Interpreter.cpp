@@ -25,6 +25,7 @@
 
 #include <iostream>
 #include <optional>
+#include <utility>
 
 namespace caffeine {
 
@@ -36,6 +37,11 @@ void Interpreter::execute() {
     interp->context().global_ctors_ran = true;
   }
 
+  // This is the only point at which there are no values held outside of the
+  // context so it is the only place where it is safe to collect the e-graph.
+  if (double factor = interp->caffeine().options().egraph_gc_growth_factor)
+    interp->context().collect_garbage(factor);
+
   auto& frame_wrapper = interp->context().stack_top();
   if (frame_wrapper.is_external()) {
     frame_wrapper.get_external()->step(*interp);
@@ -343,7 +349,8 @@ void Interpreter::visitIndirectCall(llvm::CallBase& call) {
 
   for (auto& ptr : resolved) {
     auto fork = interp->fork();
-    Allocation& alloc = fork.context().heaps.ptr_allocation(ptr);
+    const Allocation& alloc =
+        std::as_const(fork.context().heaps).ptr_allocation(ptr);
     fork.add_assertion(ICmpOp::CreateICmpEQ(
         alloc.address(), pointer.value(fork.context().heaps)));
 
@@ -415,17 +422,6 @@ void Interpreter::visitAllocaInst(llvm::AllocaInst& inst) {
   interp->store(&inst, LLVMValue(pointer));
 }
 
-void Interpreter::visitMemCpyInst(llvm::MemCpyInst&) {
-  CAFFEINE_ABORT("llvm.memcpy is not implemented natively within the caffeine "
-                 "interpreter. Run gen-builtins over the input bitcode file "
-                 "first to generate definitions that caffeine can execute.");
-}
-void Interpreter::visitMemMoveInst(llvm::MemMoveInst&) {
-  CAFFEINE_ABORT("llvm.memmove is not implemented natively within the caffeine "
-                 "interpreter. Run gen-builtins over the input bitcode file "
-                 "first to generate definitions that caffeine can execute.");
-}
-
 void Interpreter::visitDbgInfoIntrinsic(llvm::DbgInfoIntrinsic&) {
   // Ignore debug info since it doesn't affect semantics.
 }
@@ -463,7 +459,7 @@ void Interpreter::visitExternFunc(llvm::CallBase& call) {
 
 std::optional<std::string> readSymbolicName(std::shared_ptr<Solver> solver,
                                             Context* ctx, const Pointer& ptr) {
-  const auto& alloc = ctx->heaps[ptr.heap()][ptr.alloc()];
+  const auto& alloc = std::as_const(ctx->heaps)[ptr.heap()][ptr.alloc()];
 
   auto result = ctx->resolve(solver);
   if (result != SolverResult::SAT) {
@@ -4,10 +4,12 @@
 #include "caffeine/Interpreter/ExprEval.h"
 #include "caffeine/Interpreter/FailureLogger.h"
 #include "caffeine/Interpreter/Policy.h"
+#include "caffeine/Solver/ProfilingSolver.h"
 #include "caffeine/Support/UnsupportedOperation.h"
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
+#include <utility>
 
 namespace caffeine {
 
@@ -145,7 +147,7 @@ void InterpreterContext::mem_write(const Pointer& ptr, llvm::Type* type,
 LLVMValue InterpreterContext::mem_read(const Pointer& ptr, llvm::Type* type) {
   CAFFEINE_ASSERT(ptr.is_resolved());
 
-  Allocation& alloc = context().heaps.ptr_allocation(ptr);
+  const Allocation& alloc = std::as_const(context().heaps).ptr_allocation(ptr);
   return alloc.read(ptr.offset(), type, getModule()->getDataLayout());
 }
 
@@ -235,13 +237,17 @@ void InterpreterContext::add_assertion(Assertion&& assertion) {
 }
 
 SolverResult InterpreterContext::check(const Assertion& extra) {
-  context().egraph.simplify(caffeine().matcher());
+  QuerySite::Scope site(getCurrentInstruction());
+  context().egraph.simplify(caffeine().matcher(),
+                            caffeine().options().saturation_budget);
 
   return context().check(solver_, extra);
 }
 
 SolverResult InterpreterContext::resolve(const Assertion& extra) {
-  context().egraph.simplify(caffeine().matcher());
+  QuerySite::Scope site(getCurrentInstruction());
+  context().egraph.simplify(caffeine().matcher(),
+                            caffeine().options().saturation_budget);
 
   return context().resolve(solver_, extra);
 }
@@ -269,7 +275,7 @@ void InterpreterContext::assert_ptr_valid(const Pointer& ptr,
     return;
 
   auto& ctx = context();
-  auto assertion = !ctx.heaps.check_valid(ptr, width);
+  auto assertion = !ctx.heaps.check_valid(ptr, width, ctx);
   auto result = resolve(assertion);
 
   if (result == SolverResult::SAT) {
@@ -306,6 +312,7 @@ InterpreterContext::resolve_ptr(const Pointer& ptr, const OpRef& width,
   if (is_dead())
     return {};
 
+  QuerySite::Scope site(getCurrentInstruction());
   return context().heaps.resolve(solver(), ptr, context());
 }
 llvm::SmallVector<Pointer, 1>
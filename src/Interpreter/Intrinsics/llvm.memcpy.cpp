@@ -0,0 +1,158 @@
+#include "caffeine/Interpreter/ExternalFunction.h"
+#include "caffeine/Interpreter/InterpreterContext.h"
+#include "caffeine/Interpreter/StackFrame.h"
+#include <caffeine/Solver/Solver.h>
+#include <fmt/format.h>
+#include <memory>
+#include <utility>
+
+namespace caffeine {
+
+namespace {
+  /**
+   * Shared implementation of llvm.memcpy and llvm.memmove.
+   *
+   * Overlapping ranges are undefined behaviour for memcpy so giving both of
+   * them memmove semantics is always correct.
+   */
+  class MemTransfer : public ExternalStackFrameMixin<MemTransfer> {
+  public:
+    using ExternalStackFrameMixin<MemTransfer>::ExternalStackFrameMixin;
+
+    void step(InterpreterContext& ctx) override {
+      const OpRef& len = args.at(2).scalar().expr();
+
+      switch (state) {
+      case Entry: {
+        auto resolved = ctx.resolve_ptr(args.at(0).scalar().pointer(), len,
+                                        "invalid pointer write");
+
+        ctx.fork_external<MemTransfer>(
+            resolved,
+            [&](InterpreterContext&, MemTransfer* frame, Pointer& resolved) {
+              frame->dst = std::move(resolved);
+              frame->state = ResolveSrc;
+            });
+        break;
+      }
+      case ResolveSrc: {
+        auto resolved = ctx.resolve_ptr(args.at(1).scalar().pointer(), len,
+                                        "invalid pointer read");
+
+        ctx.fork_external<MemTransfer>(
+            resolved,
+            [&](InterpreterContext&, MemTransfer* frame, Pointer& resolved) {
+              frame->src = std::move(resolved);
+              frame->state = Copy;
+            });
+        break;
+      }
+      case Copy: {
+        Allocation* dst_alloc = ctx.ptr_allocation(*dst);
+        // Reading from the source must not copy its pages out of a shared
+        // heap.
+        const Allocation* src_alloc =
+            &std::as_const(ctx.context().heaps).ptr_allocation(*src);
+
+        // With a concrete length the whole range can be copied at once.
+        if (const auto* constlen = llvm::dyn_cast<ConstantInt>(len.get())) {
+          try {
+            dst_alloc->copy(dst->offset(), *src_alloc, src->offset(),
+                            constlen->value().getLimitedValue());
+          } catch (AllocationException& ex) {
+            ctx.fail(ex.what());
+            return;
+          }
+
+          ctx.function_return();
+          return;
+        }
+
+        // Otherwise copy one byte at a time. Reading from a snapshot of the
+        // source keeps overlapping copies correct.
+        if (!(src_alloc->permissions() & AllocationPermissions::Read)) {
+          ctx.fail("tried to read unreadable allocation");
+          return;
+        }
+
+        src_data = src_alloc->data();
+        offset = ctx.createConstantZero(len->type().bitwidth());
+        state = Head;
+        break;
+      }
+      case Head: {
+        Assertion cond = ctx.createICmpULT(offset, len);
+        auto is_t = ctx.check(cond);
+        auto is_f = ctx.check(!cond);
+
+        if (is_f != SolverResult::UNSAT) {
+          auto fork = ctx.fork();
+          fork.add_assertion(!cond);
+          fork.function_return();
+        }
+
+        if (is_t != SolverResult::UNSAT) {
+          ctx.add_assertion(cond);
+          state = Body;
+        } else {
+          ctx.kill();
+        }
+        break;
+      }
+      case Body: {
+        Allocation* alloc = ctx.ptr_allocation(*dst);
+        OpRef byte =
+            ctx.createLoad(src_data, ctx.createAdd(src->offset(), offset));
+
+        try {
+          alloc->fill(ctx.createAdd(dst->offset(), offset), byte, 1);
+        } catch (AllocationException& ex) {
+          ctx.fail(ex.what());
+          return;
+        }
+
+        offset = ctx.createAdd(offset, 1);
+        state = Head;
+        break;
+      }
+      }
+    }
+
+  private:
+    enum { Entry, ResolveSrc, Copy, Head, Body } state = Entry;
+
+    std::optional<Pointer> dst;
+    std::optional<Pointer> src;
+    OpRef src_data;
+    OpRef offset;
+  };
+
+  class MemTransferIntrinsic : public ExternalFunction {
+  public:
+    MemTransferIntrinsic(const char* name) : name_(name) {}
+
+    void call(llvm::Function* func, InterpreterContext& ctx,
+              Span<LLVMValue> args) const {
+      if (args.size() != 4) {
+        ctx.fail(fmt::format(
+            "invalid {} signature (invalid number of arguments)", name_));
+        return;
+      }
+
+      ctx.call_external_function(std::make_unique<MemTransfer>(
+          std::vector<LLVMValue>(args.begin(), args.end()), func));
+    }
+
+  private:
+    const char* name_;
+  };
+} // namespace
+
+std::unique_ptr<ExternalFunction> Intrinsics::memcpy() {
+  return std::make_unique<MemTransferIntrinsic>("llvm.memcpy");
+}
+std::unique_ptr<ExternalFunction> Intrinsics::memmove() {
+  return std::make_unique<MemTransferIntrinsic>("llvm.memmove");
+}
+
+} // namespace caffeine
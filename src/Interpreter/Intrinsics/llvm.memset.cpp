@@ -22,13 +22,33 @@ namespace {
 
         ctx.fork_external<Memset>(
             resolved,
-            [&](InterpreterContext& ctx, Memset* frame, Pointer& resolved) {
-              frame->offset = ctx.createConstantZero(len->type().bitwidth());
+            [&](InterpreterContext&, Memset* frame, Pointer& resolved) {
               frame->dst = std::move(resolved);
-              frame->state = Head;
+              frame->state = Fill;
             });
         break;
       }
+      case Fill: {
+        // With a concrete length the whole range can be set at once.
+        if (const auto* constlen = llvm::dyn_cast<ConstantInt>(len.get())) {
+          Allocation* alloc = ctx.ptr_allocation(*dst);
+
+          try {
+            alloc->fill(dst->offset(), val,
+                        constlen->value().getLimitedValue());
+          } catch (AllocationException& ex) {
+            ctx.fail(ex.what());
+            return;
+          }
+
+          ctx.function_return();
+          return;
+        }
+
+        offset = ctx.createConstantZero(len->type().bitwidth());
+        state = Head;
+        break;
+      }
       case Head: {
         Assertion cond = ctx.createICmpULT(offset, len);
         auto is_t = ctx.check(cond);
@@ -36,10 +56,12 @@ namespace {
 
         if (is_f != SolverResult::UNSAT) {
           auto fork = ctx.fork();
+          fork.add_assertion(!cond);
           fork.function_return();
         }
 
         if (is_t != SolverResult::UNSAT) {
+          ctx.add_assertion(cond);
           state = Body;
         } else {
           ctx.kill();
@@ -49,8 +71,13 @@ namespace {
       case Body: {
         Allocation* alloc = ctx.ptr_allocation(*dst);
 
-        alloc->overwrite(ctx.createStore(
-            alloc->data(), ctx.createAdd(dst->offset(), offset), val));
+        try {
+          alloc->fill(ctx.createAdd(dst->offset(), offset), val, 1);
+        } catch (AllocationException& ex) {
+          ctx.fail(ex.what());
+          return;
+        }
+
         offset = ctx.createAdd(offset, 1);
         state = Head;
         break;
@@ -59,7 +86,7 @@ namespace {
     }
 
   private:
-    enum { Entry, Head, Body } state = Entry;
+    enum { Entry, Fill, Head, Body } state = Entry;
 
     std::optional<Pointer> dst;
     OpRef offset;
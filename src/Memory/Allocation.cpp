@@ -1,9 +1,11 @@
 #include "caffeine/Memory/Allocation.h"
 #include "caffeine/IR/Assertion.h"
+#include "caffeine/IR/Matching.h"
 #include "caffeine/IR/Operation.h"
 #include "caffeine/Model/Value.h"
 #include "caffeine/Support/LLVMFmt.h"
 #include <llvm/IR/Type.h>
+#include <vector>
 
 namespace caffeine {
 
@@ -19,6 +21,13 @@ Allocation::Allocation(const OpRef& address, const OpRef& size,
   CAFFEINE_ASSERT(address->type().is_int());
   CAFFEINE_ASSERT(size->type().is_int());
   CAFFEINE_ASSERT(address->type().bitwidth() == size->type().bitwidth());
+
+  const auto* constsize = llvm::dyn_cast<ConstantInt>(size.get());
+  if (constsize && data->type().is_array() &&
+      constsize->value().getActiveBits() <= 64) {
+    pages_.emplace(data, constsize->value().getZExtValue());
+    data_ = nullptr;
+  }
 }
 Allocation::Allocation(const OpRef& address, const ConstantInt& size,
                        const OpRef& data, AllocationKind kind,
@@ -33,11 +42,17 @@ OpRef& Allocation::size() {
   return size_;
 }
 
-const OpRef& Allocation::data() const {
+OpRef Allocation::data() const {
+  if (pages_)
+    return pages_->materialize();
   return data_;
 }
-OpRef& Allocation::data() {
-  return data_;
+
+void Allocation::visit_data(function_view<void(const OpRef&)> visitor) const {
+  if (pages_)
+    pages_->visit(visitor);
+  else
+    visitor(data_);
 }
 
 const OpRef& Allocation::address() const {
@@ -63,13 +78,19 @@ void Allocation::overwrite(const OpRef& newdata) {
   if (!(perms_ & AllocationPermissions::Write)) {
     throw AllocationException("tried to write to unwritable allocation");
   }
-  data_ = newdata;
+  if (pages_)
+    pages_->overwrite(newdata);
+  else
+    data_ = newdata;
 }
 void Allocation::overwrite(OpRef&& newdata) {
   if (!(perms_ & AllocationPermissions::Write)) {
     throw AllocationException("tried to write to unwritable allocation");
   }
-  data_ = std::move(newdata);
+  if (pages_)
+    pages_->overwrite(newdata);
+  else
+    data_ = std::move(newdata);
 }
 
 bool Allocation::is_constant_size() const {
@@ -99,7 +120,10 @@ OpRef Allocation::read(const OpRef& offset, const Type& t,
   /**
    * Reading data here is actually somewhat complex. We need to effectively
    * reconstitute the type from its component bytes after we've read them
-   * out of the array.
+   * out of the array. Values wider than a byte are read as an integer with a
+   * single multi-byte load (using the byte order of the target) and then
+   * converted to the requested type. Reads at concrete offsets are served
+   * directly from the pages of the allocation where possible.
    */
 
   CAFFEINE_ASSERT(!t.is_void(), "attempted to read a value of type void");
@@ -109,26 +133,16 @@ OpRef Allocation::read(const OpRef& offset, const Type& t,
   }
 
   uint32_t width = t.byte_size(llvm);
-  llvm::SmallVector<OpRef, 8> bytes;
-  bytes.reserve(width);
-
-  for (uint32_t i = 0; i < width; ++i) {
-    bytes.push_back(LoadOp::Create(data(), BinaryOp::CreateAdd(offset, i)));
-  }
-
-  if (t.is_int() && t.bitwidth() == 8) {
-    CAFFEINE_ASSERT(bytes.size() == 1);
-    return std::move(bytes[0]);
-  }
-
   uint32_t bitwidth = width * 8;
-  auto bitresult = UnaryOp::CreateZExt(Type::int_ty(bitwidth), bytes[0]);
-
-  for (uint32_t i = 1; i < width; ++i) {
-    // extended = zext(bytes[i], bitwidth) << (i * 8)
-    auto extended = BinaryOp::CreateShl(
-        UnaryOp::CreateZExt(Type::int_ty(bitwidth), bytes[i]), (uint64_t)i * 8);
-    bitresult = BinaryOp::CreateOr(bitresult, extended);
+  OpRef bitresult = load_bytes(offset, width, llvm.isLittleEndian());
+
+  if (!bitresult) {
+    if (width == 1) {
+      bitresult = LoadOp::Create(data(), offset);
+    } else {
+      bitresult = MultiLoadOp::Create(Type::int_ty(bitwidth), data(), offset,
+                                      llvm.isLittleEndian());
+    }
   }
 
   if (t.is_int()) {
@@ -230,26 +244,198 @@ void Allocation::write(const OpRef& offset, const OpRef& value_,
   uint32_t bitwidth = byte_width * 8;
 
   if (t.is_int()) {
-    if (t.bitwidth() == 8) {
-      overwrite(StoreOp::Create(data(), offset, value));
-      return;
-    }
-
     if (t.bitwidth() != bitwidth)
       value = UnaryOp::CreateZExt(Type::int_ty(bitwidth), value);
   } else {
     value = UnaryOp::CreateBitcast(Type::int_ty(bitwidth), value);
   }
 
-  for (uint32_t i = 0; i < byte_width; ++i) {
-    auto byte = UnaryOp::CreateTrunc(Type::int_ty(8),
-                                     BinaryOp::CreateLShr(value, i * 8));
-    auto index = BinaryOp::CreateAdd(offset, i);
+  if (store_bytes(offset, value, layout.isLittleEndian()))
+    return;
 
-    overwrite(StoreOp::Create(data(), index, byte));
+  if (byte_width == 1) {
+    overwrite(StoreOp::Create(data(), offset, value));
+  } else {
+    overwrite(
+        MultiStoreOp::Create(data(), offset, value, layout.isLittleEndian()));
   }
 }
 
+void Allocation::copy(const OpRef& offset, const Allocation& src,
+                      const OpRef& src_offset, uint64_t len) {
+  CAFFEINE_ASSERT(offset->type().is_int(),
+                  "tried to copy to a non-integer offset");
+  CAFFEINE_ASSERT(src_offset->type().is_int(),
+                  "tried to copy from a non-integer offset");
+  if (!(perms_ & AllocationPermissions::Write)) {
+    throw AllocationException("tried to write to unwritable allocation");
+  }
+  if (!(src.perms_ & AllocationPermissions::Read)) {
+    throw AllocationException("tried to read unreadable allocation");
+  }
+
+  if (len == 0)
+    return;
+
+  std::optional<uint64_t> dst = paged_offset(offset, len);
+  std::optional<uint64_t> from = src.paged_offset(src_offset, len);
+  if (dst && from) {
+    pages_->copy(*dst, *src.pages_, *from, len);
+    return;
+  }
+
+  auto byte_offset = [](const OpRef& base, uint64_t i) {
+    return BinaryOp::CreateAdd(
+        base, ConstantInt::Create(llvm::APInt(base->type().bitwidth(), i)));
+  };
+
+  // Read everything before writing anything in case the ranges overlap.
+  std::vector<OpRef> bytes;
+  bytes.reserve(len);
+  if (from) {
+    for (uint64_t i = 0; i < len; ++i)
+      bytes.push_back(src.pages_->load(*from + i));
+  } else {
+    OpRef src_data = src.data();
+    for (uint64_t i = 0; i < len; ++i)
+      bytes.push_back(LoadOp::Create(src_data, byte_offset(src_offset, i)));
+  }
+
+  if (dst) {
+    for (uint64_t i = 0; i < len; ++i)
+      pages_->store(*dst + i, bytes[i]);
+    return;
+  }
+
+  OpRef array = data();
+  for (uint64_t i = 0; i < len; ++i)
+    array = StoreOp::Create(array, byte_offset(offset, i), bytes[i]);
+  overwrite(std::move(array));
+}
+
+void Allocation::fill(const OpRef& offset, const OpRef& byte, uint64_t len) {
+  CAFFEINE_ASSERT(offset->type().is_int(),
+                  "tried to write at non-integer offset");
+  CAFFEINE_ASSERT(byte->type() == Type::int_ty(8));
+  if (!(perms_ & AllocationPermissions::Write)) {
+    throw AllocationException("tried to write to unwritable allocation");
+  }
+
+  if (std::optional<uint64_t> start = paged_offset(offset, len)) {
+    pages_->fill(*start, len, byte);
+    return;
+  }
+
+  OpRef array = data();
+  uint32_t bitwidth = offset->type().bitwidth();
+  for (uint64_t i = 0; i < len; ++i) {
+    array = StoreOp::Create(
+        array,
+        BinaryOp::CreateAdd(offset,
+                            ConstantInt::Create(llvm::APInt(bitwidth, i))),
+        byte);
+  }
+  overwrite(std::move(array));
+}
+
+std::optional<uint64_t> Allocation::paged_offset(const OpRef& offset,
+                                                uint64_t width) const {
+  if (!pages_)
+    return std::nullopt;
+
+  const auto* constoff = llvm::dyn_cast<ConstantInt>(offset.get());
+  if (!constoff || constoff->value().getActiveBits() > 64)
+    return std::nullopt;
+
+  uint64_t start = constoff->value().getZExtValue();
+  if (start > pages_->size() || pages_->size() - start < width)
+    return std::nullopt;
+  return start;
+}
+
+OpRef Allocation::load_bytes(const OpRef& offset, uint32_t width,
+                             bool little_endian) const {
+  namespace m = matching;
+
+  std::optional<uint64_t> start = paged_offset(offset, width);
+  if (!start)
+    return nullptr;
+
+  if (width == 1)
+    return pages_->load(*start);
+
+  // Fast path: all the bytes are concrete so we can build the constant
+  // directly.
+  llvm::APInt value(width * 8, 0);
+  bool concrete = true;
+  for (uint32_t i = 0; i < width && concrete; ++i) {
+    std::optional<uint8_t> byte = pages_->load_concrete(*start + i);
+    uint32_t shift = little_endian ? i : width - 1 - i;
+
+    if (byte)
+      value.insertBits(llvm::APInt(8, *byte), shift * 8);
+    else
+      concrete = false;
+  }
+
+  if (concrete)
+    return ConstantInt::Create(std::move(value));
+
+  // store_bytes splits symbolic values into (trunc (lshr value, shift))
+  // slices. If the range holds exactly the slices of one value then that
+  // value can be returned as-is instead of being put back together.
+  OpRef stored;
+  uint32_t low = little_endian ? 0 : width - 1;
+  if (matches(pages_->load(*start + low), m::Trunc(stored)) &&
+      stored->type() == Type::int_ty(width * 8)) {
+    bool whole = true;
+    for (uint32_t i = 0; i < width && whole; ++i) {
+      uint32_t shift = little_endian ? i : width - 1 - i;
+      OpRef slice = UnaryOp::CreateTrunc(
+          Type::int_ty(8), BinaryOp::CreateLShr(stored, shift * 8));
+
+      whole = *pages_->load(*start + i) == *slice;
+    }
+
+    if (whole)
+      return stored;
+  }
+
+  // Otherwise a single multi-byte load is cheaper to build and easier on the
+  // solver than reassembling the value out of its individual bytes.
+  return nullptr;
+}
+
+bool Allocation::store_bytes(const OpRef& offset, const OpRef& value,
+                             bool little_endian) {
+  uint32_t width = value->type().bitwidth() / 8;
+  std::optional<uint64_t> start = paged_offset(offset, width);
+  if (!start)
+    return false;
+
+  if (width == 1) {
+    pages_->store(*start, value);
+    return true;
+  }
+
+  const auto* constval = llvm::dyn_cast<ConstantInt>(value.get());
+  for (uint32_t i = 0; i < width; ++i) {
+    uint32_t shift = little_endian ? i : width - 1 - i;
+    OpRef byte;
+
+    if (constval) {
+      byte = ConstantInt::Create(constval->value().extractBits(8, shift * 8));
+    } else {
+      byte = UnaryOp::CreateTrunc(Type::int_ty(8),
+                                  BinaryOp::CreateLShr(value, shift * 8));
+    }
+
+    pages_->store(*start + i, byte);
+  }
+
+  return true;
+}
+
 void Allocation::write(const OpRef& offset, const LLVMScalar& value,
                        const MemHeapMgr& heapmgr,
                        const llvm::DataLayout& layout) {
@@ -32,17 +32,19 @@ std::optional<llvm::APInt> BumpAllocator::allocate(const llvm::APInt& size_,
   llvm::APInt pos = current;
   current += size;
 
-  allocations.insert(pos);
+  allocations = std::move(allocations).insert(pos);
 
   return pos;
 }
 
 void BumpAllocator::deallocate(const llvm::APInt& addr) {
   CAFFEINE_ASSERT(
-      allocations.erase(addr),
+      allocations.count(addr),
       fmt::format(
           FMT_STRING("attempted to deallocate an invalid address: 0x{:x}"),
           addr));
+
+  allocations = std::move(allocations).erase(addr);
 }
 
 } // namespace caffeine
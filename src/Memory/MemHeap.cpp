@@ -8,6 +8,7 @@
 #include "caffeine/Support/UnsupportedOperation.h"
 #include <algorithm>
 #include <llvm/ADT/SmallVector.h>
+#include <utility>
 
 namespace caffeine {
 
@@ -34,6 +35,35 @@ OpRef Pointer::value(const MemHeapMgr& heapmgr) const {
  * MemHeap                                         *
  ***************************************************/
 
+// The value of an expression, if the e-graph analysis is able to determine it.
+static std::optional<llvm::APInt> known_constant(const OpRef& value,
+                                                 Context& ctx) {
+  const EClass* eclass = ctx.egraph.get(ctx.egraph.add(*value));
+  if (!eclass->analysis)
+    return std::nullopt;
+  return eclass->analysis->constant();
+}
+
+// An upper bound on the unsigned value of value that holds on every path.
+static std::optional<llvm::APInt> known_umax(const OpRef& value,
+                                             Context& ctx) {
+  const EClass* eclass = ctx.egraph.get(ctx.egraph.add(*value));
+  if (!eclass->analysis)
+    return std::nullopt;
+  return eclass->analysis->range.getUnsignedMax();
+}
+
+// Whether value points within alloc with at least width bytes remaining.
+static OpRef points_within(const Allocation& alloc, const OpRef& value,
+                           const OpRef& width) {
+  auto end = BinaryOp::CreateAdd(alloc.address(),
+                                 BinaryOp::CreateSub(alloc.size(), width));
+  auto cmp1 = ICmpOp::CreateICmpULE(alloc.address(), value);
+  auto cmp2 = ICmpOp::CreateICmpULE(value, end);
+
+  return BinaryOp::CreateAnd(cmp1, cmp2);
+}
+
 MemHeap::MemHeap(unsigned index, bool concrete) : index_(index) {
   if (concrete)
     allocator_.emplace<Uninit>();
@@ -50,6 +80,13 @@ const Allocation& MemHeap::operator[](const AllocId& alloc) const {
   return allocs_.at(alloc);
 }
 
+persistent_slot_map<Allocation>::const_iterator MemHeap::begin() const {
+  return allocs_.begin();
+}
+persistent_slot_map<Allocation>::const_iterator MemHeap::end() const {
+  return allocs_.end();
+}
+
 AllocId MemHeap::allocate(const OpRef& size, const OpRef& alignment,
                           const OpRef& data, AllocationKind kind,
                           AllocationPermissions permissions, Context& ctx) {
@@ -58,7 +95,12 @@ AllocId MemHeap::allocate(const OpRef& size, const OpRef& alignment,
   CAFFEINE_ASSERT(!data->type().is_array() ||
                   data->type().bitwidth() == size->type().bitwidth());
 
-  auto addr = alloc_addr(size, alignment, ctx);
+  std::optional<OpRef> placed = concrete_addr(size, alignment, ctx);
+  if (!placed)
+    placed = region_addr(size, ctx);
+
+  auto addr = placed ? *placed
+                     : Constant::Create(size->type(), ctx.next_constant());
   auto newalloc = Allocation(addr, size, data, kind, permissions);
 
   // Ensure that the allocation is properly aligned
@@ -72,7 +114,7 @@ AllocId MemHeap::allocate(const OpRef& size, const OpRef& alignment,
   // The allocation is not null
   ctx.add(ICmpOp::CreateICmpNE(newalloc.address(), 0));
 
-  for (const auto& alloc : allocs_) {
+  auto assert_no_overlap = [&](const Allocation& alloc) {
     /**
      * Ensure that the new allocation doesn't overlap with any of the existing
      * allocations.
@@ -95,9 +137,42 @@ AllocId MemHeap::allocate(const OpRef& size, const OpRef& alignment,
     auto cmp2 = ICmpOp::CreateICmpULE(new_end, old_start);
 
     ctx.add(Assertion(BinaryOp::CreateOr(cmp1, cmp2)));
+  };
+
+  // Placed allocations can only overlap with allocations that weren't placed.
+  if (placed) {
+    for (const AllocId& id : overlapping_)
+      assert_no_overlap(std::as_const(allocs_).at(id));
+  } else {
+    for (const auto& alloc : allocs_)
+      assert_no_overlap(alloc);
+  }
+
+  AllocId id = allocs_.insert(newalloc);
+  if (!placed)
+    overlapping_ = std::move(overlapping_).insert(id);
+
+  // Only allocations whose end can be computed without wrapping around the
+  // address space are placed in the index.
+  const auto* start = llvm::dyn_cast<ConstantInt>(newalloc.address().get());
+  std::optional<llvm::APInt> alloc_size = known_constant(newalloc.size(), ctx);
+  if (start && alloc_size) {
+    llvm::APInt end = start->value() + *alloc_size;
+    if (end.uge(start->value())) {
+      auto it = std::upper_bound(
+          addr_index_.begin(), addr_index_.end(), start->value(),
+          [](const llvm::APInt& addr, const IndexEntry& entry) {
+            return addr.ult(entry.start);
+          });
+      addr_index_ = std::move(addr_index_)
+                        .insert(it - addr_index_.begin(),
+                                IndexEntry{start->value(), std::move(end), id});
+      return id;
+    }
   }
 
-  return allocs_.insert(newalloc);
+  unindexed_ = std::move(unindexed_).insert(id);
+  return id;
 }
 
 void MemHeap::deallocate(const AllocId& alloc) {
@@ -108,12 +183,26 @@ void MemHeap::deallocate(const AllocId& alloc) {
   CAFFEINE_ASSERT(value.has_value(),
                   "tried to deallocate a nonexistant allocation");
 
-  if (allocator_.index() == Init) {
-    std::get<Init>(allocator_)
-        .deallocate(llvm::cast<ConstantInt>(*value->address()).value());
+  overlapping_ = std::move(overlapping_).erase(alloc);
+  if (unindexed_.count(alloc)) {
+    unindexed_ = std::move(unindexed_).erase(alloc);
   } else {
-    allocator_.emplace<Symbolic>();
+    const llvm::APInt& start =
+        llvm::cast<ConstantInt>(*value->address()).value();
+    auto it = std::lower_bound(
+        addr_index_.begin(), addr_index_.end(), start,
+        [](const IndexEntry& entry, const llvm::APInt& addr) {
+          return entry.start.ult(addr);
+        });
+    CAFFEINE_ASSERT(it != addr_index_.end() && it->alloc == alloc);
+    addr_index_ = std::move(addr_index_).erase(it - addr_index_.begin());
   }
+
+  // Symbolic allocations don't use the concrete allocator so there is nothing
+  // to release for them.
+  const auto* addr = llvm::dyn_cast<ConstantInt>(value->address().get());
+  if (addr && allocator_.index() == Init)
+    std::get<Init>(allocator_).deallocate(addr->value());
 }
 
 bool MemHeap::check_live(const AllocId& alloc) const {
@@ -143,14 +232,24 @@ Assertion MemHeap::check_valid(const Pointer& ptr, const OpRef& width) {
   auto result = ConstantInt::Create(false);
   auto value = ptr.value(*this);
 
-  for (const auto& alloc : allocs_) {
-    auto end = BinaryOp::CreateAdd(alloc.address(),
-                                   BinaryOp::CreateSub(alloc.size(), width));
-    auto cmp1 = ICmpOp::CreateICmpULE(alloc.address(), value);
-    auto cmp2 = ICmpOp::CreateICmpULE(value, end);
+  // result |= (address <= value) && (value <= address + size - width)
+  for (const auto& alloc : allocs_)
+    result = BinaryOp::CreateOr(result, points_within(alloc, value, width));
+
+  // Note: NULL pointers are never valid.
+  return BinaryOp::CreateAnd(ICmpOp::CreateICmpNE(value, 0), result);
+}
+Assertion MemHeap::check_valid(const Pointer& ptr, const OpRef& width,
+                               Context& ctx) {
+  if (ptr.is_resolved())
+    return check_valid(ptr, width);
+
+  auto result = ConstantInt::Create(false);
+  auto value = ptr.value(*this);
 
-    // result |= (address <= value) && (value < address + size)
-    result = BinaryOp::CreateOr(result, BinaryOp::CreateAnd(cmp1, cmp2));
+  for (const AllocId& id : candidates(value, width, ctx)) {
+    const Allocation& alloc = std::as_const(allocs_).at(id);
+    result = BinaryOp::CreateOr(result, points_within(alloc, value, width));
   }
 
   // Note: NULL pointers are never valid.
@@ -198,10 +297,10 @@ llvm::SmallVector<Pointer, 1> MemHeap::resolve(std::shared_ptr<Solver> solver,
   }
 
   auto value = ptr.value(*this);
+  auto width = ConstantInt::Create(llvm::APInt(value->type().bitwidth(), 1));
 
-  auto end = allocs_.end();
-  for (auto it = allocs_.begin(); it != end; ++it) {
-    const auto& alloc = *it;
+  for (const AllocId& id : candidates(value, width, ctx)) {
+    const auto& alloc = allocs_.at(id);
 
     auto end = BinaryOp::CreateAdd(alloc.address(), alloc.size());
     auto cmp1 = ICmpOp::CreateICmpULE(alloc.address(), value);
@@ -209,42 +308,128 @@ llvm::SmallVector<Pointer, 1> MemHeap::resolve(std::shared_ptr<Solver> solver,
     auto assertion = BinaryOp::CreateAnd(cmp1, cmp2);
 
     if (ctx.check(solver, Assertion(assertion)) != SolverResult::UNSAT) {
-      results.push_back(Pointer(
-          it.key(), BinaryOp::CreateSub(value, alloc.address()), ptr.heap()));
+      results.push_back(
+          Pointer(id, BinaryOp::CreateSub(value, alloc.address()), ptr.heap()));
     }
   }
 
   return results;
 }
-OpRef MemHeap::alloc_addr(const OpRef& size_, const OpRef& align_,
-                          Context& ctx) {
-  if (allocator_.index() != Symbolic) {
-    ctx.egraph.rebuild();
-    EGraphExtractor extractor{&ctx.egraph};
-    OpRef size = extractor.extract(*size_);
-    OpRef align = extractor.extract(*align_);
-
-    if (!llvm::isa<ConstantInt>(*size) || !llvm::isa<ConstantInt>(*align)) {
-      allocator_.emplace<Symbolic>();
-      goto symbolic;
-    }
 
-    if (allocator_.index() == Uninit) {
-      unsigned bitwidth = size->type().bitwidth();
-      allocator_.emplace<Init>(llvm::APInt::getSignedMinValue(bitwidth),
-                               llvm::APInt::getSignedMinValue(bitwidth));
-    }
+llvm::SmallVector<AllocId, 4> MemHeap::candidates(const OpRef& value,
+                                                  const OpRef& width,
+                                                  Context& ctx) const {
+  llvm::SmallVector<AllocId, 4> results(unindexed_.begin(), unindexed_.end());
+
+  // Without a concrete width we cannot tell where the valid range within each
+  // allocation ends so every allocation has to be considered.
+  const auto* width_val = llvm::dyn_cast<ConstantInt>(width.get());
+  if (!width_val) {
+    for (const auto& entry : addr_index_)
+      results.push_back(entry.alloc);
+    return results;
+  }
 
-    auto addr = std::get<Init>(allocator_)
-                    .allocate(llvm::cast<ConstantInt>(*size).value(),
-                              llvm::cast<ConstantInt>(*align).value());
-    if (addr)
-      return ConstantInt::Create(std::move(*addr));
-    allocator_.emplace<Symbolic>();
+  // A wrapped range gives us a min of 0 and a max of UINT_MAX which just
+  // degrades to checking all the indexed allocations.
+  const EClass* eclass = ctx.egraph.get(ctx.egraph.add(*value));
+  uint32_t bitwidth = value->type().bitwidth();
+  llvm::ConstantRange range = eclass->analysis
+                                  ? eclass->analysis->range
+                                  : llvm::ConstantRange::getFull(bitwidth);
+  llvm::APInt lo = range.getUnsignedMin();
+  llvm::APInt hi = range.getUnsignedMax();
+  const llvm::APInt& bytes = width_val->value();
+
+  // Find the first allocation that could contain lo. Allocations don't
+  // overlap so their end addresses are sorted as well.
+  auto it = std::upper_bound(addr_index_.begin(), addr_index_.end(), lo,
+                             [](const llvm::APInt& addr,
+                                const IndexEntry& entry) {
+                               return addr.ult(entry.start);
+                             });
+  while (it != addr_index_.begin() && std::prev(it)->end.uge(lo))
+    --it;
+
+  for (; it != addr_index_.end() && it->start.ule(hi); ++it) {
+    const llvm::APInt& start = it->start;
+    const llvm::APInt& end = it->end;
+
+    // An access wider than the allocation is never within it.
+    if (bytes.ugt(end - start))
+      continue;
+    if ((end - bytes).ult(lo))
+      continue;
+
+    results.push_back(it->alloc);
   }
 
-symbolic:
-  return Constant::Create(size_->type(), ctx.next_constant());
+  return results;
+}
+std::optional<OpRef> MemHeap::concrete_addr(const OpRef& size_,
+                                            const OpRef& align_,
+                                            Context& ctx) {
+  if (allocator_.index() == Symbolic)
+    return std::nullopt;
+
+  ctx.egraph.rebuild();
+  EGraphExtractor extractor{&ctx.egraph};
+  OpRef size = extractor.extract(*size_);
+  OpRef align = extractor.extract(*align_);
+
+  if (!llvm::isa<ConstantInt>(*size) || !llvm::isa<ConstantInt>(*align))
+    return std::nullopt;
+
+  if (allocator_.index() == Uninit) {
+    unsigned bitwidth = size->type().bitwidth();
+    allocator_.emplace<Init>(llvm::APInt::getSignedMinValue(bitwidth),
+                             llvm::APInt::getSignedMinValue(bitwidth));
+  }
+
+  auto addr = std::get<Init>(allocator_)
+                  .allocate(llvm::cast<ConstantInt>(*size).value(),
+                            llvm::cast<ConstantInt>(*align).value());
+  if (addr)
+    return ConstantInt::Create(std::move(*addr));
+
+  // The concrete allocator never reuses addresses so once it is out of space
+  // it stays that way.
+  allocator_.emplace<Symbolic>();
+  return std::nullopt;
+}
+
+std::optional<OpRef> MemHeap::region_addr(const OpRef& size, Context& ctx) {
+  // The top bit is reserved for concrete allocations and the next quarter of
+  // the bits select the region. The remaining bits are the offset within the
+  // region.
+  uint32_t bitwidth = size->type().bitwidth();
+  uint32_t region_bits = std::min(bitwidth / 4, 63u);
+  if (region_bits == 0 || next_region_ >= (UINT64_C(1) << region_bits))
+    return std::nullopt;
+
+  uint32_t offset_bits = bitwidth - 1 - region_bits;
+  llvm::APInt region_bytes = llvm::APInt::getOneBitSet(bitwidth, offset_bits);
+
+  // Asserting that the size fits within the region would silently drop the
+  // paths where it doesn't. Allocations that might be larger than a region
+  // get a fully symbolic address instead.
+  std::optional<llvm::APInt> max_size = known_umax(size, ctx);
+  if (!max_size || max_size->ugt(region_bytes))
+    return std::nullopt;
+
+  auto base = ConstantInt::Create(llvm::APInt(bitwidth, next_region_++)
+                                  << offset_bits);
+  auto region_size = ConstantInt::Create(region_bytes);
+
+  auto offset = UnaryOp::CreateZExt(
+      size->type(),
+      Constant::Create(Type::int_ty(offset_bits), ctx.next_constant()));
+
+  // The whole allocation must fit within the region.
+  ctx.add(ICmpOp::CreateICmpULE(offset,
+                                BinaryOp::CreateSub(region_size, size)));
+
+  return BinaryOp::CreateAdd(base, offset);
 }
 
 /***************************************************
@@ -276,6 +461,14 @@ const MemHeap& MemHeapMgr::function_heap() const {
   return (*this)[MemHeapMgr::FUNCTION_INDEX];
 }
 
+llvm::SmallDenseMap<unsigned, MemHeap>::const_iterator
+MemHeapMgr::begin() const {
+  return heaps_.begin();
+}
+llvm::SmallDenseMap<unsigned, MemHeap>::const_iterator MemHeapMgr::end() const {
+  return heaps_.end();
+}
+
 Allocation& MemHeapMgr::ptr_allocation(const Pointer& ptr) {
   CAFFEINE_ASSERT(ptr.is_resolved(),
                   "cannot get allocation for an unresolved pointer");
@@ -294,6 +487,10 @@ Assertion MemHeapMgr::check_valid(const Pointer& ptr, uint32_t width) {
 Assertion MemHeapMgr::check_valid(const Pointer& ptr, const OpRef& width) {
   return (*this)[ptr.heap()].check_valid(ptr, width);
 }
+Assertion MemHeapMgr::check_valid(const Pointer& ptr, const OpRef& width,
+                                  Context& ctx) {
+  return (*this)[ptr.heap()].check_valid(ptr, width, ctx);
+}
 
 Assertion MemHeapMgr::check_starts_allocation(const Pointer& value) {
   return (*this)[value.heap()].check_starts_allocation(value);
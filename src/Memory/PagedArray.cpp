@@ -0,0 +1,271 @@
+#include "caffeine/Memory/PagedArray.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Support/Assert.h"
+#include <algorithm>
+
+namespace caffeine {
+
+PagedArray::PagedArray(const OpRef& base, uint64_t size)
+    : base_(base), size_(size) {
+  CAFFEINE_ASSERT(base->type().is_array());
+}
+
+uint64_t PagedArray::size() const {
+  return size_;
+}
+
+OpRef PagedArray::load(uint64_t offset) const {
+  CAFFEINE_ASSERT(offset < size_, "load from paged array was out of bounds");
+
+  auto it = pages_.find(offset / PageSize);
+  if (it == pages_.end()) {
+    return LoadOp::Create(
+        base_, ConstantInt::Create(
+                   llvm::APInt(base_->type().bitwidth(), offset)));
+  }
+
+  const Page& page = *it->second;
+  uint64_t index = offset % PageSize;
+  if (!page.symbolic.empty() && page.symbolic[index])
+    return page.symbolic[index];
+  return ConstantInt::Create(llvm::APInt(8, page.bytes[index]));
+}
+
+std::optional<uint8_t> PagedArray::load_concrete(uint64_t offset) const {
+  CAFFEINE_ASSERT(offset < size_, "load from paged array was out of bounds");
+
+  auto it = pages_.find(offset / PageSize);
+  if (it == pages_.end()) {
+    OpRef byte = load(offset);
+    if (const auto* value = llvm::dyn_cast<ConstantInt>(byte.get()))
+      return (uint8_t)value->value().getZExtValue();
+    return std::nullopt;
+  }
+
+  const Page& page = *it->second;
+  uint64_t index = offset % PageSize;
+  if (!page.symbolic.empty() && page.symbolic[index])
+    return std::nullopt;
+  return page.bytes[index];
+}
+
+void PagedArray::store(uint64_t offset, const OpRef& byte) {
+  CAFFEINE_ASSERT(offset < size_, "store to paged array was out of bounds");
+  CAFFEINE_ASSERT(byte->type() == Type::int_ty(8));
+
+  put(offset, byte);
+
+  // Keep the materialized array up to date instead of rebuilding it from
+  // scratch the next time it is needed. Storing into a FixedArray copies the
+  // whole array so in that case it is cheaper to rebuild it.
+  if (cache_ && !cache_->is<FixedArray>()) {
+    cache_ = StoreOp::Create(
+        cache_,
+        ConstantInt::Create(llvm::APInt(base_->type().bitwidth(), offset)),
+        byte);
+  } else {
+    cache_ = nullptr;
+  }
+}
+
+void PagedArray::copy(uint64_t offset, const PagedArray& src_,
+                      uint64_t src_offset, uint64_t len) {
+  CAFFEINE_ASSERT(offset <= size_ && size_ - offset >= len,
+                  "copy to paged array was out of bounds");
+  CAFFEINE_ASSERT(src_offset <= src_.size_ && src_.size_ - src_offset >= len,
+                  "copy from paged array was out of bounds");
+
+  if (len == 0)
+    return;
+
+  // Copying from a snapshot of the source means that overlapping copies
+  // within the same array don't observe their own writes. Copies share their
+  // pages so this is cheap.
+  const PagedArray src = src_;
+
+  uint64_t i = 0;
+  while (i < len) {
+    uint64_t dst = offset + i;
+    uint64_t from = src_offset + i;
+
+    if (dst % PageSize == 0 && from % PageSize == 0 && len - i >= PageSize) {
+      auto it = src.pages_.find(from / PageSize);
+      if (it != src.pages_.end()) {
+        std::shared_ptr<Page>& page = pages_[dst / PageSize];
+        page = it->second;
+
+        // Bytes that the source never wrote come from its base array, which
+        // may not be the same as ours.
+        if (src.base_ != base_ && !page->written.all()) {
+          page = std::make_shared<Page>(*page);
+          page->written.set();
+        }
+
+        i += PageSize;
+        continue;
+      }
+    }
+
+    if (std::optional<uint8_t> byte = src.load_concrete(from))
+      put(dst, *byte);
+    else
+      put(dst, src.load(from));
+    i += 1;
+  }
+
+  cache_ = nullptr;
+}
+
+void PagedArray::fill(uint64_t offset, uint64_t len, const OpRef& byte) {
+  CAFFEINE_ASSERT(offset <= size_ && size_ - offset >= len,
+                  "fill of paged array was out of bounds");
+  CAFFEINE_ASSERT(byte->type() == Type::int_ty(8));
+
+  const auto* value = llvm::dyn_cast<ConstantInt>(byte.get());
+  uint64_t end = offset + len;
+
+  while (offset < end) {
+    uint64_t index = offset / PageSize;
+    uint64_t start = offset % PageSize;
+    uint64_t count = std::min(PageSize - start, end - offset);
+
+    // Pages that are completely overwritten don't need to be initialized
+    // from the base array first.
+    Page* page;
+    if (count == PageSize) {
+      auto& entry = pages_[index];
+      entry = std::make_shared<Page>();
+      page = entry.get();
+    } else {
+      page = &page_mut(index);
+    }
+
+    for (uint64_t i = start; i < start + count; ++i)
+      page->written.set(i);
+
+    if (value) {
+      std::fill_n(page->bytes.begin() + start, count,
+                  (uint8_t)value->value().getZExtValue());
+      if (!page->symbolic.empty())
+        std::fill_n(page->symbolic.begin() + start, count, nullptr);
+    } else {
+      if (page->symbolic.empty())
+        page->symbolic.resize(PageSize);
+      std::fill_n(page->symbolic.begin() + start, count, byte);
+    }
+
+    offset += count;
+  }
+
+  cache_ = nullptr;
+}
+
+OpRef PagedArray::materialize() const {
+  if (pages_.empty())
+    return base_;
+  if (cache_)
+    return cache_;
+
+  // Only the bytes that were actually written need to be stored on top of
+  // the base array. Everything else still has the value from the base array.
+  uint32_t bitwidth = base_->type().bitwidth();
+  OpRef array = base_;
+  for (const auto& [index, page] : pages_) {
+    if (page->written.none())
+      continue;
+
+    uint64_t start = index * PageSize;
+    uint64_t end = std::min(start + PageSize, size_);
+
+    for (uint64_t offset = start; offset < end; ++offset) {
+      if (!page->written.test(offset - start))
+        continue;
+
+      array = StoreOp::Create(
+          array, ConstantInt::Create(llvm::APInt(bitwidth, offset)),
+          load(offset));
+    }
+  }
+
+  cache_ = array;
+  return cache_;
+}
+
+void PagedArray::overwrite(const OpRef& base) {
+  CAFFEINE_ASSERT(base->type() == base_->type());
+
+  base_ = base;
+  pages_.clear();
+  cache_ = nullptr;
+}
+
+void PagedArray::visit(function_view<void(const OpRef&)> visitor) const {
+  visitor(base_);
+  if (cache_)
+    visitor(cache_);
+
+  for (const auto& [index, page] : pages_) {
+    for (const OpRef& byte : page->symbolic) {
+      if (byte)
+        visitor(byte);
+    }
+  }
+}
+
+PagedArray::Page& PagedArray::page_mut(uint64_t index) {
+  std::shared_ptr<Page>& page = pages_[index];
+
+  if (!page) {
+    // New pages start out with the current contents of the base array.
+    page = std::make_shared<Page>();
+    uint64_t start = index * PageSize;
+    uint64_t end = std::min(start + PageSize, size_);
+
+    for (uint64_t offset = start; offset < end; ++offset) {
+      OpRef byte = LoadOp::Create(
+          base_, ConstantInt::Create(
+                     llvm::APInt(base_->type().bitwidth(), offset)));
+
+      if (const auto* value = llvm::dyn_cast<ConstantInt>(byte.get())) {
+        page->bytes[offset - start] = (uint8_t)value->value().getZExtValue();
+        continue;
+      }
+
+      if (page->symbolic.empty())
+        page->symbolic.resize(PageSize);
+      page->symbolic[offset - start] = std::move(byte);
+    }
+  } else if (page.use_count() > 1) {
+    // The page is shared with another copy of this array.
+    page = std::make_shared<Page>(*page);
+  }
+
+  return *page;
+}
+
+void PagedArray::put(uint64_t offset, const OpRef& byte) {
+  if (const auto* value = llvm::dyn_cast<ConstantInt>(byte.get())) {
+    put(offset, (uint8_t)value->value().getZExtValue());
+    return;
+  }
+
+  Page& page = page_mut(offset / PageSize);
+  uint64_t index = offset % PageSize;
+
+  if (page.symbolic.empty())
+    page.symbolic.resize(PageSize);
+  page.symbolic[index] = byte;
+  page.written.set(index);
+}
+
+void PagedArray::put(uint64_t offset, uint8_t byte) {
+  Page& page = page_mut(offset / PageSize);
+  uint64_t index = offset % PageSize;
+
+  page.bytes[index] = byte;
+  if (!page.symbolic.empty())
+    page.symbolic[index] = nullptr;
+  page.written.set(index);
+}
+
+} // namespace caffeine
@@ -54,6 +54,11 @@ void GraphAssertionList::canonicalize(const EGraph& egraph) {
     }
   }
 
+  // The loop above only marks assertions as proven when it reaches the mark.
+  // If every assertion was proven then it never gets there.
+  if (mark_ >= size())
+    canonical.mark_sat();
+
 done:
   *this = std::move(canonical);
 }
@@ -96,6 +101,7 @@ void GraphAssertionList::restore(size_t checkpoint) {
   }
 
   list_.resize(checkpoint);
+  mark_ = std::min(mark_, checkpoint);
 }
 
 } // namespace caffeine
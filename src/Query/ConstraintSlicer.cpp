@@ -1,51 +1,217 @@
 #include "caffeine/Query/ConstraintSlicer.h"
 #include "caffeine/Model/AssertionList.h"
+#include <algorithm>
 
 namespace caffeine {
 
+void ConstraintSlicer::reset() {
+  proven_.clear();
+  proven_symbol_.clear();
+  symbol_ids_.clear();
+  components_ = UnionFind<size_t>();
+}
+
+void ConstraintSlicer::add_proven(const Assertion& assertion) {
+  size_t first = npos;
+
+  for (const Symbol& symbol : contained_constants(assertion.value())) {
+    auto [it, inserted] = symbol_ids_.try_emplace(symbol, 0);
+    if (inserted)
+      it->second = components_.make_set();
+
+    if (first == npos) {
+      first = it->second;
+      continue;
+    }
+
+    size_t lhs = components_.find(first);
+    size_t rhs = components_.find(it->second);
+    if (lhs != rhs)
+      components_.do_union(lhs, rhs);
+  }
+
+  proven_.push_back(assertion);
+  proven_symbol_.push_back(first);
+}
+
+void ConstraintSlicer::sync_proven(const AssertionList& assertions) {
+  auto proven = assertions.proven();
+
+  size_t common = 0;
+  auto it = proven.begin();
+  for (; it != proven.end() && common < proven_.size(); ++it, ++common) {
+    if (*it != proven_[common])
+      break;
+  }
+
+  if (common < proven_.size()) {
+    reset();
+    it = proven.begin();
+  }
+
+  for (; it != proven.end(); ++it)
+    add_proven(*it);
+}
+
 AssertionList ConstraintSlicer::slice(const AssertionList& assertions,
                                       const Assertion& extra) {
   /**
-   * The algorithm used here is quite simple, we just add all the assertions
-   * that share variables with the unproven set, and any assertions that share
-   * variables with those ones, and so on.
-   *
-   * More formally, we could form a graph with the assertions as the vertices
-   * and edges between those that share a constant. Then, we need to find all
-   * vertices that are connected to the set of unproven assertions.
-   *
-   * Either way, the algorithm is the same: we just perform a DFS to find all
-   * the assertions.
+   * We want all the proven assertions that are transitively connected to the
+   * unproven assertions or extra through shared symbols. The union-find built
+   * by sync_proven already has the connected components of the proven
+   * assertions so all we need to do is find the components touched by the
+   * unproven set and take every proven assertion within them.
    */
+  sync_proven(assertions);
 
-  std::unordered_map<Symbol, llvm::SmallVector<Assertion, 4>> known;
-  for (const Assertion& assertion : assertions.proven()) {
+  std::unordered_set<size_t> roots;
+  auto mark = [&](const Assertion& assertion) {
     for (const Symbol& symbol : contained_constants(assertion.value())) {
-      known[symbol].push_back(assertion);
+      auto it = symbol_ids_.find(symbol);
+      if (it != symbol_ids_.end())
+        roots.insert(components_.find(it->second));
     }
-  }
+  };
+
+  for (const Assertion& assertion : assertions.unproven())
+    mark(assertion);
+  mark(extra);
 
   AssertionList list;
-  for (const Assertion& assertion : assertions.unproven()) {
+  for (size_t i = 0; i < proven_.size(); ++i) {
+    if (proven_symbol_[i] == npos)
+      continue;
+    if (roots.count(components_.find(proven_symbol_[i])))
+      list.insert(proven_[i]);
+  }
+  list.mark_sat();
+
+  for (const Assertion& assertion : assertions.unproven())
     list.insert(assertion);
+
+  return list;
+}
+
+std::vector<ConstraintSlicer::Component>
+ConstraintSlicer::partition(const AssertionList& assertions,
+                            const Assertion& extra) {
+  sync_proven(assertions);
+
+  // Unproven assertions and extra can join together components of the proven
+  // prefix. We don't want to modify the persistent union-find with them so we
+  // build a second union-find on top of the roots of the first one.
+  UnionFind<size_t> local;
+  std::unordered_map<size_t, size_t> root_ids;
+  std::unordered_map<Symbol, size_t> unknown_ids;
+
+  auto root_id = [&](size_t root) {
+    auto [it, inserted] = root_ids.try_emplace(root, 0);
+    if (inserted)
+      it->second = local.make_set();
+    return it->second;
+  };
+  auto symbol_id = [&](const Symbol& symbol) {
+    auto it = symbol_ids_.find(symbol);
+    if (it != symbol_ids_.end())
+      return root_id(components_.find(it->second));
+
+    auto [uit, inserted] = unknown_ids.try_emplace(symbol, 0);
+    if (inserted)
+      uit->second = local.make_set();
+    return uit->second;
+  };
+  auto join = [&](const Assertion& assertion) {
+    size_t first = npos;
     for (const Symbol& symbol : contained_constants(assertion.value())) {
-      auto it = known.find(symbol);
-      if (it != known.end())
-        list.insert(it->second);
+      size_t id = symbol_id(symbol);
+      if (first == npos) {
+        first = id;
+        continue;
+      }
+
+      size_t lhs = local.find(first);
+      size_t rhs = local.find(id);
+      if (lhs != rhs)
+        local.do_union(lhs, rhs);
+    }
+    return first;
+  };
+
+  llvm::SmallVector<size_t, 16> unproven_ids;
+  for (const Assertion& assertion : assertions.unproven())
+    unproven_ids.push_back(join(assertion));
+
+  size_t extra_id = npos;
+  if (!extra.is_constant_value(true))
+    extra_id = join(extra);
+
+  std::vector<Component> components;
+  std::unordered_map<size_t, size_t> groups;
+  // Assertions which don't reference any symbols all go into one component.
+  size_t constant_group = npos;
+
+  auto group_of = [&](size_t id) -> Component& {
+    size_t index;
+    if (id == npos) {
+      if (constant_group == npos) {
+        constant_group = components.size();
+        components.emplace_back();
+      }
+      index = constant_group;
+    } else {
+      auto [it, inserted] = groups.try_emplace(local.find(id), 0);
+      if (inserted) {
+        it->second = components.size();
+        components.emplace_back();
+      }
+      index = it->second;
     }
-  }
 
-  for (const Symbol& symbol : contained_constants(extra.value())) {
-    auto it = known.find(symbol);
-    if (it != known.end())
-      list.insert(it->second);
+    return components[index];
+  };
+
+  for (size_t i = 0; i < proven_.size(); ++i) {
+    // Proven assertions without symbols are constant and known to be
+    // satisfiable so they can be dropped entirely.
+    if (proven_symbol_[i] == npos)
+      continue;
+
+    size_t id = root_id(components_.find(proven_symbol_[i]));
+    group_of(id).assertions.insert(proven_[i]);
   }
 
+  for (Component& component : components)
+    component.assertions.mark_sat();
+
+  size_t index = 0;
   for (const Assertion& assertion : assertions.unproven()) {
-    list.insert(assertion);
+    Component& component = group_of(unproven_ids[index++]);
+    component.assertions.insert(assertion);
+    component.unproven = true;
   }
 
-  return list;
+  if (!extra.is_constant_value(true)) {
+    Component& component = group_of(extra_id);
+    component.extra = extra;
+    component.unproven = true;
+  }
+
+  for (Component& component : components) {
+    std::unordered_set<Symbol> symbols;
+    for (const Assertion& assertion : component.assertions) {
+      auto contained = contained_constants(assertion.value());
+      symbols.insert(contained.begin(), contained.end());
+    }
+    auto contained = contained_constants(component.extra.value());
+    symbols.insert(contained.begin(), contained.end());
+
+    component.symbols.assign(symbols.begin(), symbols.end());
+  }
+
+  std::stable_partition(components.begin(), components.end(),
+                        [](const Component& c) { return c.unproven; });
+
+  return components;
 }
 
 llvm::ArrayRef<Symbol>
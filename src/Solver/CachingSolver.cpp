@@ -0,0 +1,160 @@
+#include "caffeine/Solver/CachingSolver.h"
+#include "caffeine/Solver/ModelEval.h"
+#include "caffeine/Support/Tracing.h"
+#include <algorithm>
+#include <llvm/ADT/Hashing.h>
+
+namespace caffeine {
+
+CachingSolver::CachingSolver(const std::shared_ptr<Solver>& inner,
+                             const CachingSolverOptions& options)
+    : inner(inner), options(options) {}
+
+size_t CachingSolver::KeyHash::operator()(const Key& key) const {
+  llvm::hash_code code = llvm::hash_value(key.size());
+  for (const Assertion& assertion : key)
+    code = llvm::hash_combine(code, std::hash<Assertion>()(assertion));
+  return static_cast<size_t>(code);
+}
+
+CachingSolver::Key CachingSolver::make_key(const AssertionList& assertions,
+                                           const Assertion& extra) {
+  Key key;
+  key.reserve(assertions.size() + 1);
+
+  for (const Assertion& assertion : assertions) {
+    if (assertion.is_empty() || assertion.is_constant_value(true))
+      continue;
+    key.push_back(assertion);
+  }
+  if (!extra.is_empty() && !extra.is_constant_value(true))
+    key.push_back(extra);
+
+  // Operations are hash-consed so pointer identity gives us a consistent order
+  // for as long as the operations are alive. Any assertion stored within the
+  // cache is kept alive by the cache itself.
+  std::sort(key.begin(), key.end(), [](const auto& a, const auto& b) {
+    return a.value().get() < b.value().get();
+  });
+  key.erase(std::unique(key.begin(), key.end()), key.end());
+
+  return key;
+}
+
+std::shared_ptr<const Model> CachingSolver::find_model(const Key& key) {
+  for (auto it = models_.begin(); it != models_.end(); ++it) {
+    ModelEvaluator evaluator{it->get(), &egraph_};
+
+    bool satisfied = std::all_of(key.begin(), key.end(), [&](const auto& a) {
+      return evaluator.visit(*a.value()).apint().getBoolValue();
+    });
+
+    if (!satisfied)
+      continue;
+
+    // Keep models that keep getting used near the front.
+    auto model = *it;
+    models_.erase(it);
+    models_.push_front(model);
+    return model;
+  }
+
+  return nullptr;
+}
+
+SolverResult CachingSolver::lookup(const Key& key, bool need_model) {
+  auto it = sat_.find(key);
+  if (it != sat_.end() && (it->second || !need_model))
+    return SolverResult(SolverResult::SAT, it->second);
+
+  if (unsat_.contains_subset(key))
+    return SolverResult::UNSAT;
+
+  if (models_.empty())
+    return SolverResult::Unknown;
+
+  bool evaluable = std::all_of(key.begin(), key.end(), [](const auto& a) {
+    return ModelEvaluator::supports(*a.value());
+  });
+  if (!evaluable)
+    return SolverResult::Unknown;
+
+  if (auto model = find_model(key))
+    return SolverResult(SolverResult::SAT, std::move(model));
+
+  return SolverResult::Unknown;
+}
+
+void CachingSolver::record(Key&& key, const SolverResult& result) {
+  switch (result.kind()) {
+  case SolverResult::UNSAT:
+    // An empty query is trivially SAT so this should only happen if the inner
+    // solver was interrupted in some strange way. Caching it would make every
+    // other query UNSAT.
+    if (key.empty())
+      break;
+
+    if (unsat_count_ >= options.max_unsat) {
+      unsat_.clear();
+      unsat_count_ = 0;
+    }
+
+    unsat_.insert(key);
+    unsat_count_ += 1;
+    break;
+
+  case SolverResult::SAT:
+    if (sat_.size() >= options.max_sat)
+      sat_.clear();
+
+    if (const auto& model = result.shared_model()) {
+      models_.push_front(model);
+      if (models_.size() > options.max_models)
+        models_.pop_back();
+    }
+
+    sat_.insert_or_assign(std::move(key), result.shared_model());
+    break;
+
+  case SolverResult::Unknown:
+    break;
+  }
+}
+
+SolverResult CachingSolver::check(AssertionList& assertions,
+                                  const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("CachingSolver::check");
+
+  Key key = make_key(assertions, extra);
+  SolverResult cached = lookup(key, false);
+  if (cached != SolverResult::Unknown) {
+    block.annotate("cached", "true");
+    return cached;
+  }
+
+  SolverResult result = inner->check(assertions, extra);
+  record(std::move(key), result);
+  return result;
+}
+
+SolverResult CachingSolver::resolve(AssertionList& assertions,
+                                    const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("CachingSolver::resolve");
+
+  Key key = make_key(assertions, extra);
+  SolverResult cached = lookup(key, true);
+  if (cached != SolverResult::Unknown) {
+    block.annotate("cached", "true");
+    return cached;
+  }
+
+  SolverResult result = inner->resolve(assertions, extra);
+  record(std::move(key), result);
+  return result;
+}
+
+void CachingSolver::interrupt() {
+  inner->interrupt();
+}
+
+} // namespace caffeine
@@ -0,0 +1,301 @@
+#include "caffeine/Solver/EnumeratingSolver.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Solver/ModelEval.h"
+#include "caffeine/Support/Tracing.h"
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+namespace caffeine {
+
+static std::shared_ptr<AssignmentModel>
+extract_symbols(const Model& model, std::vector<const Operation*> stack,
+                const EGraph& egraph) {
+  auto result = std::make_shared<AssignmentModel>();
+  std::unordered_set<const Operation*> seen;
+
+  while (!stack.empty()) {
+    const Operation* op = stack.back();
+    stack.pop_back();
+
+    if (!seen.insert(op).second)
+      continue;
+
+    if (const auto* constant = llvm::dyn_cast<Constant>(op)) {
+      result->assign(constant->symbol(), model.evaluate(*op, egraph));
+      continue;
+    }
+
+    if (const auto* array = llvm::dyn_cast<ConstantArray>(op)) {
+      if (!ModelEvaluator::supports(*array->size()))
+        return nullptr;
+      result->assign(array->symbol(), model.evaluate(*op, egraph));
+    }
+
+    for (const Operation& operand : op->operands())
+      stack.push_back(&operand);
+  }
+
+  return result;
+}
+
+std::shared_ptr<AssignmentModel>
+AssignmentModel::extract(const Model& model,
+                         llvm::ArrayRef<Assertion> assertions,
+                         const EGraph& egraph) {
+  std::vector<const Operation*> stack;
+  for (const Assertion& assertion : assertions) {
+    if (!assertion.is_empty())
+      stack.push_back(assertion.value().get());
+  }
+
+  return extract_symbols(model, std::move(stack), egraph);
+}
+std::shared_ptr<AssignmentModel>
+AssignmentModel::extract(const Model& model, const AssertionList& assertions,
+                         const Assertion& extra, const EGraph& egraph) {
+  std::vector<const Operation*> stack;
+  for (const Assertion& assertion : assertions) {
+    if (!assertion.is_empty())
+      stack.push_back(assertion.value().get());
+  }
+  if (!extra.is_empty())
+    stack.push_back(extra.value().get());
+
+  return extract_symbols(model, std::move(stack), egraph);
+}
+
+void AssignmentModel::assign(const Symbol& symbol, Value value) {
+  values.insert_or_assign(symbol, std::move(value));
+}
+
+Value AssignmentModel::lookup(const Symbol& symbol,
+                              std::optional<size_t>) const {
+  auto it = values.find(symbol);
+  if (it == values.end())
+    return Value();
+  return it->second;
+}
+
+namespace {
+  struct Variable {
+    Symbol symbol;
+    uint32_t bitwidth;
+    std::vector<uint64_t> domain;
+  };
+
+  struct Constraint {
+    OpRef expr;
+    // Indices of the variables referenced by this constraint.
+    std::vector<size_t> vars;
+  };
+
+  /**
+   * Collect the symbols referenced by expr. Returns false if expr contains
+   * something that can't be enumerated.
+   */
+  bool collect_symbols(const Operation& expr,
+                       std::unordered_set<const Operation*>& seen,
+                       std::unordered_map<Symbol, uint32_t>& out) {
+    if (!seen.insert(&expr).second)
+      return true;
+
+    if (llvm::isa<ConstantArray>(expr))
+      return false;
+
+    if (const auto* constant = llvm::dyn_cast<Constant>(&expr)) {
+      if (!constant->type().is_int())
+        return false;
+
+      out.emplace(constant->symbol(), constant->type().bitwidth());
+      return true;
+    }
+
+    for (const Operation& operand : expr.operands()) {
+      if (!collect_symbols(operand, seen, out))
+        return false;
+    }
+
+    return true;
+  }
+} // namespace
+
+EnumeratingSolver::EnumeratingSolver(const std::shared_ptr<Solver>& inner,
+                                     const EnumeratingSolverOptions& options)
+    : inner(inner), options(options) {}
+
+SolverResult EnumeratingSolver::decide(const AssertionList& assertions,
+                                       const Assertion& extra) {
+  std::vector<OpRef> exprs;
+  for (const Assertion& assertion : assertions) {
+    if (assertion.is_empty() || assertion.is_constant_value(true))
+      continue;
+    exprs.push_back(assertion.value());
+  }
+  if (!extra.is_empty() && !extra.is_constant_value(true))
+    exprs.push_back(extra.value());
+
+  std::vector<Variable> vars;
+  std::unordered_map<Symbol, size_t> var_ids;
+  std::vector<Constraint> constraints;
+  constraints.reserve(exprs.size());
+
+  for (const OpRef& expr : exprs) {
+    if (!ModelEvaluator::supports(*expr))
+      return SolverResult::Unknown;
+
+    std::unordered_set<const Operation*> seen;
+    std::unordered_map<Symbol, uint32_t> symbols;
+    if (!collect_symbols(*expr, seen, symbols))
+      return SolverResult::Unknown;
+
+    Constraint constraint{expr, {}};
+    for (const auto& [symbol, bitwidth] : symbols) {
+      if (bitwidth > options.max_bitwidth)
+        return SolverResult::Unknown;
+
+      auto [it, inserted] = var_ids.emplace(symbol, vars.size());
+      if (inserted) {
+        if (vars.size() >= options.max_symbols)
+          return SolverResult::Unknown;
+        vars.push_back(Variable{symbol, bitwidth, {}});
+      }
+
+      constraint.vars.push_back(it->second);
+    }
+
+    constraints.push_back(std::move(constraint));
+  }
+
+  auto model = std::make_shared<AssignmentModel>();
+  // The evaluator memoizes results so its cache has to be cleared whenever
+  // the assignment changes. Reusing it keeps the allocations for its cache
+  // around between assignments.
+  ModelEvaluator evaluator{model.get(), &egraph_};
+  auto assign = [&](const Variable& var, uint64_t value) {
+    model->assign(var.symbol, Value(llvm::APInt(var.bitwidth, value)));
+    evaluator.clear();
+  };
+  auto holds = [&](const OpRef& expr) {
+    return evaluator.visit(*expr).apint().getBoolValue();
+  };
+
+  // Constraints that don't reference any symbols only need to be evaluated
+  // once.
+  for (const Constraint& constraint : constraints) {
+    if (constraint.vars.empty() && !holds(constraint.expr))
+      return SolverResult::UNSAT;
+  }
+
+  std::vector<OpRef> remaining;
+  for (const Constraint& constraint : constraints) {
+    if (constraint.vars.size() > 1)
+      remaining.push_back(constraint.expr);
+  }
+
+  // Narrow down the domain of each variable using the constraints which only
+  // reference that variable.
+  size_t candidates = 1;
+  for (size_t i = 0; i < vars.size(); ++i) {
+    Variable& var = vars[i];
+
+    std::vector<const OpRef*> unary;
+    for (const Constraint& constraint : constraints) {
+      if (constraint.vars.size() == 1 && constraint.vars[0] == i)
+        unary.push_back(&constraint.expr);
+    }
+
+    uint64_t count = uint64_t(1) << var.bitwidth;
+    for (uint64_t value = 0; value < count; ++value) {
+      if ((value & 0x3FF) == 0 && interrupted.load(std::memory_order_relaxed))
+        return SolverResult::Unknown;
+
+      assign(var, value);
+      bool valid = std::all_of(unary.begin(), unary.end(),
+                               [&](const OpRef* expr) { return holds(*expr); });
+      if (valid)
+        var.domain.push_back(value);
+    }
+
+    if (var.domain.empty())
+      return SolverResult::UNSAT;
+
+    // Saturate instead of overflowing, we only care whether it is within the
+    // limit.
+    candidates = std::min(candidates * var.domain.size(),
+                          options.max_candidates + 1);
+
+    // There's no point in narrowing down the remaining variables if there
+    // are already too many assignments to enumerate.
+    if (!remaining.empty() && candidates > options.max_candidates)
+      return SolverResult::Unknown;
+  }
+
+  // Walk through every combination of the narrowed domains, treating the
+  // indices as the digits of a mixed-radix counter.
+  std::vector<size_t> index(vars.size(), 0);
+  for (size_t iter = 0;; ++iter) {
+    if ((iter & 0x3FF) == 0 && interrupted.load(std::memory_order_relaxed))
+      return SolverResult::Unknown;
+
+    for (size_t i = 0; i < vars.size(); ++i)
+      assign(vars[i], vars[i].domain[index[i]]);
+
+    auto failed = std::find_if_not(remaining.begin(), remaining.end(), holds);
+    if (failed == remaining.end())
+      return SolverResult(SolverResult::SAT, std::move(model));
+
+    // Constraints that rule out one assignment tend to rule out the ones
+    // after it as well so check them first next time.
+    std::rotate(remaining.begin(), failed, failed + 1);
+
+    size_t digit = 0;
+    for (; digit < vars.size(); ++digit) {
+      if (++index[digit] < vars[digit].domain.size())
+        break;
+      index[digit] = 0;
+    }
+
+    if (digit == vars.size())
+      return SolverResult::UNSAT;
+  }
+}
+
+SolverResult EnumeratingSolver::check(AssertionList& assertions,
+                                      const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("EnumeratingSolver::check");
+  interrupted = false;
+
+  SolverResult result = decide(assertions, extra);
+  if (result != SolverResult::Unknown) {
+    block.annotate("decided", "true");
+    return result;
+  }
+  if (interrupted)
+    return result;
+
+  return inner->check(assertions, extra);
+}
+
+SolverResult EnumeratingSolver::resolve(AssertionList& assertions,
+                                        const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("EnumeratingSolver::resolve");
+  interrupted = false;
+
+  SolverResult result = decide(assertions, extra);
+  if (result != SolverResult::Unknown) {
+    block.annotate("decided", "true");
+    return result;
+  }
+  if (interrupted)
+    return result;
+
+  return inner->resolve(assertions, extra);
+}
+
+void EnumeratingSolver::interrupt() {
+  interrupted = true;
+  inner->interrupt();
+}
+
+} // namespace caffeine
@@ -4,6 +4,8 @@
 #include "caffeine/Support/Assert.h"
 #include <fmt/format.h>
 #include <fmt/ostream.h>
+#include <llvm/ADT/SmallVector.h>
+#include <tsl/hopscotch_set.h>
 
 namespace caffeine {
 
@@ -13,6 +15,55 @@ ModelEvaluator::ModelEvaluator(const Model* model, const EGraph* egraph)
   CAFFEINE_ASSERT(egraph);
 }
 
+void ModelEvaluator::clear() {
+  cache.clear();
+  extracted.clear();
+}
+
+Value ModelEvaluator::visit(const Operation& op) {
+  auto it = cache.find(&op);
+  if (it != cache.end())
+    return it->second;
+
+  Value value = ConstOpVisitor<ModelEvaluator, Value>::visit(op);
+  cache.emplace(&op, value);
+  return value;
+}
+
+bool ModelEvaluator::supports(const Operation& expr) {
+  tsl::hopscotch_set<const Operation*> visited;
+  llvm::SmallVector<const Operation*, 16> stack{&expr};
+
+  while (!stack.empty()) {
+    const Operation* op = stack.pop_back_val();
+    if (!visited.insert(op).second)
+      continue;
+
+    if (llvm::isa<FCmpOp>(op))
+      return false;
+
+    switch (op->opcode()) {
+    case Operation::Undef:
+    case Operation::FunctionObject:
+    case Operation::EGraphNode:
+    case Operation::FpTrunc:
+    case Operation::FpExt:
+    case Operation::FpToUI:
+    case Operation::FpToSI:
+    case Operation::UIToFp:
+    case Operation::SIToFp:
+      return false;
+    default:
+      break;
+    }
+
+    for (const Operation& operand : op->operands())
+      stack.push_back(&operand);
+  }
+
+  return true;
+}
+
 Value ModelEvaluator::visitOperation(const Operation& op) {
   CAFFEINE_ABORT(fmt::format("Unknown operation: {}", op.opcode_name()));
 }
@@ -40,8 +91,18 @@ Value ModelEvaluator::visitConstant(const Constant& op) {
 }
 
 Value ModelEvaluator::visitConstantArray(const ConstantArray& op) {
-  size_t size = visit(*op.size()).apint().getLimitedValue(SIZE_MAX);
+  const OpRef& size_op = op.size();
+  size_t size = visit(*size_op).apint().getLimitedValue(SIZE_MAX);
   Value value = model->lookup(op.symbol(), size);
+
+  // Arrays that aren't mentioned in the model can take on any value so we
+  // pick an all-zero one, same as with scalar constants.
+  if (value.type().is_void()) {
+    std::vector<char> bytes(size, 0);
+    return Value(SharedArray(std::move(bytes)),
+                 Type::int_ty(size_op->type().bitwidth()));
+  }
+
   CAFFEINE_ASSERT(
       value.type() != Type::void_ty(),
       fmt::format("Symbol {} was not contained in the model", op.symbol()));
@@ -150,7 +211,8 @@ Value ModelEvaluator::visitSIToFp(const UnaryOp&) {
 }
 
 Value ModelEvaluator::visitEGraphNode(const EGraphNode& op) {
-  return visit(*egraph->extract(op));
+  extracted.push_back(egraph->extract(op));
+  return visit(*extracted.back());
 }
 
 Value ModelEvaluator::visitAlloc(const AllocOp& op) {
@@ -170,6 +232,39 @@ Value ModelEvaluator::visitLoad(const LoadOp& op) {
 Value ModelEvaluator::visitStore(const StoreOp& op) {
   return Value::store(visit(op[0]), visit(op[1]), visit(op[2]));
 }
+Value ModelEvaluator::visitMultiLoad(const MultiLoadOp& op) {
+  Value data = visit(*op.data());
+  Value offset = visit(*op.offset());
+  uint32_t num_bytes = op.num_bytes();
+
+  llvm::APInt result(op.type().bitwidth(), 0);
+  for (uint32_t i = 0; i < num_bytes; ++i) {
+    uint32_t shift = op.is_little_endian() ? i : num_bytes - 1 - i;
+    Value index = Value::bvadd(
+        offset, Value(llvm::APInt(offset.type().bitwidth(), i)));
+
+    result.insertBits(Value::load(data, index).apint(), shift * 8);
+  }
+
+  return Value(std::move(result));
+}
+Value ModelEvaluator::visitMultiStore(const MultiStoreOp& op) {
+  Value data = visit(*op.data());
+  Value offset = visit(*op.offset());
+  Value value = visit(*op.value());
+  uint32_t num_bytes = op.num_bytes();
+
+  for (uint32_t i = 0; i < num_bytes; ++i) {
+    uint32_t shift = op.is_little_endian() ? i : num_bytes - 1 - i;
+    Value index = Value::bvadd(
+        offset, Value(llvm::APInt(offset.type().bitwidth(), i)));
+
+    data = Value::store(data, index,
+                        Value(value.apint().extractBits(8, shift * 8)));
+  }
+
+  return data;
+}
 
 Value ModelEvaluator::visitFunctionObject(const FunctionObject&) {
   CAFFEINE_ABORT("Attempted to evaluate a function object directly?");
@@ -188,9 +283,25 @@ Value ModelEvaluator::visitICmp(const ICmpOp& op) {
     return Value(lhs == rhs);
   case ICmpOpcode::NE:
     return Value(lhs != rhs);
-  default:
-    CAFFEINE_UNIMPLEMENTED();
+  case ICmpOpcode::UGT:
+    return Value(lhs.apint().ugt(rhs.apint()));
+  case ICmpOpcode::UGE:
+    return Value(lhs.apint().uge(rhs.apint()));
+  case ICmpOpcode::ULT:
+    return Value(lhs.apint().ult(rhs.apint()));
+  case ICmpOpcode::ULE:
+    return Value(lhs.apint().ule(rhs.apint()));
+  case ICmpOpcode::SGT:
+    return Value(lhs.apint().sgt(rhs.apint()));
+  case ICmpOpcode::SGE:
+    return Value(lhs.apint().sge(rhs.apint()));
+  case ICmpOpcode::SLT:
+    return Value(lhs.apint().slt(rhs.apint()));
+  case ICmpOpcode::SLE:
+    return Value(lhs.apint().sle(rhs.apint()));
   }
+
+  CAFFEINE_UNREACHABLE("unknown ICmpOpcode");
 }
 
 Value ModelEvaluator::visitFCmp(const FCmpOp&) {
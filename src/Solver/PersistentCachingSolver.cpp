@@ -0,0 +1,535 @@
+#include "caffeine/Solver/PersistentCachingSolver.h"
+#include "caffeine/ADT/Guard.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Protos/solver.capnp.h"
+#include "caffeine/Solver/EnumeratingSolver.h"
+#include "caffeine/Solver/ModelEval.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Tracing.h"
+#include <algorithm>
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <unordered_set>
+
+namespace caffeine {
+
+namespace {
+  // Written at the start of every store. The trailing digits are the format
+  // version.
+  constexpr char file_magic[8] = {'C', 'A', 'F', 'Q', 'R', 'Y', '0', '1'};
+
+  struct RecordHeader {
+    // Size of the message following this header, in bytes.
+    uint32_t size;
+    uint32_t checksum;
+  };
+  static_assert(sizeof(RecordHeader) == sizeof(capnp::word));
+
+  uint32_t checksum(const void* data, size_t size) {
+    // FNV-1a
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  uint64_t mix(uint64_t x) {
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= UINT64_C(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94d049bb133111eb);
+    x ^= x >> 31;
+    return x;
+  }
+
+  /**
+   * Hasher whose output depends only on the values passed to it. This must
+   * not change between versions of caffeine without also bumping the file
+   * format version since that would make all existing caches useless.
+   */
+  class StableHasher {
+  public:
+    void add(uint64_t value) {
+      lo = mix(lo ^ value);
+      hi = mix((hi + value) ^ UINT64_C(0x9E3779B97F4A7C15));
+    }
+    void add(const QueryHash& hash) {
+      add(hash.lo);
+      add(hash.hi);
+    }
+    void add(std::string_view str) {
+      add(str.size());
+      for (size_t i = 0; i < str.size(); i += 8) {
+        uint64_t chunk = 0;
+        size_t len = std::min<size_t>(sizeof(chunk), str.size() - i);
+        std::memcpy(&chunk, str.data() + i, len);
+        add(chunk);
+      }
+    }
+    void add(const llvm::APInt& value) {
+      add(value.getBitWidth());
+      for (unsigned i = 0; i < value.getNumWords(); ++i)
+        add(value.getRawData()[i]);
+    }
+    void add(const Symbol& symbol) {
+      if (symbol.is_named()) {
+        add(UINT64_C(0));
+        add(symbol.name());
+      } else {
+        add(UINT64_C(1));
+        add(symbol.number());
+      }
+    }
+
+    QueryHash finish() const {
+      return QueryHash{lo, hi};
+    }
+
+  private:
+    uint64_t lo = UINT64_C(0x243F6A8885A308D3);
+    uint64_t hi = UINT64_C(0x13198A2E03707344);
+  };
+
+  void encode_symbol(protos::Symbol::Builder builder, const Symbol& symbol) {
+    if (symbol.is_named()) {
+      std::string_view name = symbol.name();
+      builder.setName(capnp::Text::Reader(name.data(), name.size()));
+    } else {
+      builder.setNumber(symbol.number());
+    }
+  }
+
+  Symbol decode_symbol(protos::Symbol::Reader reader) {
+    switch (reader.which()) {
+    case protos::Symbol::NAME:
+      return Symbol(std::string_view(reader.getName().cStr(),
+                                     reader.getName().size()));
+    case protos::Symbol::NUMBER:
+      return Symbol(reader.getNumber());
+    }
+
+    CAFFEINE_UNREACHABLE();
+  }
+
+  void encode_words(capnp::List<uint64_t>::Builder builder,
+                    const llvm::APInt& value) {
+    for (unsigned i = 0; i < value.getNumWords(); ++i)
+      builder.set(i, value.getRawData()[i]);
+  }
+
+  llvm::APInt decode_words(uint32_t bitwidth,
+                           capnp::List<uint64_t>::Reader reader) {
+    std::vector<uint64_t> words(reader.begin(), reader.end());
+    return llvm::APInt(bitwidth, words);
+  }
+
+  void encode_value(protos::ModelValue::Builder builder, const Value& value) {
+    if (value.is_int()) {
+      const llvm::APInt& apint = value.apint();
+      auto group = builder.initInteger();
+      group.setBitwidth(apint.getBitWidth());
+      encode_words(group.initWords(apint.getNumWords()), apint);
+    } else if (value.is_float()) {
+      llvm::APInt bits = value.apfloat().bitcastToAPInt();
+      auto group = builder.initFloating();
+      group.setExponentBits(value.type().exponent_bits());
+      group.setMantissaBits(value.type().mantissa_bits());
+      encode_words(group.initWords(bits.getNumWords()), bits);
+    } else if (value.is_array()) {
+      const SharedArray& array = value.array();
+      auto group = builder.initArray();
+      group.setIndexBits(value.type().bitwidth());
+      auto data = group.initData(array.size());
+      std::copy(array.begin(), array.end(), data.begin());
+    } else {
+      CAFFEINE_UNIMPLEMENTED();
+    }
+  }
+
+  Value decode_value(protos::ModelValue::Reader reader) {
+    switch (reader.which()) {
+    case protos::ModelValue::INTEGER: {
+      auto group = reader.getInteger();
+      return Value(decode_words(group.getBitwidth(), group.getWords()));
+    }
+    case protos::ModelValue::FLOATING: {
+      auto group = reader.getFloating();
+      uint32_t ebits = group.getExponentBits();
+      uint32_t sbits = group.getMantissaBits();
+      return Value::bitcast(
+          Value(decode_words(ebits + sbits, group.getWords())),
+          Type::float_ty(ebits, sbits));
+    }
+    case protos::ModelValue::ARRAY: {
+      auto group = reader.getArray();
+      auto data = group.getData();
+      return Value(SharedArray((const char*)data.begin(), data.size()),
+                   Type::int_ty(group.getIndexBits()));
+    }
+    }
+
+    CAFFEINE_UNREACHABLE();
+  }
+
+  bool write_all(int fd, const char* data, size_t size) {
+    while (size != 0) {
+      ssize_t written = ::write(fd, data, size);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+
+      data += written;
+      size -= (size_t)written;
+    }
+
+    return true;
+  }
+} // namespace
+
+/***************************************************
+ * PersistentQueryStore                            *
+ ***************************************************/
+PersistentQueryStore::PersistentQueryStore(const std::string& path) {
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd_ < 0)
+    return;
+
+  load();
+}
+
+PersistentQueryStore::~PersistentQueryStore() {
+  if (map_)
+    ::munmap(const_cast<char*>(map_), map_size_);
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+void PersistentQueryStore::load() {
+  ::flock(fd_, LOCK_EX);
+  auto unlock = make_guard([&] { ::flock(fd_, LOCK_UN); });
+
+  struct stat st;
+  CAFFEINE_ASSERT(::fstat(fd_, &st) == 0);
+  size_t size = (size_t)st.st_size;
+
+  if (size == 0) {
+    CAFFEINE_ASSERT(write_all(fd_, file_magic, sizeof(file_magic)),
+                    "Failed to initialize query cache");
+    size = sizeof(file_magic);
+  }
+
+  void* map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+  CAFFEINE_ASSERT(map != MAP_FAILED, "Failed to map query cache");
+  map_ = static_cast<const char*>(map);
+  map_size_ = size;
+
+  CAFFEINE_ASSERT(size >= sizeof(file_magic) &&
+                      std::memcmp(map_, file_magic, sizeof(file_magic)) == 0,
+                  "Query cache file has an unrecognized format");
+
+  size_t offset = sizeof(file_magic);
+  while (offset + sizeof(RecordHeader) <= size) {
+    RecordHeader header;
+    std::memcpy(&header, map_ + offset, sizeof(header));
+
+    size_t start = offset + sizeof(header);
+    if (header.size % sizeof(capnp::word) != 0 || header.size > size - start)
+      break;
+    if (checksum(map_ + start, header.size) != header.checksum)
+      break;
+
+    capnp::FlatArrayMessageReader message(kj::ArrayPtr<const capnp::word>(
+        reinterpret_cast<const capnp::word*>(map_ + start),
+        header.size / sizeof(capnp::word)));
+    auto record = message.getRoot<protos::QueryRecord>();
+
+    QueryHash hash{record.getHashLo(), record.getHashHi()};
+    index_.insert_or_assign(hash, std::make_pair(start, (size_t)header.size));
+
+    offset = start + header.size;
+  }
+
+  // Anything past the last valid record was left behind by an interrupted
+  // write. Drop it so that new records end up somewhere we can read them.
+  if (offset < size)
+    CAFFEINE_ASSERT(::ftruncate(fd_, (off_t)offset) == 0);
+}
+
+PersistentQueryStore::Entry PersistentQueryStore::decode(const void* data,
+                                                         size_t size) {
+  capnp::FlatArrayMessageReader message(kj::ArrayPtr<const capnp::word>(
+      static_cast<const capnp::word*>(data), size / sizeof(capnp::word)));
+  auto record = message.getRoot<protos::QueryRecord>();
+
+  if (record.getResult() == protos::QueryRecord::Result::UNSAT)
+    return Entry{SolverResult::UNSAT, nullptr};
+
+  auto model = std::make_shared<AssignmentModel>();
+  for (auto entry : record.getModel())
+    model->assign(decode_symbol(entry.getSymbol()),
+                  decode_value(entry.getValue()));
+
+  return Entry{SolverResult::SAT, std::move(model)};
+}
+
+std::optional<PersistentQueryStore::Entry>
+PersistentQueryStore::lookup(const QueryHash& hash) {
+  std::lock_guard lock(mutex_);
+
+  auto it = entries_.find(hash);
+  if (it != entries_.end())
+    return it->second;
+
+  auto index_it = index_.find(hash);
+  if (index_it == index_.end())
+    return std::nullopt;
+
+  auto [offset, size] = index_it->second;
+  Entry entry = decode(map_ + offset, size);
+  entries_.emplace(hash, entry);
+  return entry;
+}
+
+void PersistentQueryStore::insert(
+    const QueryHash& hash, SolverResult::Kind kind,
+    const std::vector<std::pair<Symbol, Value>>& values) {
+  CAFFEINE_ASSERT(kind != SolverResult::Unknown);
+
+  capnp::MallocMessageBuilder builder;
+  auto record = builder.initRoot<protos::QueryRecord>();
+  record.setHashLo(hash.lo);
+  record.setHashHi(hash.hi);
+
+  std::shared_ptr<AssignmentModel> model;
+  if (kind == SolverResult::SAT) {
+    record.setResult(protos::QueryRecord::Result::SAT);
+    model = std::make_shared<AssignmentModel>();
+
+    auto entries = record.initModel(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      const auto& [symbol, value] = values[i];
+      encode_symbol(entries[i].initSymbol(), symbol);
+      encode_value(entries[i].initValue(), value);
+      model->assign(symbol, value);
+    }
+  } else {
+    record.setResult(protos::QueryRecord::Result::UNSAT);
+  }
+
+  auto words = capnp::messageToFlatArray(builder);
+  auto bytes = words.asBytes();
+
+  RecordHeader header;
+  header.size = (uint32_t)bytes.size();
+  header.checksum = checksum(bytes.begin(), bytes.size());
+
+  std::vector<char> buffer(sizeof(header) + bytes.size());
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  std::memcpy(buffer.data() + sizeof(header), bytes.begin(), bytes.size());
+
+  std::lock_guard lock(mutex_);
+  if (index_.count(hash) || entries_.count(hash))
+    return;
+
+  entries_.emplace(hash, Entry{kind, std::move(model)});
+
+  ::flock(fd_, LOCK_EX);
+  auto unlock = make_guard([&] { ::flock(fd_, LOCK_UN); });
+
+  // A failed write only means that the result won't be available to future
+  // runs so it isn't worth aborting over.
+  (void)write_all(fd_, buffer.data(), buffer.size());
+}
+
+size_t PersistentQueryStore::size() const {
+  std::lock_guard lock(mutex_);
+
+  size_t count = index_.size();
+  for (const auto& [hash, entry] : entries_) {
+    if (!index_.count(hash))
+      count += 1;
+  }
+  return count;
+}
+
+/***************************************************
+ * PersistentCachingSolver                         *
+ ***************************************************/
+PersistentCachingSolver::PersistentCachingSolver(
+    const std::shared_ptr<Solver>& inner,
+    const std::shared_ptr<PersistentQueryStore>& store)
+    : inner(inner), store(store) {}
+
+std::optional<QueryHash> PersistentCachingSolver::hash_expr(const OpRef& expr) {
+  auto it = hash_cache.find(expr.get());
+  if (it != hash_cache.end())
+    return it->second;
+
+  std::optional<QueryHash> result;
+  auto guard = make_guard([&] { hash_cache.emplace(expr, result); });
+
+  StableHasher hasher;
+  hasher.add(expr->opcode());
+
+  Type type = expr->type();
+  hasher.add(type.kind());
+  if (type.is_int() || type.is_array()) {
+    hasher.add(type.bitwidth());
+  } else if (type.is_float()) {
+    hasher.add(type.exponent_bits());
+    hasher.add(type.mantissa_bits());
+  } else if (!type.is_void()) {
+    return std::nullopt;
+  }
+
+  switch (expr->opcode()) {
+  case Operation::FunctionObject:
+  case Operation::EGraphNode:
+  case Operation::Undef:
+    // These either depend on state within the current process or don't have a
+    // meaningful identity so they can't be part of a stable hash.
+    return std::nullopt;
+  default:
+    break;
+  }
+
+  if (const auto* constant = llvm::dyn_cast<Constant>(expr.get()))
+    hasher.add(constant->symbol());
+  if (const auto* array = llvm::dyn_cast<ConstantArray>(expr.get()))
+    hasher.add(array->symbol());
+  if (const auto* iconst = llvm::dyn_cast<ConstantInt>(expr.get()))
+    hasher.add(iconst->value());
+  if (const auto* fconst = llvm::dyn_cast<ConstantFloat>(expr.get()))
+    hasher.add(fconst->value().bitcastToAPInt());
+
+  for (size_t i = 0; i < expr->num_operands(); ++i) {
+    auto hash = hash_expr(expr->operand_at(i));
+    if (!hash)
+      return std::nullopt;
+    hasher.add(*hash);
+  }
+
+  result = hasher.finish();
+  return result;
+}
+
+std::optional<QueryHash>
+PersistentCachingSolver::hash_query(const CachingSolver::Key& key) {
+  std::vector<QueryHash> hashes;
+  hashes.reserve(key.size());
+
+  for (const Assertion& assertion : key) {
+    auto hash = hash_expr(assertion.value());
+    if (!hash)
+      return std::nullopt;
+    hashes.push_back(*hash);
+  }
+
+  // The key is ordered by pointer which isn't stable across runs so the
+  // assertion hashes need to be put in a consistent order.
+  auto order = [](const QueryHash& a, const QueryHash& b) {
+    return std::tie(a.hi, a.lo) < std::tie(b.hi, b.lo);
+  };
+  std::sort(hashes.begin(), hashes.end(), order);
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+  StableHasher hasher;
+  hasher.add(hashes.size());
+  for (const QueryHash& hash : hashes)
+    hasher.add(hash);
+  return hasher.finish();
+}
+
+SolverResult PersistentCachingSolver::solve(AssertionList& assertions,
+                                            const Assertion& extra,
+                                            bool need_model) {
+  auto call_inner = [&] {
+    return need_model ? inner->resolve(assertions, extra)
+                      : inner->check(assertions, extra);
+  };
+
+  auto key = CachingSolver::make_key(assertions, extra);
+  auto hash = hash_query(key);
+  if (!hash || key.empty())
+    return call_inner();
+
+  if (auto entry = store->lookup(*hash)) {
+    if (entry->kind == SolverResult::UNSAT)
+      return SolverResult::UNSAT;
+    return SolverResult(SolverResult::SAT, std::move(entry->model));
+  }
+
+  SolverResult result = call_inner();
+  if (result == SolverResult::UNSAT) {
+    store->insert(*hash, SolverResult::UNSAT, {});
+    return result;
+  }
+
+  const Model* model = result.model();
+  if (result != SolverResult::SAT || !model)
+    return result;
+
+  // Record the value of every symbol within the query.
+  std::vector<std::pair<Symbol, Value>> values;
+  std::unordered_set<const Operation*> seen;
+  std::vector<const Operation*> stack;
+  for (const Assertion& assertion : key)
+    stack.push_back(assertion.value().get());
+
+  while (!stack.empty()) {
+    const Operation* op = stack.back();
+    stack.pop_back();
+
+    if (!seen.insert(op).second)
+      continue;
+
+    if (const auto* constant = llvm::dyn_cast<Constant>(op)) {
+      values.emplace_back(constant->symbol(), model->evaluate(*op, egraph_));
+      continue;
+    }
+
+    if (const auto* array = llvm::dyn_cast<ConstantArray>(op)) {
+      if (!ModelEvaluator::supports(*array->size()))
+        return result;
+      values.emplace_back(array->symbol(), model->evaluate(*op, egraph_));
+    }
+
+    for (const Operation& operand : op->operands())
+      stack.push_back(&operand);
+  }
+
+  store->insert(*hash, SolverResult::SAT, values);
+  return result;
+}
+
+SolverResult PersistentCachingSolver::check(AssertionList& assertions,
+                                            const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("PersistentCachingSolver::check");
+  return solve(assertions, extra, false);
+}
+
+SolverResult PersistentCachingSolver::resolve(AssertionList& assertions,
+                                              const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("PersistentCachingSolver::resolve");
+  return solve(assertions, extra, true);
+}
+
+void PersistentCachingSolver::interrupt() {
+  inner->interrupt();
+}
+
+} // namespace caffeine
@@ -0,0 +1,160 @@
+#include "caffeine/Solver/PortfolioSolver.h"
+#include "caffeine/Solver/EnumeratingSolver.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Tracing.h"
+#include <chrono>
+#include <string>
+
+namespace caffeine {
+
+static std::vector<PortfolioSolver::Factory>
+z3_factories(const std::vector<Z3SolverOptions>& configs) {
+  std::vector<PortfolioSolver::Factory> factories;
+  factories.reserve(configs.size());
+
+  for (const Z3SolverOptions& config : configs) {
+    factories.push_back([=]() -> std::shared_ptr<Solver> {
+      return std::make_shared<Z3Solver>(config);
+    });
+  }
+
+  return factories;
+}
+
+PortfolioSolver::PortfolioSolver(const std::vector<Factory>& factories)
+    : members_(factories.size()) {
+  CAFFEINE_ASSERT(!factories.empty(),
+                  "PortfolioSolver needs at least one member solver");
+
+  for (size_t i = 0; i < factories.size(); ++i)
+    members_[i].solver = factories[i]();
+
+  // Only start the threads once members_ is fully built so that they never
+  // observe it being modified.
+  for (size_t i = 0; i < members_.size(); ++i)
+    members_[i].thread = std::thread([this, i] { run_worker(i); });
+}
+
+PortfolioSolver::PortfolioSolver(const std::vector<Z3SolverOptions>& configs)
+    : PortfolioSolver(z3_factories(configs)) {}
+
+PortfolioSolver::~PortfolioSolver() {
+  {
+    std::lock_guard lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+
+  for (Member& member : members_)
+    member.thread.join();
+}
+
+void PortfolioSolver::run_worker(size_t index) {
+  Member& member = members_[index];
+  std::unique_lock lock(mutex_);
+
+  while (true) {
+    work_cv_.wait(lock, [&] { return shutdown_ || member.job; });
+    if (shutdown_)
+      return;
+
+    Job job = std::move(member.job);
+    member.job = nullptr;
+    member.running = true;
+    std::shared_ptr<Solver> solver = member.solver;
+
+    lock.unlock();
+    std::optional<SolverResult> result;
+    try {
+      result.emplace(job(*solver));
+    } catch (...) {
+      // A failing member shouldn't take down the whole portfolio. Treat it the
+      // same as if it had given up on the query.
+      result.emplace(SolverResult::Unknown);
+    }
+    lock.lock();
+
+    member.running = false;
+    pending_ -= 1;
+    if (!winner_ && *result != SolverResult::Unknown)
+      winner_.emplace(std::move(*result));
+
+    done_cv_.notify_all();
+  }
+}
+
+SolverResult PortfolioSolver::race(AssertionList& assertions,
+                                   const Assertion& extra, bool need_model) {
+  auto block = CAFFEINE_TRACE_SPAN("PortfolioSolver::race");
+
+  // Every member works on its own copy of the assertions since solvers are
+  // allowed to modify the list they are passed.
+  Job job = [&assertions, &extra, need_model](Solver& solver) {
+    AssertionList copy = assertions;
+    return need_model ? solver.resolve(copy, extra)
+                      : solver.check(copy, extra);
+  };
+
+  std::unique_lock lock(mutex_);
+  winner_.reset();
+  pending_ = members_.size();
+
+  for (Member& member : members_)
+    member.job = job;
+  work_cv_.notify_all();
+
+  done_cv_.wait(lock, [&] { return winner_ || pending_ == 0; });
+
+  // Stop all the members that are still working. Interrupting a solver that
+  // hasn't actually started solving yet doesn't do anything so we need to
+  // keep doing it until they all finish.
+  while (pending_ != 0) {
+    for (Member& member : members_) {
+      if (member.job) {
+        member.job = nullptr;
+        pending_ -= 1;
+      } else if (member.running) {
+        member.solver->interrupt();
+      }
+    }
+
+    done_cv_.wait_for(lock, std::chrono::milliseconds(10),
+                      [&] { return pending_ == 0; });
+  }
+
+  if (!winner_)
+    return SolverResult::Unknown;
+
+  SolverResult result = std::move(*winner_);
+  winner_.reset();
+
+  // The model may refer to state owned by the member that produced it (e.g.
+  // a Z3 context) so hand out a copy instead. If that isn't possible then the
+  // original model still stays valid for as long as this solver is alive.
+  if (result == SolverResult::SAT && result.model()) {
+    if (auto model = AssignmentModel::extract(*result.model(), assertions,
+                                              extra, egraph_))
+      return SolverResult(SolverResult::SAT, std::move(model));
+  }
+
+  return result;
+}
+
+SolverResult PortfolioSolver::check(AssertionList& assertions,
+                                    const Assertion& extra) {
+  return race(assertions, extra, false);
+}
+
+SolverResult PortfolioSolver::resolve(AssertionList& assertions,
+                                      const Assertion& extra) {
+  return race(assertions, extra, true);
+}
+
+void PortfolioSolver::interrupt() {
+  std::lock_guard lock(mutex_);
+
+  for (Member& member : members_)
+    member.solver->interrupt();
+}
+
+} // namespace caffeine
@@ -0,0 +1,349 @@
+#include "caffeine/Solver/ProfilingSolver.h"
+#include "caffeine/IR/EGraphCost.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Support/LLVMFmt.h"
+#include <algorithm>
+#include <charconv>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <magic_enum.hpp>
+#include <ostream>
+#include <sstream>
+#include <unordered_set>
+
+namespace caffeine {
+
+/***************************************************
+ * QuerySite                                       *
+ ***************************************************/
+static thread_local const llvm::Instruction* current_site = nullptr;
+
+const llvm::Instruction* QuerySite::current() {
+  return current_site;
+}
+
+QuerySite::Scope::Scope(const llvm::Instruction* inst) : prev(current_site) {
+  current_site = inst;
+}
+QuerySite::Scope::~Scope() {
+  current_site = prev;
+}
+
+/***************************************************
+ * QueryProfile                                    *
+ ***************************************************/
+static bool more_expensive(const QueryProfile::Record& a,
+                           const QueryProfile::Record& b) {
+  return a.duration > b.duration;
+}
+
+static std::string describe_site(const llvm::Instruction* inst) {
+  if (!inst)
+    return "<unknown>";
+
+  std::string location;
+  if (const auto& loc = inst->getDebugLoc()) {
+    location = fmt::format(FMT_STRING("{}:{}:{}"), loc->getFilename().str(),
+                           loc.getLine(), loc.getCol());
+  } else {
+    location = "<no debug info>";
+  }
+
+  return fmt::format(FMT_STRING("{} in {}: {}"), location,
+                     inst->getFunction()->getName().str(), *inst);
+}
+
+static std::string format_duration(std::chrono::nanoseconds duration) {
+  using namespace std::chrono;
+
+  if (duration < microseconds(1))
+    return fmt::format(FMT_STRING("{}ns"), duration.count());
+  if (duration < milliseconds(1))
+    return fmt::format(FMT_STRING("{:.1f}us"), duration.count() / 1e3);
+  if (duration < seconds(1))
+    return fmt::format(FMT_STRING("{:.1f}ms"), duration.count() / 1e6);
+  return fmt::format(FMT_STRING("{:.2f}s"), duration.count() / 1e9);
+}
+
+QueryProfile::QueryProfile(size_t top_n) : top_n(top_n) {}
+
+size_t QueryProfile::bucket_for(std::chrono::nanoseconds duration) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+
+  size_t bucket = 0;
+  for (uint64_t value = us.count(); value > 0; value >>= 1)
+    bucket += 1;
+  return std::min(bucket, num_buckets - 1);
+}
+
+void QueryProfile::record(const Record& record) {
+  std::lock_guard lock(mutex);
+
+  SiteStats& stats = sites[record.inst];
+  stats.count += 1;
+  stats.total += record.duration;
+  stats.max = std::max(stats.max, record.duration);
+  stats.results[record.result] += 1;
+  stats.histogram[bucket_for(record.duration)] += 1;
+
+  if (top_n == 0)
+    return;
+
+  if (top.size() < top_n) {
+    top.push_back(record);
+    std::push_heap(top.begin(), top.end(), more_expensive);
+  } else if (record.duration > top.front().duration) {
+    std::pop_heap(top.begin(), top.end(), more_expensive);
+    top.back() = record;
+    std::push_heap(top.begin(), top.end(), more_expensive);
+  }
+}
+
+void QueryProfile::report(std::ostream& os) const {
+  std::lock_guard lock(mutex);
+
+  std::vector<std::pair<const llvm::Instruction*, const SiteStats*>> ordered;
+  ordered.reserve(sites.size());
+  for (const auto& [inst, stats] : sites)
+    ordered.emplace_back(inst, &stats);
+
+  std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) {
+    return a.second->total > b.second->total;
+  });
+
+  fmt::print(os, "Solver query profile\n");
+  fmt::print(os, "====================\n");
+  fmt::print(os, "Per-instruction latency (by total time):\n");
+
+  for (const auto& [inst, stats] : ordered) {
+    fmt::print(os, FMT_STRING("  {}\n"), describe_site(inst));
+    fmt::print(
+        os,
+        FMT_STRING("    queries: {}  total: {}  mean: {}  max: {}  "
+                   "sat/unsat/unknown: {}/{}/{}\n"),
+        stats->count, format_duration(stats->total),
+        format_duration(stats->total / stats->count),
+        format_duration(stats->max), stats->results[SolverResult::SAT],
+        stats->results[SolverResult::UNSAT],
+        stats->results[SolverResult::Unknown]);
+
+    fmt::print(os, "    histogram:");
+    for (size_t i = 0; i < num_buckets; ++i) {
+      if (stats->histogram[i] == 0)
+        continue;
+
+      // Bucket i holds latencies in [2^(i-1), 2^i) microseconds.
+      uint64_t upper = uint64_t(1) << i;
+      fmt::print(os, FMT_STRING(" <{}:{}"),
+                 format_duration(std::chrono::microseconds(upper)),
+                 stats->histogram[i]);
+    }
+    fmt::print(os, "\n");
+  }
+
+  std::vector<Record> sorted = top;
+  std::sort(sorted.begin(), sorted.end(), more_expensive);
+
+  fmt::print(os, FMT_STRING("\nTop {} most expensive queries:\n"),
+             sorted.size());
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    const Record& record = sorted[i];
+    fmt::print(os,
+               FMT_STRING("  {:>3}. {:>9} {:<7} assertions: {} (sliced: {}) "
+                          "nodes: {}\n"),
+               i + 1, format_duration(record.duration),
+               magic_enum::enum_name(record.result), record.assertions,
+               record.sliced, record.nodes);
+    fmt::print(os, FMT_STRING("       at {}\n"), describe_site(record.inst));
+  }
+
+  os << std::flush;
+}
+
+/***************************************************
+ * QueryLog                                        *
+ ***************************************************/
+QueryLog::QueryLog(std::ostream& os) : os(&os) {}
+
+void QueryLog::record(const Entry& entry) {
+  std::string line = fmt::format(FMT_STRING("{}"), entry.duration.count());
+  for (const auto& [opcode, usage] : entry.usage)
+    fmt::format_to(std::back_inserter(line), FMT_STRING(" {}:{}:{}"),
+                   WeightedCostModel::opcode_name(opcode), usage.count,
+                   usage.bits);
+  line.push_back('\n');
+
+  std::lock_guard lock(mutex);
+  *os << line << std::flush;
+}
+
+template <typename T>
+static bool parse_number(std::string_view str, T& value) {
+  const char* end = str.data() + str.size();
+  auto [ptr, ec] = std::from_chars(str.data(), end, value);
+  return ec == std::errc() && ptr == end;
+}
+
+std::optional<QueryLog::Entry> QueryLog::parse(std::string_view line) {
+  std::istringstream ss{std::string(line)};
+  Entry entry;
+
+  std::string token;
+  int64_t duration;
+  if (!(ss >> token) || !parse_number(token, duration) || duration < 0)
+    return std::nullopt;
+  entry.duration = std::chrono::nanoseconds(duration);
+
+  while (ss >> token) {
+    std::string_view str = token;
+    size_t first = str.find(':');
+    if (first == str.npos)
+      return std::nullopt;
+    size_t second = str.find(':', first + 1);
+    if (second == str.npos)
+      return std::nullopt;
+
+    auto opcode = WeightedCostModel::parse_opcode(str.substr(0, first));
+    if (!opcode)
+      return std::nullopt;
+
+    Usage& usage = entry.usage[*opcode];
+    std::string_view count = str.substr(first + 1, second - first - 1);
+    if (!parse_number(count, usage.count) ||
+        !parse_number(str.substr(second + 1), usage.bits))
+      return std::nullopt;
+  }
+
+  return entry;
+}
+
+/***************************************************
+ * ProfilingSolver                                 *
+ ***************************************************/
+// Count the distinct expression nodes within the query. If usage is not null
+// then this also tallies them up by opcode.
+static size_t
+count_nodes(const AssertionList& assertions, const Assertion& extra,
+            std::map<Operation::Opcode, QueryLog::Usage>* usage) {
+  std::unordered_set<const Operation*> seen;
+  std::vector<const Operation*> stack;
+
+  for (const Assertion& assertion : assertions)
+    stack.push_back(assertion.value().get());
+  if (!extra.is_empty())
+    stack.push_back(extra.value().get());
+
+  while (!stack.empty()) {
+    const Operation* op = stack.back();
+    stack.pop_back();
+
+    if (!seen.insert(op).second)
+      continue;
+
+    for (const Operation& operand : op->operands())
+      stack.push_back(&operand);
+
+    if (!usage)
+      continue;
+
+    // This uses the same bitwidth as EGraphExtractor so that fitted weights
+    // can be used directly by WeightedCostModel.
+    uint32_t bitwidth = ExtractionCostModel::type_bitwidth(op->type());
+    for (const Operation& operand : op->operands())
+      bitwidth = std::max(bitwidth,
+                          ExtractionCostModel::type_bitwidth(operand.type()));
+
+    QueryLog::Usage& entry =
+        (*usage)[static_cast<Operation::Opcode>(op->opcode())];
+    entry.count += 1;
+    entry.bits += bitwidth;
+  }
+
+  return seen.size();
+}
+
+ProfilingSolver::ProfilingSolver(const std::shared_ptr<Solver>& inner,
+                                 const std::shared_ptr<QueryProfile>& profile)
+    : inner(inner), profile(profile) {}
+
+template <typename F>
+SolverResult ProfilingSolver::measure(AssertionList& assertions,
+                                      const Assertion& extra, F&& func) {
+  QueryProfile::Record record;
+  record.inst = QuerySite::current();
+
+  // These are computed before the query since the inner solvers are allowed
+  // to modify the assertion list.
+  bool has_extra = !extra.is_empty() && !extra.is_constant_value(true);
+  record.assertions = assertions.size() + (has_extra ? 1 : 0);
+  record.sliced = slicer.slice(assertions, extra).size() + (has_extra ? 1 : 0);
+  record.nodes = count_nodes(assertions, extra, nullptr);
+
+  auto start = std::chrono::steady_clock::now();
+  SolverResult result = func();
+  record.duration = std::chrono::steady_clock::now() - start;
+  record.result = result.kind();
+
+  profile->record(record);
+  return result;
+}
+
+SolverResult ProfilingSolver::check(AssertionList& assertions,
+                                    const Assertion& extra) {
+  return measure(assertions, extra,
+                 [&] { return inner->check(assertions, extra); });
+}
+
+SolverResult ProfilingSolver::resolve(AssertionList& assertions,
+                                      const Assertion& extra) {
+  return measure(assertions, extra,
+                 [&] { return inner->resolve(assertions, extra); });
+}
+
+void ProfilingSolver::interrupt() {
+  inner->interrupt();
+}
+
+/***************************************************
+ * QueryLoggingSolver                              *
+ ***************************************************/
+QueryLoggingSolver::QueryLoggingSolver(const std::shared_ptr<Solver>& inner,
+                                       const std::shared_ptr<QueryLog>& log)
+    : inner(inner), log(log) {}
+
+template <typename F>
+SolverResult QueryLoggingSolver::measure(AssertionList& assertions,
+                                         const Assertion& extra, F&& func) {
+  // The base solver is allowed to modify the assertion list so this needs to
+  // happen before the query.
+  QueryLog::Entry entry;
+  count_nodes(assertions, extra, &entry.usage);
+
+  auto start = std::chrono::steady_clock::now();
+  SolverResult result = func();
+  entry.duration = std::chrono::steady_clock::now() - start;
+
+  log->record(entry);
+  return result;
+}
+
+SolverResult QueryLoggingSolver::check(AssertionList& assertions,
+                                       const Assertion& extra) {
+  return measure(assertions, extra,
+                 [&] { return inner->check(assertions, extra); });
+}
+
+SolverResult QueryLoggingSolver::resolve(AssertionList& assertions,
+                                         const Assertion& extra) {
+  return measure(assertions, extra,
+                 [&] { return inner->resolve(assertions, extra); });
+}
+
+void QueryLoggingSolver::interrupt() {
+  inner->interrupt();
+}
+
+} // namespace caffeine
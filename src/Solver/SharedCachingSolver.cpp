@@ -0,0 +1,160 @@
+#include "caffeine/Solver/SharedCachingSolver.h"
+#include "caffeine/Solver/EnumeratingSolver.h"
+#include "caffeine/Support/Assert.h"
+#include "caffeine/Support/Tracing.h"
+#include <algorithm>
+
+namespace caffeine {
+
+SharedQueryCache::SharedQueryCache(const SharedQueryCacheOptions& options) {
+  CAFFEINE_ASSERT(options.shards != 0);
+
+  shards_.reserve(options.shards);
+  for (size_t i = 0; i < options.shards; ++i)
+    shards_.push_back(std::make_unique<Shard>());
+
+  shard_capacity_ = std::max<size_t>(options.max_entries / options.shards, 1);
+}
+
+SharedQueryCache::Shard& SharedQueryCache::shard_for(size_t hash) {
+  // The hash is also used to pick a bucket within the shard's map so mix it
+  // before picking the shard to avoid correlating the two.
+  uint64_t mixed = static_cast<uint64_t>(hash) * UINT64_C(0x9E3779B97F4A7C15);
+  return *shards_[(mixed >> 32) % shards_.size()];
+}
+
+std::optional<SharedQueryCache::Entry>
+SharedQueryCache::lookup(const Key& key) {
+  Shard& shard = shard_for(CachingSolver::KeyHash()(key));
+  std::lock_guard lock(shard.mutex);
+
+  auto it = shard.index.find(key);
+  if (it == shard.index.end())
+    return std::nullopt;
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  return it->second->second;
+}
+
+void SharedQueryCache::insert(Key&& key, Entry&& entry) {
+  Shard& shard = shard_for(CachingSolver::KeyHash()(key));
+  std::lock_guard lock(shard.mutex);
+
+  auto it = shard.index.find(key);
+  if (it != shard.index.end()) {
+    // Don't replace an entry that has a model with one that doesn't.
+    if (entry.model || !it->second->second.model)
+      it->second->second = std::move(entry);
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return;
+  }
+
+  if (shard.lru.size() >= shard_capacity_) {
+    shard.index.erase(shard.lru.back().first);
+    shard.lru.pop_back();
+  }
+
+  shard.lru.emplace_front(std::move(key), std::move(entry));
+  shard.index.emplace(shard.lru.front().first, shard.lru.begin());
+}
+
+size_t SharedQueryCache::size() const {
+  size_t total = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard lock(shard->mutex);
+    total += shard->lru.size();
+  }
+  return total;
+}
+
+SharedCachingSolver::SharedCachingSolver(
+    const std::shared_ptr<Solver>& inner,
+    const std::shared_ptr<SharedQueryCache>& cache)
+    : inner(inner), cache(cache) {}
+
+std::shared_ptr<const Model>
+SharedCachingSolver::compact(const SharedQueryCache::Key& key,
+                             const Model& model) {
+  return AssignmentModel::extract(model, key, egraph_);
+}
+
+SolverResult SharedCachingSolver::lookup(const SharedQueryCache::Key& key,
+                                         bool need_model) {
+  auto entry = cache->lookup(key);
+  if (!entry)
+    return SolverResult::Unknown;
+
+  switch (entry->kind) {
+  case SolverResult::UNSAT:
+    return SolverResult::UNSAT;
+  case SolverResult::SAT:
+    if (need_model && !entry->model)
+      return SolverResult::Unknown;
+    return SolverResult(SolverResult::SAT, std::move(entry->model));
+  case SolverResult::Unknown:
+    break;
+  }
+
+  return SolverResult::Unknown;
+}
+
+void SharedCachingSolver::record(SharedQueryCache::Key&& key,
+                                 const SolverResult& result) {
+  switch (result.kind()) {
+  case SolverResult::UNSAT:
+    // See CachingSolver::record for why empty keys are skipped.
+    if (key.empty())
+      break;
+    cache->insert(std::move(key), {SolverResult::UNSAT, nullptr});
+    break;
+
+  case SolverResult::SAT: {
+    std::shared_ptr<const Model> model;
+    if (const Model* inner_model = result.model())
+      model = compact(key, *inner_model);
+    cache->insert(std::move(key), {SolverResult::SAT, std::move(model)});
+    break;
+  }
+
+  case SolverResult::Unknown:
+    break;
+  }
+}
+
+SolverResult SharedCachingSolver::check(AssertionList& assertions,
+                                        const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("SharedCachingSolver::check");
+
+  auto key = CachingSolver::make_key(assertions, extra);
+  SolverResult cached = lookup(key, false);
+  if (cached != SolverResult::Unknown) {
+    block.annotate("cached", "true");
+    return cached;
+  }
+
+  SolverResult result = inner->check(assertions, extra);
+  record(std::move(key), result);
+  return result;
+}
+
+SolverResult SharedCachingSolver::resolve(AssertionList& assertions,
+                                          const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("SharedCachingSolver::resolve");
+
+  auto key = CachingSolver::make_key(assertions, extra);
+  SolverResult cached = lookup(key, true);
+  if (cached != SolverResult::Unknown) {
+    block.annotate("cached", "true");
+    return cached;
+  }
+
+  SolverResult result = inner->resolve(assertions, extra);
+  record(std::move(key), result);
+  return result;
+}
+
+void SharedCachingSolver::interrupt() {
+  inner->interrupt();
+}
+
+} // namespace caffeine
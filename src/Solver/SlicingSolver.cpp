@@ -1,10 +1,27 @@
 #include "caffeine/Solver/SlicingSolver.h"
+#include "caffeine/Support/Tracing.h"
+#include <string>
 #include <unordered_map>
 
 namespace caffeine {
 
-SlicingSolver::SlicingSolver(const std::shared_ptr<Solver>& inner)
-    : inner(inner) {}
+StitchedModel::StitchedModel(
+    std::vector<std::shared_ptr<const Model>>&& models,
+    std::unordered_map<Symbol, size_t>&& owners)
+    : models(std::move(models)), owners(std::move(owners)) {}
+
+Value StitchedModel::lookup(const Symbol& symbol,
+                            std::optional<size_t> size) const {
+  auto it = owners.find(symbol);
+  if (it == owners.end())
+    return Value();
+
+  return models[it->second]->lookup(symbol, size);
+}
+
+SlicingSolver::SlicingSolver(const std::shared_ptr<Solver>& inner,
+                             bool stitch_models)
+    : inner(inner), stitch_models(stitch_models) {}
 
 SolverResult SlicingSolver::check(AssertionList& assertions,
                                   const Assertion& extra) {
@@ -14,7 +31,43 @@ SolverResult SlicingSolver::check(AssertionList& assertions,
 
 SolverResult SlicingSolver::resolve(AssertionList& assertions,
                                     const Assertion& extra) {
-  return inner->resolve(assertions, extra);
+  if (!stitch_models)
+    return inner->resolve(assertions, extra);
+
+  auto components = slicer.partition(assertions, extra);
+  if (components.size() <= 1)
+    return inner->resolve(assertions, extra);
+
+  auto block = CAFFEINE_TRACE_SPAN("SlicingSolver::resolve");
+  block.annotate("components", std::to_string(components.size()));
+
+  std::vector<std::shared_ptr<const Model>> models;
+  std::unordered_map<Symbol, size_t> owners;
+  models.reserve(components.size());
+
+  bool unknown = false;
+  for (auto& component : components) {
+    auto result = inner->resolve(component.assertions, component.extra);
+
+    if (result == SolverResult::UNSAT)
+      return SolverResult::UNSAT;
+    if (result == SolverResult::Unknown) {
+      // Keep going since a later component may still be UNSAT.
+      unknown = true;
+      continue;
+    }
+
+    for (const Symbol& symbol : component.symbols)
+      owners.emplace(symbol, models.size());
+    models.push_back(result.shared_model());
+  }
+
+  if (unknown)
+    return SolverResult::Unknown;
+
+  return SolverResult(
+      SolverResult::SAT,
+      std::make_shared<StitchedModel>(std::move(models), std::move(owners)));
 }
 
 void SlicingSolver::interrupt() {
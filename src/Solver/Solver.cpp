@@ -3,9 +3,12 @@
 #include "caffeine/IR/Value.h"
 #include "caffeine/IR/Visitor.h"
 #include "caffeine/Interpreter/Context.h"
+#include "caffeine/Solver/CachingSolver.h"
 #include "caffeine/Solver/CanonicalizingSolver.h"
 #include "caffeine/Solver/EarlyExitSolver.h"
+#include "caffeine/Solver/EnumeratingSolver.h"
 #include "caffeine/Solver/ModelEval.h"
+#include "caffeine/Solver/SharedCachingSolver.h"
 #include "caffeine/Solver/SimplifyingSolver.h"
 #include "caffeine/Solver/SlicingSolver.h"
 #include "caffeine/Solver/Z3Solver.h"
@@ -16,7 +19,7 @@
 
 namespace caffeine {
 
-SolverResult::SolverResult(Kind kind, std::unique_ptr<Model> model)
+SolverResult::SolverResult(Kind kind, std::shared_ptr<const Model> model)
     : kind_(kind), model_(std::move(model)) {
   CAFFEINE_ASSERT(
       kind == SAT || model_ == nullptr,
@@ -36,6 +39,9 @@ SolverResult::Kind SolverResult::kind() const {
 const Model* SolverResult::model() const {
   return model_.get();
 }
+const std::shared_ptr<const Model>& SolverResult::shared_model() const {
+  return model_;
+}
 
 Value SolverResult::evaluate(const Operation& expr,
                              const EGraph& egraph) const {
@@ -96,7 +102,7 @@ SolverResult Solver::check(AssertionList& assertions) {
 }
 
 SolverResult Solver::check(AssertionList& assertions, const Assertion& extra) {
-  return SolverResult(resolve(assertions, extra).kind());
+  return resolve(assertions, extra);
 }
 
 SolverResult Solver::resolve(AssertionList& assertions) {
@@ -141,11 +147,26 @@ void TransformSolver::interrupt() {
 SolverBuilder::SolverBuilder(const BaseFn& base) : base(base) {}
 
 SolverBuilder SolverBuilder::with_default() {
-  auto builder = SolverBuilder(std::make_shared<Z3Solver>);
+  return with_default([] {
+    Z3SolverOptions options;
+    options.incremental = true;
+    return std::make_shared<Z3Solver>(options);
+  });
+}
+
+SolverBuilder SolverBuilder::with_default(const BaseFn& base) {
+  // Shared between every solver built from this builder so that workers can
+  // reuse each other's results.
+  auto cache = std::make_shared<SharedQueryCache>();
+
+  auto builder = SolverBuilder(base);
   builder.with<EarlyExitSolver>();
   builder.with<SimplifyingSolver>();
   builder.with<CanonicalizingSolver>();
   builder.with<SlicingSolver>();
+  builder.with<CachingSolver>();
+  builder.with<SharedCachingSolver>(cache);
+  builder.with<EnumeratingSolver>();
   return builder;
 }
 
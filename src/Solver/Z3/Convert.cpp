@@ -191,8 +191,11 @@ z3::expr Z3OpVisitor::visitFixedArray(const FixedArray& op) {
 
   for (size_t i = 0; i < data.size(); ++i) {
     z3::expr value = visit(*data[i]);
-    solver->add(z3::select(array, ctx->bv_val((uint64_t)i,
-                                              op.type().bitwidth())) == value);
+    z3::expr constraint =
+        z3::select(array, ctx->bv_val((uint64_t)i, op.type().bitwidth())) ==
+        value;
+    solver->add(constraint);
+    side_constraints.push_back(constraint);
   }
 
   return array;
@@ -478,6 +481,39 @@ z3::expr Z3OpVisitor::visitLoad(const LoadOp& op) {
 z3::expr Z3OpVisitor::visitStore(const StoreOp& op) {
   return z3::store(visit(op[0]), visit(op[1]), visit(op[2]));
 }
+z3::expr Z3OpVisitor::visitMultiLoad(const MultiLoadOp& op) {
+  auto data = visit(*op.data());
+  auto offset = visit(*op.offset());
+  auto index_width = op.offset()->type().bitwidth();
+  uint32_t num_bytes = op.num_bytes();
+
+  // Bytes are concatenated starting with the most significant one.
+  auto byte = [&](uint32_t i) {
+    uint32_t index = op.is_little_endian() ? num_bytes - 1 - i : i;
+    return z3::select(data, offset + ctx->bv_val((uint64_t)index, index_width));
+  };
+
+  z3::expr result = byte(0);
+  for (uint32_t i = 1; i < num_bytes; ++i)
+    result = z3::concat(result, byte(i));
+
+  return result;
+}
+z3::expr Z3OpVisitor::visitMultiStore(const MultiStoreOp& op) {
+  auto data = visit(*op.data());
+  auto offset = visit(*op.offset());
+  auto value = visit(*op.value());
+  auto index_width = op.offset()->type().bitwidth();
+  uint32_t num_bytes = op.num_bytes();
+
+  for (uint32_t i = 0; i < num_bytes; ++i) {
+    uint32_t shift = op.is_little_endian() ? i : num_bytes - 1 - i;
+    data = z3::store(data, offset + ctx->bv_val((uint64_t)i, index_width),
+                     value.extract(shift * 8 + 7, shift * 8));
+  }
+
+  return data;
+}
 z3::expr Z3OpVisitor::visitAlloc(const AllocOp& op) {
   auto value = visit(*op.default_value());
   auto index_width = op.size()->type().bitwidth();
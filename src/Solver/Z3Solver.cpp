@@ -8,10 +8,12 @@
 #include "Z3Solver.h"
 #include "z3_fpa.h"
 
+#include <algorithm>
 #include <climits>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 #include <sstream>
+#include <unordered_set>
 
 #include <llvm/ADT/SmallString.h>
 
@@ -106,6 +108,140 @@ static Z3Model::SymbolName op_name(const Symbol& symbol) {
   return std::string(symbol.name());
 }
 
+/**
+ * Copy the entries of constMap for the symbols referenced by the query.
+ *
+ * The map of an incremental solver accumulates every symbol it has seen since
+ * it was created so copying the whole thing into each model would make every
+ * SAT result slower the longer the solver lives.
+ */
+static Z3Model::ConstMap query_constants(const Z3Model::ConstMap& constMap,
+                                         llvm::ArrayRef<Assertion> query,
+                                         const Assertion& extra) {
+  Z3Model::ConstMap constants;
+  std::unordered_set<const Operation*> seen;
+  std::vector<const Operation*> stack;
+
+  for (const Assertion& assertion : query)
+    stack.push_back(assertion.value().get());
+  if (!extra.is_constant_value(true))
+    stack.push_back(extra.value().get());
+
+  while (!stack.empty()) {
+    const Operation* op = stack.back();
+    stack.pop_back();
+
+    if (!seen.insert(op).second)
+      continue;
+
+    const Symbol* symbol = nullptr;
+    if (const auto* constant = llvm::dyn_cast<Constant>(op))
+      symbol = &constant->symbol();
+    else if (const auto* array = llvm::dyn_cast<ConstantArray>(op))
+      symbol = &array->symbol();
+
+    if (symbol) {
+      auto name = op_name(*symbol);
+      auto it = constMap.find(name);
+      if (it != constMap.end())
+        constants.insert({std::move(name), it->second});
+    }
+
+    for (const Operation& operand : op->operands())
+      stack.push_back(&operand);
+  }
+
+  return constants;
+}
+
+/**
+ * Read the contents of an array directly from its interpretation within a
+ * model. Z3 represents array values as either a chain of stores on top of a
+ * constant array or as a reference to a function interpretation, both of which
+ * consist of a default value plus a list of explicit entries.
+ *
+ * This avoids having to evaluate a select for every single element of the
+ * array which is very slow for large arrays.
+ *
+ * Returns false if the interpretation is in some other form.
+ */
+static bool read_array_interp(const z3::model& model, z3::expr array,
+                              size_t size, std::vector<char>& data) {
+  auto read_byte = [](const z3::expr& value, uint8_t& out) {
+    uint64_t byte;
+    if (!value.is_numeral() || !value.is_numeral_u64(byte))
+      return false;
+    out = (uint8_t)byte;
+    return true;
+  };
+  auto read_index = [](const z3::expr& index, uint64_t& out) {
+    return index.is_numeral() && index.is_numeral_u64(out);
+  };
+
+  // Stores closer to the top of the chain take precedence over those below
+  // them, so we collect them top-down and apply them in reverse.
+  std::vector<std::pair<uint64_t, uint8_t>> entries;
+  uint8_t fill = 0;
+
+  while (true) {
+    if (!array.is_app())
+      return false;
+
+    Z3_decl_kind kind = array.decl().decl_kind();
+    if (kind == Z3_OP_STORE) {
+      uint64_t index;
+      uint8_t value;
+      if (!read_index(array.arg(1), index) || !read_byte(array.arg(2), value))
+        return false;
+
+      entries.emplace_back(index, value);
+      array = array.arg(0);
+      continue;
+    }
+
+    if (kind == Z3_OP_CONST_ARRAY) {
+      if (!read_byte(array.arg(0), fill))
+        return false;
+      break;
+    }
+
+    if (kind == Z3_OP_AS_ARRAY) {
+      z3::func_decl func(array.ctx(),
+                         Z3_get_as_array_func_decl(array.ctx(), array));
+      if (!model.has_interp(func))
+        return false;
+
+      z3::func_interp interp = model.get_func_interp(func);
+      if (!read_byte(interp.else_value(), fill))
+        return false;
+
+      // Function interpretations don't contain duplicate entries so order
+      // doesn't matter here.
+      for (unsigned i = 0; i < interp.num_entries(); ++i) {
+        z3::func_entry entry = interp.entry(i);
+        uint64_t index;
+        uint8_t value;
+        if (entry.num_args() != 1 || !read_index(entry.arg(0), index) ||
+            !read_byte(entry.value(), value))
+          return false;
+
+        entries.emplace_back(index, value);
+      }
+      break;
+    }
+
+    return false;
+  }
+
+  data.assign(size, (char)fill);
+  for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+    if (it->first < size)
+      data[it->first] = (char)it->second;
+  }
+
+  return true;
+}
+
 /***************************************************
  * Z3Model                                         *
  ***************************************************/
@@ -134,14 +270,19 @@ Value Z3Model::lookup(const Symbol& symbol, std::optional<size_t> size) const {
     CAFFEINE_ASSERT(range.is_bv() && range.bv_size() == 8);
 
     std::vector<char> data;
-    data.reserve(*size);
-
-    for (size_t i = 0; i < *size; ++i) {
-      auto value = model.eval(
-          z3::select(it->second,
-                     model.ctx().bv_val((uint64_t)i, domain.bv_size())),
-          true);
-      data.push_back((char)(uint8_t)value.get_numeral_uint64());
+    if (!read_array_interp(model, model.eval(it->second, true), *size, data)) {
+      // Z3 gave us an interpretation that we don't know how to read directly
+      // so fall back to evaluating every element individually.
+      data.clear();
+      data.reserve(*size);
+
+      for (size_t i = 0; i < *size; ++i) {
+        auto value = model.eval(
+            z3::select(it->second,
+                       model.ctx().bv_val((uint64_t)i, domain.bv_size())),
+            true);
+        data.push_back((char)(uint8_t)value.get_numeral_uint64());
+      }
     }
 
     return Value(SharedArray(std::move(data)), Type::int_ty(domain.bv_size()));
@@ -154,6 +295,8 @@ Value Z3Model::lookup(const Symbol& symbol, std::optional<size_t> size) const {
  * Z3Solver                                        *
  ***************************************************/
 Z3Solver::Z3Solver() : impl(std::make_unique<Impl>()) {}
+Z3Solver::Z3Solver(const Z3SolverOptions& options)
+    : impl(std::make_unique<Impl>(options)) {}
 
 Z3Solver::Z3Solver(Z3Solver&& solver) noexcept : impl(std::move(solver.impl)) {}
 Z3Solver& Z3Solver::operator=(Z3Solver&& solver) noexcept {
@@ -170,13 +313,18 @@ SolverResult Z3Solver::check(AssertionList& assertions,
   if (extra.is_constant_value(false))
     return SolverResult::UNSAT;
 
+  // The incremental solver passes extra as an assumption so there's no need
+  // to insert it into the assertion list.
+  if (impl->options.incremental)
+    return resolve(assertions, extra);
+
   size_t checkpoint = assertions.checkpoint();
   auto guard = make_guard([&]() { assertions.restore(checkpoint); });
   assertions.insert(extra);
 
   if (assertions.unproven().empty())
     return SolverResult::SAT;
-  return SolverResult(resolve(assertions, Assertion()).kind());
+  return resolve(assertions, Assertion());
 }
 
 SolverResult Z3Solver::resolve(AssertionList& assertions,
@@ -189,6 +337,9 @@ SolverResult Z3Solver::resolve(AssertionList& assertions,
       return SolverResult::UNSAT;
   }
 
+  if (impl->options.incremental)
+    return resolve_incremental(assertions, extra);
+
   auto block = CAFFEINE_TRACE_SPAN("Z3Solver::resolve");
 
   z3::solver solver = impl->tactic.mk_solver();
@@ -248,6 +399,143 @@ SolverResult Z3Solver::resolve(AssertionList& assertions,
   }
 }
 
+SolverResult Z3Solver::resolve_incremental(AssertionList& assertions,
+                                           const Assertion& extra) {
+  auto block = CAFFEINE_TRACE_SPAN("Z3Solver::resolve_incremental");
+
+  if (!impl->incremental ||
+      impl->incremental->retained.size() > impl->options.max_retained) {
+    if (impl->options.tactic == "default")
+      impl->incremental = std::make_unique<Impl::Incremental>(impl->ctx);
+    else
+      impl->incremental = std::make_unique<Impl::Incremental>(impl->tactic);
+  }
+
+  auto& state = *impl->incremental;
+  auto& frames = state.frames;
+
+  // If anything goes wrong part-way through then the solver scopes won't match
+  // up with the recorded frames anymore. Throw away all the state so that the
+  // next query starts from scratch.
+  auto guard = make_guard([&] { impl->incremental.reset(); });
+
+  std::vector<Assertion> query;
+  query.reserve(assertions.size());
+  for (const Assertion& assertion : assertions.proven()) {
+    if (!assertion.is_empty())
+      query.push_back(assertion);
+  }
+  size_t proven = query.size();
+  for (const Assertion& assertion : assertions.unproven()) {
+    if (!assertion.is_empty())
+      query.push_back(assertion);
+  }
+
+  // Find the longest run of frames that are still a prefix of the query.
+  size_t pos = 0;
+  size_t keep = 0;
+  for (; keep < frames.size(); ++keep) {
+    const auto& frame = frames[keep].assertions;
+    if (frame.size() > query.size() - pos)
+      break;
+    if (!std::equal(frame.begin(), frame.end(), query.begin() + pos))
+      break;
+    pos += frame.size();
+  }
+
+  if (keep < frames.size()) {
+    std::vector<z3::expr> orphaned;
+    for (size_t i = keep; i < frames.size(); ++i) {
+      auto& side = frames[i].side_constraints;
+      orphaned.insert(orphaned.end(), side.begin(), side.end());
+    }
+
+    state.solver.pop(frames.size() - keep);
+    frames.resize(keep);
+
+    for (const z3::expr& constraint : orphaned)
+      state.solver.add(constraint);
+    if (!frames.empty()) {
+      auto& side = frames.back().side_constraints;
+      side.insert(side.end(), orphaned.begin(), orphaned.end());
+    }
+  }
+
+  auto push_frame = [&](size_t begin, size_t end) {
+    if (begin >= end)
+      return;
+
+    state.solver.push();
+    Impl::Frame frame;
+    frame.assertions.reserve(end - begin);
+
+    for (size_t i = begin; i < end; ++i) {
+      const Assertion& assertion = query[i];
+      state.retained.push_back(assertion.value());
+      state.solver.add(
+          normalize_to_bool(state.visitor.visit(*assertion.value())));
+      frame.assertions.push_back(assertion);
+    }
+
+    frame.side_constraints = state.visitor.take_side_constraints();
+    frames.push_back(std::move(frame));
+  };
+
+  // Keep the proven assertions in separate scopes from the unproven ones so
+  // that rolling back the unproven tail doesn't disturb the proven prefix.
+  push_frame(pos, proven);
+  push_frame(std::max(pos, proven), query.size());
+
+  z3::expr_vector assumptions(impl->ctx);
+  if (!extra.is_constant_value(true)) {
+    state.retained.push_back(extra.value());
+
+    z3::expr literal = state.visitor.next_const(impl->ctx.bool_sort());
+    z3::expr value = normalize_to_bool(state.visitor.visit(*extra.value()));
+    state.solver.add(z3::implies(literal, value));
+    assumptions.push_back(literal);
+
+    auto side = state.visitor.take_side_constraints();
+    if (!frames.empty()) {
+      auto& dest = frames.back().side_constraints;
+      dest.insert(dest.end(), side.begin(), side.end());
+    }
+  }
+
+  auto result = state.solver.check(assumptions);
+  guard.dismiss();
+
+  if (block.is_enabled()) {
+    std::stringstream ss;
+    for (const Assertion& assertion : query) {
+      if ((size_t)ss.tellp() > tracing::AutoTraceBlock::MAX_ANNOTATION_SIZE)
+        break;
+      ss << assertion << '\n';
+    }
+    if (!extra.is_constant_value(true))
+      ss << extra << '\n';
+
+    block.annotate("query", ss.str());
+    block.annotate("result", magic_enum::enum_name(result));
+    block.annotate("reused_frames", std::to_string(keep));
+  }
+
+  switch (result) {
+  case z3::sat:
+    return SolverResult(
+        SolverResult::SAT,
+        std::make_unique<Z3Model>(
+            state.solver.get_model(),
+            query_constants(state.constMap, query, extra)));
+
+  case z3::unsat:
+    return SolverResult::UNSAT;
+
+  default:
+    return SolverResult::Unknown;
+  }
+}
+
 void Z3Solver::interrupt() {
   context().interrupt();
 }
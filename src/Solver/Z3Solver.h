@@ -12,22 +12,57 @@
 #include <z3++.h>
 
 #include <limits>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace caffeine {
 
 class Z3Solver::Impl {
 public:
+  // A single push/pop scope of the incremental solver.
+  struct Frame {
+    std::vector<Assertion> assertions;
+    // Side constraints generated while converting assertions in this frame.
+    // These need to be re-added to the parent scope when this frame is popped
+    // since the converted expressions stay cached.
+    std::vector<z3::expr> side_constraints;
+  };
+
+  // State that is kept alive across queries when running in incremental mode.
+  struct Incremental {
+    z3::solver solver;
+    Z3ConstMap constMap;
+    Z3OpVisitor visitor;
+    std::vector<Frame> frames;
+
+    // Keeps the operations referenced by the visitor cache alive so that the
+    // pointers used as cache keys are never reused for a different operation.
+    std::vector<OpRef> retained;
+
+    Incremental(z3::context& ctx)
+        : solver(ctx), visitor(&solver, constMap) {
+      solver.set("ctrl_c", false);
+    }
+    Incremental(z3::tactic& tactic)
+        : solver(tactic.mk_solver()), visitor(&solver, constMap) {
+      solver.set("ctrl_c", false);
+    }
+  };
+
   z3::context ctx;
   z3::tactic tactic;
+  Z3SolverOptions options;
+  std::unique_ptr<Incremental> incremental;
 
-  Impl() : tactic(ctx, "default") {
+  Impl(const Z3SolverOptions& options = Z3SolverOptions())
+      : tactic(ctx, options.tactic.c_str()), options(options) {
     // We want z3 to generate models
     ctx.set("model", true);
     // Automatically select and configure the solver
-    ctx.set("auto_config", true);
+    ctx.set("auto_config", options.auto_config);
   }
 };
 
@@ -0,0 +1,75 @@
+#include "caffeine/ADT/PersistentSlotMap.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+TEST(persistent_slotmap, initialized_empty) {
+  persistent_slot_map<unsigned> map;
+
+  ASSERT_EQ(map.begin(), map.end());
+}
+
+TEST(persistent_slotmap, insert_remove) {
+  persistent_slot_map<unsigned> map;
+
+  auto key1 = map.insert(1);
+  auto key2 = map.insert(2);
+
+  ASSERT_EQ(map.remove(key1), 1u);
+  ASSERT_EQ(map.find(key1), map.end());
+  ASSERT_THROW(map.at(key1), std::out_of_range);
+
+  auto key3 = map.insert(3);
+  ASSERT_EQ(map.find(key1), map.end());
+  ASSERT_EQ(map.at(key2), 2u);
+  ASSERT_EQ(map.at(key3), 3u);
+
+  auto it = map.begin();
+  ASSERT_EQ(it.key(), key3);
+  ASSERT_EQ(*it++, 3u);
+  ASSERT_EQ(it.key(), key2);
+  ASSERT_EQ(*it++, 2u);
+  ASSERT_EQ(it, map.end());
+}
+
+TEST(persistent_slotmap, copies_are_independent) {
+  persistent_slot_map<unsigned> map;
+
+  auto key1 = map.insert(1);
+  auto key2 = map.insert(2);
+
+  persistent_slot_map<unsigned> copy = map;
+  copy.remove(key1);
+  auto key3 = copy.insert(3);
+
+  ASSERT_EQ(map.at(key1), 1u);
+  ASSERT_EQ(map.find(key3), map.end());
+  ASSERT_EQ(copy.find(key1), copy.end());
+  ASSERT_EQ(copy.at(key2), 2u);
+  ASSERT_EQ(copy.at(key3), 3u);
+}
+
+TEST(persistent_slotmap, mutable_access_copies_shared_values) {
+  persistent_slot_map<unsigned> map;
+
+  auto key = map.insert(1);
+  persistent_slot_map<unsigned> copy = map;
+
+  copy[key] = 2;
+  ASSERT_EQ(map[key], 1u);
+  ASSERT_EQ(copy[key], 2u);
+
+  // Both maps now own their value so modifying either in place must not
+  // affect the other.
+  map.at(key) = 3;
+  copy.at(key) = 4;
+  ASSERT_EQ(std::as_const(map).at(key), 3u);
+  ASSERT_EQ(std::as_const(copy).at(key), 4u);
+
+  // The source of a copy cannot modify its values in place either.
+  persistent_slot_map<unsigned> other = map;
+  map[key] = 5;
+  ASSERT_EQ(other[key], 3u);
+  ASSERT_EQ(map[key], 5u);
+}
@@ -2,6 +2,7 @@
 #include "caffeine/IR/Operation.h"
 #include "caffeine/IR/OperationData.h"
 #include <gtest/gtest.h>
+#include <utility>
 
 using namespace caffeine;
 
@@ -83,3 +84,89 @@ TEST_F(EGraphTests, add_merge) {
   ASSERT_EQ(egraph.find(a), egraph.find(b));
   ASSERT_EQ(egraph.find(e), egraph.find(b));
 }
+
+TEST_F(EGraphTests, copy_is_independent) {
+  size_t a = egraph.add(*Constant::Create(Type::int_ty(32), "a"));
+  size_t b = egraph.add(*Constant::Create(Type::int_ty(32), "b"));
+  size_t c = egraph.add(*BinaryOp::CreateAdd(
+      EGraphNode::Create(Type::int_ty(32), a),
+      EGraphNode::Create(Type::int_ty(32), b)));
+  egraph.rebuild();
+
+  EGraph copy = egraph;
+  // Copying shouldn't copy any of the e-classes.
+  ASSERT_EQ(std::as_const(copy).get(c), std::as_const(egraph).get(c));
+
+  copy.merge(a, b);
+  copy.add_merge(c, ENode{std::make_shared<ConstantIntData>(
+                        llvm::APInt::getNullValue(32))});
+  copy.rebuild();
+
+  ASSERT_EQ(copy.find(a), copy.find(b));
+  ASSERT_TRUE(copy.get(c)->is_constant());
+
+  ASSERT_NE(egraph.find(a), egraph.find(b));
+  ASSERT_FALSE(egraph.get(c)->is_constant());
+  ASSERT_EQ(egraph.get(c)->nodes.size(), 1u);
+  ASSERT_EQ(egraph.get(a)->parents.size(), 1u);
+
+  // Modifying the original afterwards shouldn't affect the copy either.
+  egraph.add_merge(a, ENode{std::make_shared<ConstantIntData>(
+                          llvm::APInt::getAllOnesValue(32))});
+  egraph.rebuild();
+
+  ASSERT_TRUE(egraph.get(a)->is_constant());
+  ASSERT_FALSE(copy.get(a)->is_constant());
+}
+
+TEST_F(EGraphTests, collect_unreachable) {
+  size_t a = egraph.add(*Constant::Create(Type::int_ty(32), "a"));
+  size_t b = egraph.add(*Constant::Create(Type::int_ty(32), "b"));
+  size_t c = egraph.add(*BinaryOp::CreateAdd(
+      EGraphNode::Create(Type::int_ty(32), a),
+      EGraphNode::Create(Type::int_ty(32), b)));
+  size_t d = egraph.add(*BinaryOp::CreateMul(
+      EGraphNode::Create(Type::int_ty(32), a),
+      EGraphNode::Create(Type::int_ty(32), c)));
+  size_t e = egraph.add(*Constant::Create(Type::int_ty(32), "e"));
+  egraph.merge(b, e);
+  egraph.rebuild();
+
+  ASSERT_EQ(egraph.size(), 4u);
+  ASSERT_EQ(egraph.collect({c}), 1u);
+  ASSERT_EQ(egraph.size(), 3u);
+
+  // Both canonical and non-canonical ids of the remaining e-classes are still
+  // valid.
+  ASSERT_NE(std::as_const(egraph).get(a), nullptr);
+  ASSERT_NE(std::as_const(egraph).get(e), nullptr);
+  ASSERT_EQ(std::as_const(egraph).get(d), nullptr);
+  ASSERT_EQ(egraph.get(a)->parents.size(), 1u);
+
+  // Adding the removed expression again creates a new e-class.
+  size_t d2 = egraph.add(*BinaryOp::CreateMul(
+      EGraphNode::Create(Type::int_ty(32), a),
+      EGraphNode::Create(Type::int_ty(32), c)));
+  ASSERT_NE(d2, d);
+  ASSERT_EQ(egraph.size(), 4u);
+}
+
+TEST_F(EGraphTests, equal_data_is_interned) {
+  size_t a = egraph.add(*Constant::Create(Type::int_ty(32), "a"));
+  size_t b = egraph.add(*Constant::Create(Type::int_ty(32), "b"));
+
+  Type i32 = Type::int_ty(32);
+  auto data1 = std::make_shared<OperationData>(Operation::Add, i32);
+  auto data2 = std::make_shared<OperationData>(Operation::Add, i32);
+  auto data3 = std::make_shared<OperationData>(Operation::Mul, i32);
+
+  size_t c = egraph.add(ENode{data1, {a, b}});
+  ASSERT_EQ(egraph.classof(ENode{data2, {a, b}}), c);
+  ASSERT_EQ(egraph.add(ENode{data2, {a, b}}), c);
+  ASSERT_EQ(egraph.classof(ENode{data3, {a, b}}), std::nullopt);
+
+  // The second use of equal data shares the data of the first.
+  size_t d = egraph.add(ENode{data2, {b, a}});
+  ASSERT_NE(c, d);
+  ASSERT_EQ(egraph.get(d)->nodes.front().data, data1);
+}
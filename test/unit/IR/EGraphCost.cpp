@@ -0,0 +1,78 @@
+#include "caffeine/IR/EGraphCost.h"
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/IR/Operation.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace caffeine;
+
+class EGraphCostTests : public ::testing::Test {
+public:
+  EGraph egraph;
+
+  OpRef add(const OpRef& op) {
+    return EGraphNode::Create(op->type(), egraph.add(*op));
+  }
+
+  OpRef constant(uint32_t bitwidth, uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(bitwidth, value));
+  }
+};
+
+TEST_F(EGraphCostTests, weighted_prefers_cheap_ops) {
+  auto x = add(Constant::Create(Type::int_ty(64), "x"));
+  auto mul = add(BinaryOp::CreateMul(x, constant(64, 8)));
+  auto shl = add(BinaryOp::CreateShl(x, constant(64, 3)));
+
+  size_t id = egraph.merge(egraph.add(*mul), egraph.add(*shl));
+  egraph.rebuild();
+
+  // Both are the same size under the uniform model so this may pick either
+  // one. Changing the model must discard the cached choice.
+  egraph.extract(id);
+
+  egraph.set_cost_model(std::make_shared<WeightedCostModel>());
+  ASSERT_EQ(egraph.extract(id)->opcode(), Operation::Shl);
+}
+
+TEST_F(EGraphCostTests, weighted_scales_with_bitwidth) {
+  WeightedCostModel model;
+
+  ASSERT_LT(model.cost(Operation::Add, 8), model.cost(Operation::Add, 128));
+  ASSERT_LT(model.cost(Operation::Add, 64), model.cost(Operation::Mul, 64));
+  ASSERT_LT(model.cost(Operation::Mul, 64), model.cost(Operation::UDiv, 64));
+  ASSERT_LT(model.cost(Operation::UDiv, 1u << 20),
+            model.cost(Operation::ConstantNamed, 8));
+}
+
+TEST_F(EGraphCostTests, load_save_roundtrip) {
+  WeightedCostModel model;
+  model.set_weight(Operation::ICmpUlt, {2.5, 0.125});
+  model.set_default_weight({3.0, 0.0});
+
+  std::stringstream ss;
+  model.save(ss);
+
+  std::string error;
+  auto loaded = WeightedCostModel::load(ss, error);
+  ASSERT_TRUE(loaded) << error;
+
+  ASSERT_EQ(loaded->weight(Operation::ICmpUlt),
+            model.weight(Operation::ICmpUlt));
+  ASSERT_EQ(loaded->weight(Operation::Mul), model.weight(Operation::Mul));
+  ASSERT_EQ(loaded->default_weight(), model.default_weight());
+}
+
+TEST_F(EGraphCostTests, load_rejects_malformed) {
+  std::string error;
+
+  std::stringstream unknown("# comment\nAdd 1 0\nFrobnicate 1 0\n");
+  ASSERT_FALSE(WeightedCostModel::load(unknown, error));
+  ASSERT_EQ(error, "line 3: unknown opcode 'Frobnicate'");
+
+  std::stringstream negative("Add -1 0\n");
+  ASSERT_FALSE(WeightedCostModel::load(negative, error));
+
+  std::stringstream missing("Add 1\n");
+  ASSERT_FALSE(WeightedCostModel::load(missing, error));
+}
@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 #include <mutex>
 #include <optional>
+#include <set>
 #include <thread>
 
 using namespace caffeine;
@@ -235,6 +236,61 @@ TEST_F(EMatchingTests, load_store_elimination_elim_store) {
   ASSERT_EQ(egraph.find(direct_id), egraph.find(load_id));
 }
 
+TEST_F(EMatchingTests, multi_load_store_elimination) {
+  r::multi_load_store_elimination(builder);
+  auto matcher = builder.build();
+
+  // clang-format off
+  auto value  = add(Constant::Create(Type::int_ty(32), "value"));
+  auto size   = add(Constant::Create(Type::int_ty(32), "size"));
+  auto offset = add(Constant::Create(Type::int_ty(32), "offset"));
+  auto array  = add(ConstantArray::Create("array", size));
+  auto store  = add(MultiStoreOp::Create(array, offset, value, true));
+  auto little = add(MultiLoadOp::Create(value->type(), store, offset, true));
+  auto big    = add(MultiLoadOp::Create(value->type(), store, offset, false));
+
+  auto value_id  = egraph.add(*value);
+  auto little_id = egraph.add(*little);
+  auto big_id    = egraph.add(*big);
+  // clang-format on
+
+  egraph.simplify(matcher);
+
+  ASSERT_EQ(egraph.find(value_id), egraph.find(little_id));
+  ASSERT_NE(egraph.find(value_id), egraph.find(big_id));
+}
+
+TEST_F(EMatchingTests, load_multi_store_elimination) {
+  r::load_multi_store_elimination(builder);
+  auto matcher = builder.build();
+
+  auto offset = [&](uint64_t value) {
+    return add(ConstantInt::Create(llvm::APInt(32, value)));
+  };
+
+  // clang-format off
+  auto value  = add(Constant::Create(Type::int_ty(32), "value"));
+  auto size   = add(Constant::Create(Type::int_ty(32), "size"));
+  auto array  = add(ConstantArray::Create("array", size));
+  auto store  = add(MultiStoreOp::Create(array, offset(4), value, true));
+  auto inside = add(LoadOp::Create(store, offset(6)));
+  auto after  = add(LoadOp::Create(store, offset(8)));
+  auto byte   = add(UnaryOp::CreateTrunc(Type::int_ty(8),
+                                         BinaryOp::CreateLShr(value, 16)));
+  auto direct = add(LoadOp::Create(array, offset(8)));
+
+  auto inside_id = egraph.add(*inside);
+  auto after_id  = egraph.add(*after);
+  auto byte_id   = egraph.add(*byte);
+  auto direct_id = egraph.add(*direct);
+  // clang-format on
+
+  egraph.simplify(matcher);
+
+  ASSERT_EQ(egraph.find(byte_id), egraph.find(inside_id));
+  ASSERT_EQ(egraph.find(direct_id), egraph.find(after_id));
+}
+
 TEST_F(EMatchingTests, zext_trunc_elimination) {
   r::zext_trunc_elimination(builder);
   auto matcher = builder.build();
@@ -306,3 +362,86 @@ TEST_F(EMatchingTests, shl_lshr_elimination_equal) {
 
   ASSERT_EQ(egraph.find(cid), egraph.find(eid));
 }
+
+// (and 0 a) needs one iteration for commutativity to produce (and a 0) and
+// another for it to be eliminated. Stopping after one iteration should leave
+// the second rewrite for the next call to simplify.
+TEST_F(EMatchingTests, budget_defers_remaining_work) {
+  // The e-graph analysis would fold anything involving constants on its own
+  // so this uses a rewrite that takes two iterations over symbolic values.
+  r::associativity(builder, Operation::And);
+  r::and_elimination(builder);
+  auto matcher = builder.build();
+
+  auto a = add(Constant::Create(Type::int_ty(32), "a"));
+  auto b = add(Constant::Create(Type::int_ty(32), "b"));
+  auto d = add(BinaryOp::CreateAnd(a, b));
+  auto c = add(BinaryOp::CreateAnd(a, d));
+
+  auto did = egraph.add(*d);
+  auto cid = egraph.add(*c);
+
+  ematching::SaturationBudget budget;
+  budget.max_iterations = 1;
+
+  uint64_t hits = ematching::SaturationBudget::exhausted_count();
+  egraph.simplify(matcher, budget);
+
+  ASSERT_NE(egraph.find(cid), egraph.find(did));
+  ASSERT_EQ(ematching::SaturationBudget::exhausted_count(), hits + 1);
+
+  egraph.simplify(matcher);
+
+  ASSERT_EQ(egraph.find(cid), egraph.find(did));
+}
+
+// The class limit only counts classes added during the call so a graph that
+// is already larger than the limit still gets simplified.
+TEST_F(EMatchingTests, class_budget_is_relative_to_initial_size) {
+  r::associativity(builder, Operation::And);
+  r::and_elimination(builder);
+  auto matcher = builder.build();
+
+  auto a = add(Constant::Create(Type::int_ty(32), "a"));
+  auto b = add(Constant::Create(Type::int_ty(32), "b"));
+  auto d = add(BinaryOp::CreateAnd(a, b));
+  auto c = add(BinaryOp::CreateAnd(a, d));
+
+  auto did = egraph.add(*d);
+  auto cid = egraph.add(*c);
+
+  ematching::SaturationBudget budget;
+  budget.max_classes = egraph.size();
+  egraph.simplify(matcher, budget);
+
+  ASSERT_EQ(egraph.find(cid), egraph.find(did));
+}
+
+TEST_F(EMatchingTests, wildcard_clauses_match_every_opcode) {
+  std::set<size_t> seen;
+  auto record = [&](ematching::GraphAccessor& egraph, size_t eclass, size_t) {
+    seen.insert(egraph.graph()->find(eclass));
+  };
+
+  builder.add_matcher(builder.add_any(), record);
+  r::commutativity(builder);
+  r::and_zero_elimination(builder);
+  auto matcher = builder.build();
+
+  auto a = add(Constant::Create(Type::int_ty(32), "a"));
+  auto b = add(Constant::Create(Type::int_ty(32), "b"));
+  auto c = add(BinaryOp::CreateAdd(a, b));
+  auto d = add(BinaryOp::CreateAdd(b, a));
+
+  size_t aid = egraph.add(*a);
+  size_t bid = egraph.add(*b);
+  size_t cid = egraph.add(*c);
+  size_t did = egraph.add(*d);
+
+  egraph.simplify(matcher);
+
+  ASSERT_EQ(egraph.find(cid), egraph.find(did));
+  ASSERT_TRUE(seen.count(egraph.find(aid)));
+  ASSERT_TRUE(seen.count(egraph.find(bid)));
+  ASSERT_TRUE(seen.count(egraph.find(cid)));
+}
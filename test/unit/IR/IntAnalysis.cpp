@@ -0,0 +1,102 @@
+#include "caffeine/IR/IntAnalysis.h"
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/IR/EGraphMatching.h"
+#include "caffeine/IR/Operation.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+
+using namespace caffeine;
+
+class IntAnalysisTests : public ::testing::Test {
+public:
+  EGraph egraph;
+
+  OpRef add(const OpRef& op) {
+    return EGraphNode::Create(op->type(), egraph.add(*op));
+  }
+
+  OpRef symbol(uint32_t bitwidth, const char* name) {
+    return add(Constant::Create(Type::int_ty(bitwidth), std::string(name)));
+  }
+
+  OpRef constant(uint32_t bitwidth, uint64_t value) {
+    return add(ConstantInt::Create(llvm::APInt(bitwidth, value)));
+  }
+
+  const IntAnalysis& analysis(const OpRef& op) {
+    return *std::as_const(egraph).get(egraph.add(*op))->analysis;
+  }
+};
+
+TEST_F(IntAnalysisTests, zext_range) {
+  auto x = symbol(8, "x");
+  auto ext = add(UnaryOp::CreateZExt(Type::int_ty(32), x));
+
+  const IntAnalysis& result = analysis(ext);
+  ASSERT_EQ(result.range.getUnsignedMax(), 255u);
+  ASSERT_EQ(result.known_zero.countLeadingOnes(), 24u);
+}
+
+TEST_F(IntAnalysisTests, and_known_bits) {
+  auto x = symbol(32, "x");
+  auto masked = add(BinaryOp::CreateAnd(x, constant(32, 0xF0)));
+
+  const IntAnalysis& result = analysis(masked);
+  ASSERT_EQ(result.known_zero, ~llvm::APInt(32, 0xF0));
+  ASSERT_EQ(result.range.getUnsignedMax(), 0xF0u);
+}
+
+TEST_F(IntAnalysisTests, mul_trailing_zeros) {
+  auto x = symbol(64, "x");
+  auto scaled = add(BinaryOp::CreateMul(x, constant(64, 8)));
+  auto offset = add(BinaryOp::CreateAdd(scaled, constant(64, 4)));
+
+  ASSERT_EQ(analysis(scaled).known_zero.countTrailingOnes(), 3u);
+  ASSERT_TRUE(analysis(offset).known_one[2]);
+  ASSERT_TRUE(analysis(offset).known_zero[1]);
+  ASSERT_TRUE(analysis(offset).known_zero[0]);
+}
+
+TEST_F(IntAnalysisTests, propagated_by_rebuild) {
+  auto x = symbol(32, "x");
+  auto lo = add(UnaryOp::CreateZExt(Type::int_ty(32), symbol(16, "lo")));
+  auto sum = add(BinaryOp::CreateAdd(x, constant(32, 1)));
+
+  ASSERT_TRUE(analysis(sum).range.isFullSet());
+
+  // Learning that x is a zero-extended 16-bit value bounds everything that
+  // uses x.
+  egraph.merge(egraph.add(*x), egraph.add(*lo));
+  egraph.rebuild();
+
+  ASSERT_EQ(analysis(sum).range.getUnsignedMax(), 0x10000u);
+}
+
+TEST_F(IntAnalysisTests, decides_icmp_and_select) {
+  auto x = symbol(8, "x");
+  auto ext = add(UnaryOp::CreateZExt(Type::int_ty(64), x));
+  auto cmp = add(ICmpOp::CreateICmp(ICmpOpcode::ULT, ext, 256));
+
+  auto a = symbol(32, "a");
+  auto b = symbol(32, "b");
+  auto sel = add(SelectOp::Create(cmp, a, b));
+
+  egraph.simplify(EMatcher::builder().build());
+
+  ASSERT_TRUE(std::as_const(egraph).get(egraph.add(*cmp))->is_constant());
+  ASSERT_EQ(egraph.find(egraph.add(*sel)), egraph.find(egraph.add(*a)));
+}
+
+TEST_F(IntAnalysisTests, compare) {
+  IntAnalysis small{32u};
+  small.range = llvm::ConstantRange(llvm::APInt(32, 0), llvm::APInt(32, 16));
+  IntAnalysis big{llvm::APInt(32, 16)};
+
+  ASSERT_EQ(IntAnalysis::compare(Operation::ICmpUlt, small, big), true);
+  ASSERT_EQ(IntAnalysis::compare(Operation::ICmpUge, small, big), false);
+  ASSERT_EQ(IntAnalysis::compare(Operation::ICmpEq, small, big), false);
+  ASSERT_EQ(IntAnalysis::compare(Operation::ICmpUlt, big, small), false);
+  ASSERT_EQ(IntAnalysis::compare(Operation::ICmpSlt, small, small),
+            std::nullopt);
+}
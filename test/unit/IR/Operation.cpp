@@ -1,5 +1,6 @@
 
 #include "caffeine/IR/Operation.h"
+#include "caffeine/IR/OperationSimplifier.h"
 #include "caffeine/Memory/MemHeap.h"
 #include "caffeine/Solver/Z3Solver.h"
 #include <gtest/gtest.h>
@@ -167,6 +168,167 @@ TEST(OperationTests, float_load_store_simplify_to_noop) {
   ASSERT_EQ(value, read) << read;
 }
 
+TEST(OperationTests, store_chain_is_collapsed_at_threshold) {
+  auto value = Constant::Create(Type::int_ty(8), "value");
+  auto offset = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(64, value));
+  };
+  auto byte = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(8, value));
+  };
+
+  auto array = ConstantArray::Create("array", offset(16));
+  auto data = array;
+
+  // Short chains are kept as they are.
+  for (uint64_t i = 0; i + 1 < OperationSimplifier::min_snapshot_depth; ++i) {
+    data = StoreOp::Create(data, offset(i % 8), byte(i));
+    ASSERT_EQ((Operation::Opcode)data->opcode(), Operation::Store);
+  }
+
+  data = StoreOp::Create(data, offset(0), value);
+  ASSERT_EQ((Operation::Opcode)data->opcode(), Operation::FixedArray);
+
+  ASSERT_EQ(LoadOp::Create(data, offset(0)), value);
+  ASSERT_EQ(*LoadOp::Create(data, offset(1)),
+            *byte(OperationSimplifier::min_snapshot_depth - 7));
+
+  // Bytes that were never written still come from the original array.
+  ASSERT_EQ(*LoadOp::Create(data, offset(12)),
+            *LoadOp::Create(array, offset(12)));
+}
+
+TEST(OperationTests, store_chain_on_large_array_is_kept) {
+  auto offset = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(64, value));
+  };
+  auto size = offset(OperationSimplifier::max_snapshot_size + 1);
+  auto data = ConstantArray::Create("array", size);
+
+  for (uint64_t i = 0; i < 2 * OperationSimplifier::min_snapshot_depth; ++i)
+    data = StoreOp::Create(data, offset(i), ConstantInt::CreateZero(8));
+
+  ASSERT_EQ((Operation::Opcode)data->opcode(), Operation::Store);
+}
+
+TEST(OperationTests, out_of_bounds_store_is_kept) {
+  auto offset = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(64, value));
+  };
+  auto byte = ConstantInt::CreateZero(8);
+
+  // Out of bounds on top of a FixedArray.
+  auto fixed = FixedArray::Create(Type::int_ty(64), byte, 16);
+  auto store = StoreOp::Create(fixed, offset(16), byte);
+  ASSERT_EQ((Operation::Opcode)store->opcode(), Operation::Store);
+
+  // Out of bounds on top of a chain that is deep enough to be collapsed.
+  auto data = ConstantArray::Create("array", offset(16));
+  for (uint64_t i = 0; i + 1 < OperationSimplifier::min_snapshot_depth; ++i)
+    data = StoreOp::Create(data, offset(i % 8), byte);
+  data = StoreOp::Create(data, offset(16), byte);
+  ASSERT_EQ((Operation::Opcode)data->opcode(), Operation::Store);
+}
+
+TEST(OperationTests, load_skips_concrete_stores) {
+  auto size = Constant::Create(Type::int_ty(64), "size");
+  auto value = Constant::Create(Type::int_ty(8), "value");
+  auto base = AllocOp::Create(size, ConstantInt::CreateZero(8));
+
+  auto offset = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(64, value));
+  };
+
+  // The size is unknown so these have to stay as a chain of stores.
+  auto data = base;
+  data = StoreOp::Create(data, offset(1), value);
+  data = StoreOp::Create(data, offset(2), ConstantInt::CreateZero(8));
+  data = StoreOp::Create(data, offset(3), ConstantInt::CreateZero(8));
+  ASSERT_EQ((Operation::Opcode)data->opcode(), Operation::Store);
+
+  ASSERT_EQ(LoadOp::Create(data, offset(1)), value);
+  ASSERT_EQ(*LoadOp::Create(data, offset(5)),
+            *LoadOp::Create(base, offset(5)));
+}
+
+TEST(OperationTests, concrete_store_on_symbolic_store_is_kept) {
+  auto index = Constant::Create(Type::int_ty(64), "index");
+  auto value = Constant::Create(Type::int_ty(8), "value");
+  auto zero = ConstantInt::CreateZero(8);
+  auto offset = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(64, value));
+  };
+
+  auto data = FixedArray::Create(Type::int_ty(64), zero, 4);
+  data = StoreOp::Create(data, index, value);
+  data = StoreOp::Create(data, offset(0), zero);
+  ASSERT_EQ((Operation::Opcode)data->opcode(), Operation::Store);
+
+  ASSERT_EQ(LoadOp::Create(data, offset(0)), zero);
+  ASSERT_EQ(*LoadOp::Create(data, offset(2)),
+            *SelectOp::Create(ICmpOp::CreateICmpEQ(index, offset(2)), value,
+                              zero));
+}
+
+TEST(OperationTests, symbolic_offset_access_uses_multi_byte_ops) {
+  auto layout = llvm::DataLayout(X86_64_LINUX);
+  auto index = Constant::Create(Type::int_ty(64), "index");
+  auto other = Constant::Create(Type::int_ty(64), "other");
+  auto value = Constant::Create(Type::int_ty(32), "value");
+  auto size = ConstantInt::Create(llvm::APInt(64, 16));
+  auto alloc = Allocation(ConstantInt::CreateZero(64), size,
+                          ConstantArray::Create("array", size),
+                          AllocationKind::Alloca,
+                          AllocationPermissions::ReadWrite);
+
+  alloc.write(index, value, layout);
+  ASSERT_EQ((Operation::Opcode)alloc.data()->opcode(), Operation::StoreLE);
+
+  ASSERT_EQ(alloc.read(index, Type::int_ty(32), layout), value);
+
+  auto read = alloc.read(other, Type::int_ty(32), layout);
+  ASSERT_EQ((Operation::Opcode)read->opcode(), Operation::LoadLE);
+}
+
+TEST(OperationTests, byte_load_sees_multi_byte_store) {
+  auto size = Constant::Create(Type::int_ty(64), "size");
+  auto value = Constant::Create(Type::int_ty(32), "value");
+  auto base = AllocOp::Create(size, ConstantInt::CreateZero(8));
+  auto offset = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(64, value));
+  };
+
+  auto little = MultiStoreOp::Create(base, offset(4), value, true);
+  auto big = MultiStoreOp::Create(base, offset(4), value, false);
+
+  ASSERT_EQ(*LoadOp::Create(little, offset(5)),
+            *UnaryOp::CreateTrunc(Type::int_ty(8),
+                                  BinaryOp::CreateLShr(value, 8)));
+  ASSERT_EQ(*LoadOp::Create(big, offset(5)),
+            *UnaryOp::CreateTrunc(Type::int_ty(8),
+                                  BinaryOp::CreateLShr(value, 16)));
+  ASSERT_EQ(*LoadOp::Create(little, offset(8)),
+            *LoadOp::Create(base, offset(8)));
+
+  ASSERT_EQ(MultiLoadOp::Create(Type::int_ty(32), little, offset(4), true),
+            value);
+}
+
+TEST(OperationTests, big_endian_store_is_reversed) {
+  auto layout = llvm::DataLayout("E-m:e-i64:64-n32:64-S128");
+  auto size = ConstantInt::Create(llvm::APInt(64, 4));
+  auto alloc = Allocation(ConstantInt::CreateZero(64), size,
+                          AllocOp::Create(size, ConstantInt::CreateZero(8)),
+                          AllocationKind::Alloca,
+                          AllocationPermissions::ReadWrite);
+
+  alloc.write(ConstantInt::CreateZero(64),
+              ConstantInt::Create(llvm::APInt(32, 0x01020304)), layout);
+
+  auto byte = alloc.read(ConstantInt::CreateZero(64), Type::int_ty(8), layout);
+  ASSERT_EQ(*byte, *ConstantInt::Create(llvm::APInt(8, 0x01)));
+}
+
 TEST(OperationTests, constant_int_has_correct_value) {
   auto v1 = ConstantInt::Create(llvm::APInt(37, 0));
   auto v2 = ConstantInt::Create(llvm::APInt(37, 14));
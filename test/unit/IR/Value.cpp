@@ -88,3 +88,13 @@ TEST(ir_value, print_vector) {
   // it will help them update the testcase
   ASSERT_EQ(output.str(), "<vector>");
 }
+
+TEST(ir_value, bool_values_are_one_bit_wide) {
+  Value t{true};
+  Value f{false};
+
+  ASSERT_EQ(t.apint().getBitWidth(), 1u);
+  ASSERT_EQ(f.apint().getBitWidth(), 1u);
+  ASSERT_TRUE(t.apint().getBoolValue());
+  ASSERT_FALSE(f.apint().getBoolValue());
+}
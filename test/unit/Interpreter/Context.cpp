@@ -0,0 +1,113 @@
+#include "caffeine/Interpreter/Context.h"
+#include "caffeine/IR/Operation.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+
+using namespace caffeine;
+
+class ContextTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> M;
+
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+  OpRef y = Constant::Create(Type::int_ty(32), "y");
+
+public:
+  void SetUp() override {
+#ifndef CAFFEINE_BAZEL
+    M = loadFile("Interpreter/ir-with-global.ll");
+#else
+    M = loadFile("test/unit/Interpreter/ir-with-global.ll");
+#endif
+
+    ASSERT_NE(M, nullptr);
+  }
+
+  static bool contains(const AssertionList& list, const OpRef& expr) {
+    return std::any_of(list.begin(), list.end(), [&](const Assertion& a) {
+      return *a.value() == *expr;
+    });
+  }
+
+private:
+  std::unique_ptr<llvm::Module> loadFile(const char* filename) {
+    llvm::SMDiagnostic error;
+    auto module = llvm::parseIRFile(filename, error, context);
+
+    if (!module)
+      error.print("unittest", llvm::errs());
+
+    return module;
+  }
+};
+
+TEST_F(ContextTests, extract_assertions_is_incremental) {
+  Context ctx{M->getFunction("func")};
+
+  auto a1 = ICmpOp::CreateICmp(ICmpOpcode::ULT, x, 5);
+  auto a2 = ICmpOp::CreateICmp(ICmpOpcode::UGT, y, 2);
+
+  ctx.add(Assertion(a1));
+  AssertionList first = ctx.extract_assertions();
+  ASSERT_EQ(first.size(), 1u);
+  ASSERT_TRUE(contains(first, a1));
+
+  ctx.add(Assertion(a2));
+  AssertionList second = ctx.extract_assertions();
+  ASSERT_EQ(second.size(), 2u);
+  ASSERT_TRUE(contains(second, a1));
+  ASSERT_TRUE(contains(second, a2));
+
+  // Merging x with a constant changes the first assertion so it must be
+  // extracted again.
+  ctx.egraph.merge(ctx.egraph.add(*x),
+                   ctx.egraph.add(*ConstantInt::Create(llvm::APInt(32, 3))));
+  AssertionList third = ctx.extract_assertions();
+  ASSERT_FALSE(contains(third, a1));
+  ASSERT_TRUE(contains(third, a2));
+}
+
+TEST_F(ContextTests, extract_assertions_after_fork) {
+  Context ctx{M->getFunction("func")};
+
+  auto a1 = ICmpOp::CreateICmp(ICmpOpcode::ULT, x, 5);
+  auto a2 = ICmpOp::CreateICmp(ICmpOpcode::UGT, y, 2);
+
+  ctx.add(Assertion(a1));
+  ctx.extract_assertions();
+
+  Context forked = ctx.fork_once();
+  forked.add(Assertion(a2));
+
+  AssertionList original = ctx.extract_assertions();
+  AssertionList modified = forked.extract_assertions();
+
+  ASSERT_EQ(original.size(), 1u);
+  ASSERT_EQ(modified.size(), 2u);
+  ASSERT_TRUE(contains(modified, a2));
+}
+
+TEST_F(ContextTests, collect_garbage_keeps_assertions) {
+  Context ctx{M->getFunction("func")};
+
+  auto a1 = ICmpOp::CreateICmp(ICmpOpcode::ULT, x, 5);
+  ctx.add(Assertion(a1));
+  ctx.egraph.add(*BinaryOp::CreateMul(x, y));
+  size_t before = ctx.egraph.size();
+
+  ASSERT_GT(ctx.collect_garbage(), 0u);
+  ASSERT_LT(ctx.egraph.size(), before);
+
+  AssertionList list = ctx.extract_assertions();
+  ASSERT_EQ(list.size(), 1u);
+  ASSERT_TRUE(contains(list, a1));
+
+  // The e-graph is far too small to be collected automatically.
+  ctx.egraph.add(*BinaryOp::CreateMul(x, y));
+  ASSERT_EQ(ctx.collect_garbage(2.0), 0u);
+}
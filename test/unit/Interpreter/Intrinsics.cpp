@@ -0,0 +1,229 @@
+#include "caffeine/Interpreter/CaffeineContext.h"
+#include "caffeine/Interpreter/Context.h"
+#include "caffeine/Interpreter/Executor.h"
+#include "caffeine/Interpreter/FailureLogger.h"
+#include "caffeine/Interpreter/Store.h"
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+// These tests run the memory intrinsics through the interpreter directly. The
+// end-to-end tests can't cover them since the test programs are built with
+// --caffeine-gen-builtins which lowers the intrinsics to regular loops.
+
+namespace {
+class RecordingFailureLogger : public FailureLogger {
+public:
+  std::vector<std::string>* messages;
+  std::mutex* mutex;
+
+  RecordingFailureLogger(std::vector<std::string>* messages, std::mutex* mutex)
+      : messages(messages), mutex(mutex) {}
+
+  void log_failure(const Model*, const Context&,
+                   const Failure& failure) override {
+    std::lock_guard lock{*mutex};
+    messages->emplace_back(failure.message);
+  }
+};
+} // namespace
+
+class IntrinsicsTests : public ::testing::Test {
+public:
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> M;
+
+  std::vector<std::string> failures;
+  std::mutex mutex;
+
+  void parse(const char* ir) {
+    std::string source = std::string(header) + ir + declarations;
+
+    llvm::SMDiagnostic error;
+    M = llvm::parseIR(llvm::MemoryBufferRef(source, "test"), error, context);
+
+    if (!M)
+      error.print("unittest", llvm::errs());
+    ASSERT_NE(M, nullptr);
+  }
+
+  void run(llvm::ArrayRef<OpRef> args = {}) {
+    ExecutorOptions options;
+    options.num_threads = 1;
+
+    CaffeineContext caffeine =
+        CaffeineContext::builder()
+            .with_store(std::make_unique<QueueingContextStore>(1))
+            .with_logger(
+                std::make_unique<RecordingFailureLogger>(&failures, &mutex))
+            .build();
+    Executor exec{&caffeine, options};
+
+    caffeine.store()->add_context(Context(M->getFunction("test"), args));
+    exec.run();
+  }
+
+private:
+  static constexpr const char* header = R"(
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+)";
+
+  static constexpr const char* declarations = R"(
+declare void @caffeine_assert(i1)
+declare void @caffeine_assume(i1)
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)
+declare void @llvm.memmove.p0i8.p0i8.i64(i8*, i8*, i64, i1)
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)
+)";
+};
+
+TEST_F(IntrinsicsTests, memmove_overlapping_forwards) {
+  parse(R"(
+define void @test() {
+  %buf = alloca i64
+  store i64 u0x0706050403020100, i64* %buf
+  %src = bitcast i64* %buf to i8*
+  %dst = getelementptr i8, i8* %src, i64 1
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 4, i1 false)
+  %val = load i64, i64* %buf
+  %cmp = icmp eq i64 %val, u0x0706050302010000
+  call void @caffeine_assert(i1 %cmp)
+  ret void
+}
+)");
+
+  run();
+  ASSERT_EQ(failures, std::vector<std::string>{});
+}
+
+TEST_F(IntrinsicsTests, memmove_overlapping_backwards) {
+  parse(R"(
+define void @test() {
+  %buf = alloca i64
+  store i64 u0x0706050403020100, i64* %buf
+  %dst = bitcast i64* %buf to i8*
+  %src = getelementptr i8, i8* %dst, i64 1
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 4, i1 false)
+  %val = load i64, i64* %buf
+  %cmp = icmp eq i64 %val, u0x0706050404030201
+  call void @caffeine_assert(i1 %cmp)
+  ret void
+}
+)");
+
+  run();
+  ASSERT_EQ(failures, std::vector<std::string>{});
+}
+
+TEST_F(IntrinsicsTests, memcpy_across_pages) {
+  parse(R"(
+define void @test() {
+  %src = alloca [1024 x i8]
+  %dst = alloca [1024 x i8]
+  %s = bitcast [1024 x i8]* %src to i8*
+  %d = bitcast [1024 x i8]* %dst to i8*
+
+  call void @llvm.memset.p0i8.i64(i8* %s, i8 7, i64 600, i1 false)
+  %s255 = getelementptr i8, i8* %s, i64 255
+  store i8 1, i8* %s255
+  %s256 = getelementptr i8, i8* %s, i64 256
+  store i8 2, i8* %s256
+
+  %d10 = getelementptr i8, i8* %d, i64 10
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %d10, i8* %s, i64 600, i1 false)
+
+  %d265 = getelementptr i8, i8* %d, i64 265
+  %v265 = load i8, i8* %d265
+  %c265 = icmp eq i8 %v265, 1
+  call void @caffeine_assert(i1 %c265)
+
+  %d266 = getelementptr i8, i8* %d, i64 266
+  %v266 = load i8, i8* %d266
+  %c266 = icmp eq i8 %v266, 2
+  call void @caffeine_assert(i1 %c266)
+
+  %d609 = getelementptr i8, i8* %d, i64 609
+  %v609 = load i8, i8* %d609
+  %c609 = icmp eq i8 %v609, 7
+  call void @caffeine_assert(i1 %c609)
+  ret void
+}
+)");
+
+  run();
+  ASSERT_EQ(failures, std::vector<std::string>{});
+}
+
+TEST_F(IntrinsicsTests, memmove_symbolic_length) {
+  parse(R"(
+define void @test(i64 %len) {
+  %inrange = icmp ule i64 %len, 3
+  call void @caffeine_assume(i1 %inrange)
+
+  %buf = alloca i64
+  store i64 u0x0706050403020100, i64* %buf
+  %src = bitcast i64* %buf to i8*
+  %dst = getelementptr i8, i8* %src, i64 1
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %len, i1 false)
+
+  ; Byte 3 is only overwritten (with byte 2) if the whole range was copied.
+  %b3 = getelementptr i8, i8* %src, i64 3
+  %val = load i8, i8* %b3
+  %full = icmp eq i64 %len, 3
+  %expected = select i1 %full, i8 2, i8 3
+  %cmp = icmp eq i8 %val, %expected
+  call void @caffeine_assert(i1 %cmp)
+  ret void
+}
+)");
+
+  run({Constant::Create(Type::int_ty(64), "len")});
+  ASSERT_EQ(failures, std::vector<std::string>{});
+}
+
+TEST_F(IntrinsicsTests, memset_read_only_destination) {
+  parse(R"(
+@data = constant [4 x i8] c"abcd"
+
+define void @test() {
+  %dst = getelementptr [4 x i8], [4 x i8]* @data, i64 0, i64 0
+  call void @llvm.memset.p0i8.i64(i8* %dst, i8 0, i64 4, i1 false)
+  ret void
+}
+)");
+
+  run();
+  ASSERT_EQ(failures, std::vector<std::string>{
+                          "tried to write to unwritable allocation"});
+}
+
+TEST_F(IntrinsicsTests, memcpy_read_only_destination) {
+  parse(R"(
+@data = constant [4 x i8] c"abcd"
+
+define void @test(i64 %len) {
+  %inrange = icmp ule i64 %len, 4
+  call void @caffeine_assume(i1 %inrange)
+
+  %buf = alloca i32
+  %src = bitcast i32* %buf to i8*
+  %dst = getelementptr [4 x i8], [4 x i8]* @data, i64 0, i64 0
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %len, i1 false)
+  ret void
+}
+)");
+
+  run({Constant::Create(Type::int_ty(64), "len")});
+  ASSERT_EQ(failures, std::vector<std::string>{
+                          "tried to write to unwritable allocation"});
+}
@@ -95,3 +95,207 @@ TEST_F(MemHeapTests, resolve_pointer_mixed) {
   ASSERT_EQ(res.size(), 1);
   ASSERT_EQ(res[0].alloc(), alloc1_id);
 }
+
+TEST_F(MemHeapTests, resolve_pointer_uses_value_range) {
+  MemHeapMgr heaps;
+  Context context{function.get()};
+
+  unsigned index_size = layout.getIndexSizeInBits(0);
+  auto align = MakeInt(16);
+  auto size = MakeInt(256);
+
+  llvm::SmallVector<AllocId, 4> allocs;
+  for (int i = 0; i < 4; ++i) {
+    allocs.push_back(heaps[0].allocate(size, align, MakeData(size),
+                                       AllocationKind::Malloc,
+                                       AllocationPermissions::ReadWrite,
+                                       context));
+  }
+
+  // The offset can only be within [0, 256) so the pointer can only point
+  // within the third allocation.
+  auto offset = UnaryOp::CreateZExt(Type::int_ty(index_size),
+                                    Constant::Create(Type::int_ty(8), "off"));
+  auto ptr =
+      Pointer(BinaryOp::CreateAdd(heaps[0][allocs[2]].address(), offset), 0);
+
+  // The index narrows things down without having to ask the solver.
+  auto candidates = heaps[0].candidates(ptr.value(heaps), MakeInt(1), context);
+  ASSERT_EQ(candidates.size(), 1);
+  ASSERT_EQ(candidates[0], allocs[2]);
+
+  ASSERT_EQ(context.check(solver, !heaps.check_valid(ptr, MakeInt(1), context)),
+            SolverResult::UNSAT);
+
+  auto res = heaps.resolve(solver, ptr, context);
+
+  ASSERT_EQ(res.size(), 1);
+  ASSERT_EQ(res[0].alloc(), allocs[2]);
+
+  heaps[0].deallocate(allocs[2]);
+
+  ASSERT_EQ(heaps.resolve(solver, ptr, context).size(), 0);
+}
+
+TEST_F(MemHeapTests, resolve_pointer_spanning_allocations) {
+  MemHeapMgr heaps;
+  Context context{function.get()};
+
+  unsigned index_size = layout.getIndexSizeInBits(0);
+  auto align = MakeInt(16);
+  auto size = MakeInt(128);
+
+  llvm::SmallVector<AllocId, 4> allocs;
+  for (int i = 0; i < 4; ++i) {
+    allocs.push_back(heaps[0].allocate(size, align, MakeData(size),
+                                       AllocationKind::Malloc,
+                                       AllocationPermissions::ReadWrite,
+                                       context));
+  }
+
+  // Allocations are placed close together so a range of 256 bytes starting at
+  // the second allocation covers both the second and third allocations.
+  auto offset = UnaryOp::CreateZExt(Type::int_ty(index_size),
+                                    Constant::Create(Type::int_ty(8), "off"));
+  auto ptr =
+      Pointer(BinaryOp::CreateAdd(heaps[0][allocs[1]].address(), offset), 0);
+
+  auto res = heaps.resolve(solver, ptr, context);
+
+  ASSERT_EQ(res.size(), 2);
+  ASSERT_EQ(res[0].alloc(), allocs[1]);
+  ASSERT_EQ(res[1].alloc(), allocs[2]);
+}
+
+TEST_F(MemHeapTests, symbolic_allocations_are_disjoint) {
+  MemHeapMgr heaps{false};
+  Context context{function.get()};
+
+  unsigned index_size = layout.getIndexSizeInBits(0);
+  auto align = MakeInt(16);
+  auto size1 = UnaryOp::CreateZExt(Type::int_ty(index_size),
+                                   Constant::Create(Type::int_ty(32), "size1"));
+  auto size2 = UnaryOp::CreateZExt(Type::int_ty(index_size),
+                                   Constant::Create(Type::int_ty(32), "size2"));
+
+  heaps[0].allocate(size1, align, MakeData(size1), AllocationKind::Malloc,
+                    AllocationPermissions::ReadWrite, context);
+  auto alloc2 =
+      heaps[0].allocate(size2, align, MakeData(size2), AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+
+  context.add(ICmpOp::CreateICmpNE(size1, MakeInt(0)));
+  context.add(ICmpOp::CreateICmpNE(size2, MakeInt(0)));
+
+  // Each allocation is within its own region so the start of the second
+  // allocation can never be within the first one.
+  auto ptr = Pointer(heaps[0][alloc2].address(), 0);
+  auto res = heaps.resolve(solver, ptr, context);
+
+  ASSERT_EQ(res.size(), 1);
+  ASSERT_EQ(res[0].alloc(), alloc2);
+}
+
+TEST_F(MemHeapTests, large_symbolic_allocations_are_not_limited) {
+  MemHeapMgr heaps{false};
+  Context context{function.get()};
+
+  unsigned index_size = layout.getIndexSizeInBits(0);
+  auto align = MakeInt(16);
+  auto size1 = Constant::Create(Type::int_ty(index_size), "size1");
+  auto size2 = MakeInt(16);
+
+  heaps[0].allocate(size1, align, MakeData(size1), AllocationKind::Malloc,
+                    AllocationPermissions::ReadWrite, context);
+  auto alloc2 =
+      heaps[0].allocate(size2, align, MakeData(size2), AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+
+  context.add(ICmpOp::CreateICmpNE(size1, MakeInt(0)));
+
+  // The size could be larger than a region so it must not be limited to one.
+  ASSERT_EQ(context.check(solver, ICmpOp::CreateICmpUGT(
+                                      size1, MakeInt(UINT64_C(1) << 48))),
+            SolverResult::SAT);
+
+  // It still can't overlap with the other allocation.
+  auto ptr = Pointer(heaps[0][alloc2].address(), 0);
+  auto res = heaps.resolve(solver, ptr, context);
+
+  ASSERT_EQ(res.size(), 1);
+  ASSERT_EQ(res[0].alloc(), alloc2);
+}
+
+TEST_F(MemHeapTests, deallocate_keeps_heap_concrete) {
+  MemHeapMgr heaps;
+  Context context{function.get()};
+
+  unsigned index_size = layout.getIndexSizeInBits(0);
+  auto align = MakeInt(16);
+  auto size = MakeInt(32);
+  auto symsize = Constant::Create(Type::int_ty(index_size), "size");
+
+  auto alloc1 =
+      heaps[0].allocate(size, align, MakeData(size), AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+  auto alloc2 =
+      heaps[0].allocate(symsize, align, MakeData(symsize),
+                        AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+  heaps[0].deallocate(alloc2);
+  heaps[0].deallocate(alloc1);
+
+  auto alloc3 =
+      heaps[0].allocate(size, align, MakeData(size), AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+
+  ASSERT_TRUE(llvm::isa<ConstantInt>(*heaps[0][alloc3].address()));
+}
+
+TEST_F(MemHeapTests, copied_heaps_are_independent) {
+  MemHeapMgr heaps;
+  Context context{function.get()};
+
+  auto align = MakeInt(16);
+  auto size = MakeInt(32);
+  auto offset = MakeInt(4);
+  auto value = ConstantInt::Create(llvm::APInt(8, 0x12));
+
+  auto alloc1 =
+      heaps[0].allocate(size, align, MakeData(size), AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+  auto alloc2 =
+      heaps[0].allocate(size, align, MakeData(size), AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+
+  MemHeapMgr copy = heaps;
+  copy[0][alloc1].write(offset, value, layout);
+  copy[0].deallocate(alloc2);
+
+  ASSERT_TRUE(heaps[0].check_live(alloc2));
+  ASSERT_FALSE(copy[0].check_live(alloc2));
+  ASSERT_EQ(*copy[0][alloc1].read(offset, Type::int_ty(8), layout), *value);
+  ASSERT_NE(*heaps[0][alloc1].read(offset, Type::int_ty(8), layout), *value);
+}
+
+TEST_F(MemHeapTests, symbolic_values_round_trip) {
+  MemHeapMgr heaps;
+  Context context{function.get()};
+
+  auto align = MakeInt(16);
+  auto size = MakeInt(32);
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto y = Constant::Create(Type::int_ty(8), "y");
+
+  auto alloc =
+      heaps[0].allocate(size, align, MakeData(size), AllocationKind::Malloc,
+                        AllocationPermissions::ReadWrite, context);
+  Allocation& allocation = heaps[0][alloc];
+
+  allocation.write(MakeInt(4), x, layout);
+  ASSERT_EQ(*allocation.read(MakeInt(4), Type::int_ty(32), layout), *x);
+
+  // Once one of the bytes is overwritten the value can't be passed through.
+  allocation.write(MakeInt(5), y, layout);
+  ASSERT_NE(*allocation.read(MakeInt(4), Type::int_ty(32), layout), *x);
+}
@@ -0,0 +1,185 @@
+#include "caffeine/Memory/PagedArray.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Memory/Allocation.h"
+#include <llvm/IR/DataLayout.h>
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+// LLVM data layout string for x64_64-pc-linux-gnu
+static const char* const X86_64_LINUX =
+    "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128";
+
+static OpRef MakeByte(uint8_t value) {
+  return ConstantInt::Create(llvm::APInt(8, value));
+}
+
+static OpRef MakeData(uint64_t size) {
+  return AllocOp::Create(ConstantInt::Create(llvm::APInt(64, size)),
+                         MakeByte(0xDD));
+}
+
+TEST(PagedArrayTests, concrete_bytes_stay_concrete) {
+  PagedArray array{MakeData(1024), 1024};
+
+  array.store(300, MakeByte(0x12));
+
+  ASSERT_EQ(array.load_concrete(300), 0x12);
+  ASSERT_EQ(array.load_concrete(301), 0xDD);
+  ASSERT_EQ(*array.load(300), *MakeByte(0x12));
+  ASSERT_EQ(*array.load(0), *MakeByte(0xDD));
+}
+
+TEST(PagedArrayTests, copies_do_not_share_writes) {
+  PagedArray array{MakeData(64), 64};
+  array.store(4, MakeByte(1));
+
+  PagedArray copy = array;
+  copy.store(4, MakeByte(2));
+  copy.store(5, MakeByte(3));
+
+  ASSERT_EQ(array.load_concrete(4), 1);
+  ASSERT_EQ(array.load_concrete(5), 0xDD);
+  ASSERT_EQ(copy.load_concrete(4), 2);
+  ASSERT_EQ(copy.load_concrete(5), 3);
+}
+
+TEST(PagedArrayTests, symbolic_bytes_are_kept) {
+  PagedArray array{MakeData(16), 16};
+  auto byte = Constant::Create(Type::int_ty(8), "byte");
+
+  array.store(3, byte);
+  ASSERT_EQ(array.load_concrete(3), std::nullopt);
+  ASSERT_EQ(array.load(3), byte);
+
+  array.store(3, MakeByte(7));
+  ASSERT_EQ(array.load_concrete(3), 7);
+}
+
+TEST(PagedArrayTests, materialize_matches_contents) {
+  PagedArray array{MakeData(2048), 2048};
+  auto byte = Constant::Create(Type::int_ty(8), "byte");
+  auto offset = [](uint64_t value) {
+    return ConstantInt::Create(llvm::APInt(64, value));
+  };
+
+  array.store(10, MakeByte(1));
+  array.store(1500, byte);
+
+  OpRef data = array.materialize();
+  ASSERT_EQ(*LoadOp::Create(data, offset(10)), *MakeByte(1));
+  ASSERT_EQ(*LoadOp::Create(data, offset(1500)), *byte);
+  ASSERT_EQ(*LoadOp::Create(data, offset(11)), *MakeByte(0xDD));
+
+  // Writes after materializing are reflected in the cached array.
+  array.store(11, MakeByte(2));
+  data = array.materialize();
+  ASSERT_EQ(*LoadOp::Create(data, offset(11)), *MakeByte(2));
+}
+
+TEST(PagedArrayTests, materialize_only_stores_written_bytes) {
+  auto base = ConstantArray::Create(
+      "array", ConstantInt::Create(llvm::APInt(64, 1 << 20)));
+  PagedArray array{base, 1 << 20};
+  auto byte = Constant::Create(Type::int_ty(8), "byte");
+
+  array.store(5000, byte);
+
+  OpRef data = array.materialize();
+  const auto* store = llvm::dyn_cast<StoreOp>(data.get());
+  ASSERT_NE(store, nullptr);
+  ASSERT_EQ(store->data(), base);
+  ASSERT_EQ(store->value(), byte);
+}
+
+TEST(PagedArrayTests, allocation_concrete_access_is_folded) {
+  auto layout = llvm::DataLayout(X86_64_LINUX);
+  auto size = ConstantInt::Create(llvm::APInt(64, 16));
+  auto offset = ConstantInt::Create(llvm::APInt(64, 4));
+  auto alloc = Allocation(ConstantInt::CreateZero(64), size, MakeData(16),
+                          AllocationKind::Alloca,
+                          AllocationPermissions::ReadWrite);
+
+  alloc.write(offset, ConstantInt::Create(llvm::APInt(32, 0x01020304)),
+              layout);
+
+  auto value = alloc.read(offset, Type::int_ty(32), layout);
+  ASSERT_EQ(*value, *ConstantInt::Create(llvm::APInt(32, 0x01020304)));
+
+  auto byte = alloc.read(offset, Type::int_ty(8), layout);
+  ASSERT_EQ(*byte, *MakeByte(0x04));
+}
+
+TEST(PagedArrayTests, copy_between_arrays) {
+  PagedArray src{MakeData(1024), 1024};
+  PagedArray dst{MakeData(1024), 1024};
+  auto byte = Constant::Create(Type::int_ty(8), "byte");
+
+  src.store(0, MakeByte(1));
+  src.store(300, byte);
+  src.store(600, MakeByte(2));
+
+  dst.copy(0, src, 0, 512);
+  dst.copy(700, src, 600, 2);
+
+  ASSERT_EQ(dst.load_concrete(0), 1);
+  ASSERT_EQ(dst.load(300), byte);
+  ASSERT_EQ(dst.load_concrete(600), 0xDD);
+  ASSERT_EQ(dst.load_concrete(700), 2);
+
+  // Writes to the copied pages must not affect the source.
+  dst.store(1, MakeByte(3));
+  ASSERT_EQ(src.load_concrete(1), 0xDD);
+}
+
+TEST(PagedArrayTests, overlapping_copy_behaves_like_memmove) {
+  PagedArray array{MakeData(16), 16};
+  for (uint64_t i = 0; i < 8; ++i)
+    array.store(i, MakeByte(i));
+
+  array.copy(2, array, 0, 8);
+
+  ASSERT_EQ(array.load_concrete(0), 0);
+  ASSERT_EQ(array.load_concrete(1), 1);
+  for (uint64_t i = 0; i < 8; ++i)
+    ASSERT_EQ(array.load_concrete(i + 2), i);
+}
+
+TEST(PagedArrayTests, fill_sets_range) {
+  PagedArray array{MakeData(1024), 1024};
+  auto byte = Constant::Create(Type::int_ty(8), "byte");
+
+  array.fill(10, 600, MakeByte(0));
+  array.fill(700, 4, byte);
+
+  ASSERT_EQ(array.load_concrete(9), 0xDD);
+  ASSERT_EQ(array.load_concrete(10), 0);
+  ASSERT_EQ(array.load_concrete(609), 0);
+  ASSERT_EQ(array.load_concrete(610), 0xDD);
+  ASSERT_EQ(array.load(703), byte);
+
+  OpRef data = array.materialize();
+  ASSERT_EQ(*LoadOp::Create(data, ConstantInt::Create(llvm::APInt(64, 300))),
+            *MakeByte(0));
+}
+
+TEST(PagedArrayTests, allocation_copy_with_symbolic_offset) {
+  auto layout = llvm::DataLayout(X86_64_LINUX);
+  auto size = ConstantInt::Create(llvm::APInt(64, 16));
+  auto offset = Constant::Create(Type::int_ty(64), "offset");
+  auto zero = ConstantInt::CreateZero(64);
+  auto src = Allocation(zero, size, MakeData(16), AllocationKind::Alloca,
+                        AllocationPermissions::ReadWrite);
+  auto dst = Allocation(zero, size, MakeData(16), AllocationKind::Alloca,
+                        AllocationPermissions::ReadWrite);
+
+  src.fill(zero, MakeByte(7), 4);
+  dst.copy(zero, src, offset, 2);
+
+  auto value = dst.read(zero, Type::int_ty(8), layout);
+  ASSERT_EQ(*value, *LoadOp::Create(src.data(), offset));
+  ASSERT_EQ(*dst.read(ConstantInt::Create(llvm::APInt(64, 2)),
+                      Type::int_ty(8), layout),
+            *MakeByte(0xDD));
+}
@@ -49,3 +49,26 @@ TEST_F(GraphAssertionListTests, canonicalize_decompose) {
 
   ASSERT_EQ(list.size(), 2);
 }
+
+TEST_F(GraphAssertionListTests, canonicalize_keeps_all_proven) {
+  list.insert(egraph.add(*Constant::Create(Type::int_ty(1), 0)));
+  list.insert(egraph.add(*Constant::Create(Type::int_ty(1), 1)));
+  list.mark_sat();
+
+  list.canonicalize(egraph);
+
+  ASSERT_EQ(list.proven().size(), 2);
+  ASSERT_TRUE(list.unproven().empty());
+}
+
+TEST_F(GraphAssertionListTests, restore_before_mark) {
+  size_t checkpoint = list.checkpoint();
+  list.insert(egraph.add(*Constant::Create(Type::int_ty(1), 0)));
+  list.mark_sat();
+  list.restore(checkpoint);
+
+  list.insert(egraph.add(*Constant::Create(Type::int_ty(1), 1)));
+
+  ASSERT_TRUE(list.proven().empty());
+  ASSERT_EQ(list.unproven().size(), 1);
+}
@@ -0,0 +1,84 @@
+#include "caffeine/Query/ConstraintSlicer.h"
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Solver/SlicingSolver.h"
+#include "caffeine/Solver/Z3Solver.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+class ConstraintSlicerTests : public ::testing::Test {
+public:
+  ConstraintSlicer slicer;
+
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+  OpRef y = Constant::Create(Type::int_ty(32), "y");
+  OpRef z = Constant::Create(Type::int_ty(32), "z");
+  OpRef w = Constant::Create(Type::int_ty(32), "w");
+};
+
+TEST_F(ConstraintSlicerTests, transitive_dependencies_are_included) {
+  Assertion xy = ICmpOp::CreateICmpULT(x, y);
+  Assertion yz = ICmpOp::CreateICmpULT(y, z);
+  Assertion w5 = ICmpOp::CreateICmpEQ(w, 5);
+
+  AssertionList assertions{xy, yz, w5};
+  assertions.mark_sat();
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(z, 3)));
+
+  auto list = slicer.slice(assertions, Assertion());
+
+  ASSERT_TRUE(list.contains(xy));
+  ASSERT_TRUE(list.contains(yz));
+  ASSERT_FALSE(list.contains(w5));
+}
+
+TEST_F(ConstraintSlicerTests, slice_is_incremental) {
+  Assertion xy = ICmpOp::CreateICmpULT(x, y);
+  Assertion w5 = ICmpOp::CreateICmpEQ(w, 5);
+  Assertion yw = ICmpOp::CreateICmpULT(y, w);
+
+  AssertionList assertions{xy, w5};
+  assertions.mark_sat();
+
+  auto list = slicer.slice(assertions, ICmpOp::CreateICmpEQ(x, 1));
+  ASSERT_FALSE(list.contains(w5));
+
+  // Joining the two components in the proven prefix pulls w5 in as well.
+  assertions.insert(yw);
+  assertions.mark_sat();
+
+  list = slicer.slice(assertions, ICmpOp::CreateICmpEQ(x, 1));
+  ASSERT_TRUE(list.contains(w5));
+}
+
+TEST_F(ConstraintSlicerTests, partition_splits_independent_sets) {
+  AssertionList assertions{ICmpOp::CreateICmpULT(x, y),
+                           ICmpOp::CreateICmpEQ(w, 5)};
+  assertions.mark_sat();
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(z, 3)));
+
+  auto components = slicer.partition(assertions, ICmpOp::CreateICmpEQ(y, z));
+
+  // The unproven assertion and extra join x, y, and z together.
+  ASSERT_EQ(components.size(), 2);
+  ASSERT_TRUE(components[0].unproven);
+  ASSERT_EQ(components[0].assertions.size(), 2);
+  ASSERT_FALSE(components[1].unproven);
+  ASSERT_EQ(components[1].assertions.size(), 1);
+}
+
+TEST_F(ConstraintSlicerTests, stitched_resolve) {
+  auto solver =
+      std::make_shared<SlicingSolver>(std::make_shared<Z3Solver>(), true);
+  EGraph egraph;
+
+  AssertionList assertions{ICmpOp::CreateICmpEQ(x, 7),
+                           ICmpOp::CreateICmpEQ(w, 5)};
+  auto result = solver->resolve(assertions, Assertion());
+
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_EQ(result.evaluate(*x, egraph).apint(), 7);
+  ASSERT_EQ(result.evaluate(*w, egraph).apint(), 5);
+}
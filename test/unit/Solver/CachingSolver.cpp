@@ -0,0 +1,61 @@
+#include "caffeine/Solver/CachingSolver.h"
+#include "Util/CountingSolver.h"
+#include "caffeine/IR/Operation.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+class CachingSolverTests : public ::testing::Test {
+public:
+  std::shared_ptr<CountingSolver> counter;
+  std::shared_ptr<Solver> solver;
+
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+  OpRef y = Constant::Create(Type::int_ty(32), "y");
+
+  void SetUp() override {
+    counter = std::make_shared<CountingSolver>();
+    solver = std::make_shared<CachingSolver>(counter);
+  }
+};
+
+TEST_F(CachingSolverTests, exact_match_is_cached) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(x, 10))};
+
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+  ASSERT_EQ(counter->calls, 1u);
+}
+
+TEST_F(CachingSolverTests, unsat_subset_answers_superset) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(x, 10)),
+                           Assertion(ICmpOp::CreateICmpUGT(x, 20))};
+  ASSERT_EQ(solver->check(assertions), SolverResult::UNSAT);
+
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(y, 5)));
+  ASSERT_EQ(solver->check(assertions), SolverResult::UNSAT);
+  ASSERT_EQ(counter->calls, 1u);
+}
+
+TEST_F(CachingSolverTests, model_is_reused) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(x, 7))};
+  ASSERT_EQ(solver->resolve(assertions), SolverResult::SAT);
+
+  // x = 7 satisfies both of these so the cached model answers the query.
+  AssertionList other{Assertion(ICmpOp::CreateICmpULT(x, 10)),
+                      Assertion(ICmpOp::CreateICmpSGT(x, 3))};
+  auto result = solver->resolve(other);
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_NE(result.model(), nullptr);
+  ASSERT_EQ(counter->calls, 1u);
+}
+
+TEST_F(CachingSolverTests, unsatisfied_model_falls_through) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(x, 7))};
+  ASSERT_EQ(solver->resolve(assertions), SolverResult::SAT);
+
+  AssertionList other{Assertion(ICmpOp::CreateICmpUGT(x, 10))};
+  ASSERT_EQ(solver->check(other), SolverResult::SAT);
+  ASSERT_EQ(counter->calls, 2u);
+}
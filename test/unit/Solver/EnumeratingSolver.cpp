@@ -0,0 +1,94 @@
+#include "caffeine/Solver/EnumeratingSolver.h"
+#include "Util/CountingSolver.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Solver/Z3Solver.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+class EnumeratingSolverTests : public ::testing::Test {
+public:
+  std::shared_ptr<CountingSolver> counter;
+  std::shared_ptr<Solver> solver;
+  EGraph egraph;
+
+  OpRef x = Constant::Create(Type::int_ty(8), "x");
+  OpRef y = Constant::Create(Type::int_ty(16), "y");
+
+  void SetUp() override {
+    EnumeratingSolverOptions options;
+    options.max_bitwidth = 16;
+
+    counter = std::make_shared<CountingSolver>();
+    solver = std::make_shared<EnumeratingSolver>(counter, options);
+  }
+};
+
+TEST_F(EnumeratingSolverTests, single_symbol_sat) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpUGT(x, 200)),
+                           Assertion(ICmpOp::CreateICmpULT(x, 202))};
+
+  auto result = solver->resolve(assertions);
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_EQ(result.evaluate(*x, egraph).apint(), 201);
+  ASSERT_EQ(counter->calls, 0u);
+}
+
+TEST_F(EnumeratingSolverTests, single_symbol_unsat) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(y, 10)),
+                           Assertion(ICmpOp::CreateICmpUGT(y, 20))};
+
+  ASSERT_EQ(solver->check(assertions), SolverResult::UNSAT);
+  ASSERT_EQ(counter->calls, 0u);
+}
+
+TEST_F(EnumeratingSolverTests, two_symbols_after_narrowing) {
+  auto y8 = UnaryOp::CreateTrunc(Type::int_ty(8), y);
+  AssertionList assertions{
+      Assertion(ICmpOp::CreateICmpULT(y, 16)),
+      Assertion(ICmpOp::CreateICmpEQ(BinaryOp::CreateAdd(x, y8), 21))};
+
+  auto result =
+      solver->resolve(assertions, Assertion(ICmpOp::CreateICmpULT(x, 8)));
+  ASSERT_EQ(result, SolverResult::SAT);
+
+  auto xv = result.evaluate(*x, egraph).apint();
+  auto yv = result.evaluate(*y, egraph).apint();
+  ASSERT_EQ(xv.getLimitedValue() + yv.getLimitedValue(), 21u);
+  ASSERT_EQ(counter->calls, 0u);
+}
+
+TEST_F(EnumeratingSolverTests, large_queries_fall_through) {
+  OpRef z = Constant::Create(Type::int_ty(32), "z");
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(z, 5))};
+
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+  ASSERT_EQ(counter->calls, 1u);
+}
+
+TEST_F(EnumeratingSolverTests, wide_symbols_fall_through_by_default) {
+  solver = std::make_shared<EnumeratingSolver>(counter);
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(y, 5))};
+
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+  ASSERT_EQ(counter->calls, 1u);
+}
+
+TEST(AssignmentModelTests, extract_outlives_solver) {
+  EGraph egraph;
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(x, 1234))};
+
+  std::shared_ptr<AssignmentModel> model;
+  {
+    std::shared_ptr<Solver> solver = std::make_shared<Z3Solver>();
+    auto result = solver->resolve(assertions);
+    ASSERT_EQ(result, SolverResult::SAT);
+    model = AssignmentModel::extract(*result.model(), assertions, Assertion(),
+                                     egraph);
+  }
+
+  ASSERT_NE(model, nullptr);
+  ASSERT_EQ(model->evaluate(*x, egraph).apint(), 1234);
+}
@@ -0,0 +1,89 @@
+#include "caffeine/Solver/PersistentCachingSolver.h"
+#include "Util/CountingSolver.h"
+#include "caffeine/IR/Operation.h"
+
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+namespace fs = boost::filesystem;
+
+class PersistentCachingSolverTests : public ::testing::Test {
+public:
+  fs::path path;
+  EGraph egraph;
+
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+  OpRef y = Constant::Create(Type::int_ty(64), "y");
+
+  void SetUp() override {
+    path = fs::temp_directory_path() / fs::unique_path("caffeine-%%%%-%%%%.qc");
+  }
+  void TearDown() override {
+    fs::remove(path);
+  }
+
+  // Simulate a fresh run of caffeine using the same cache file.
+  std::pair<std::shared_ptr<CountingSolver>, std::shared_ptr<Solver>> open() {
+    auto store = std::make_shared<PersistentQueryStore>(path.string());
+    auto counter = std::make_shared<CountingSolver>();
+    return {counter, std::make_shared<PersistentCachingSolver>(counter, store)};
+  }
+};
+
+TEST_F(PersistentCachingSolverTests, results_persist_across_runs) {
+  AssertionList sat{Assertion(ICmpOp::CreateICmpEQ(x, 1234)),
+                    Assertion(ICmpOp::CreateICmpUGT(y, 5))};
+  AssertionList unsat{Assertion(ICmpOp::CreateICmpULT(x, 10)),
+                      Assertion(ICmpOp::CreateICmpUGT(x, 20))};
+
+  {
+    auto [counter, solver] = open();
+    ASSERT_EQ(solver->resolve(sat), SolverResult::SAT);
+    ASSERT_EQ(solver->check(unsat), SolverResult::UNSAT);
+    ASSERT_EQ(counter->calls, 2u);
+  }
+
+  auto [counter, solver] = open();
+  auto result = solver->resolve(sat);
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_EQ(result.evaluate(*x, egraph).apint(), 1234);
+  ASSERT_TRUE(result.evaluate(*y, egraph).apint().ugt(5));
+  ASSERT_EQ(solver->check(unsat), SolverResult::UNSAT);
+  ASSERT_EQ(counter->calls, 0u);
+}
+
+TEST_F(PersistentCachingSolverTests, torn_tail_is_dropped) {
+  AssertionList first{Assertion(ICmpOp::CreateICmpEQ(x, 1))};
+  AssertionList second{Assertion(ICmpOp::CreateICmpEQ(x, 2))};
+
+  {
+    auto [counter, solver] = open();
+    ASSERT_EQ(solver->resolve(first), SolverResult::SAT);
+  }
+
+  // Pretend that a previous run was killed part-way through a write.
+  std::FILE* file = std::fopen(path.c_str(), "ab");
+  ASSERT_NE(file, nullptr);
+  std::fputs("garbage", file);
+  std::fclose(file);
+
+  {
+    auto [counter, solver] = open();
+    ASSERT_EQ(solver->resolve(first), SolverResult::SAT);
+    ASSERT_EQ(solver->resolve(second), SolverResult::SAT);
+    ASSERT_EQ(counter->calls, 1u);
+  }
+
+  auto [counter, solver] = open();
+  ASSERT_EQ(solver->resolve(first), SolverResult::SAT);
+  ASSERT_EQ(solver->resolve(second), SolverResult::SAT);
+  ASSERT_EQ(counter->calls, 0u);
+}
+
+TEST_F(PersistentCachingSolverTests, missing_directory_fails_to_open) {
+  PersistentQueryStore store{(path / "cache.qc").string()};
+  ASSERT_FALSE(store.is_open());
+}
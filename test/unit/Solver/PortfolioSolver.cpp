@@ -0,0 +1,94 @@
+#include "caffeine/Solver/PortfolioSolver.h"
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/IR/Operation.h"
+
+#include <gtest/gtest.h>
+
+using namespace caffeine;
+
+namespace {
+class UnknownSolver : public Solver {
+public:
+  SolverResult check(AssertionList&, const Assertion&) override {
+    return SolverResult::Unknown;
+  }
+  SolverResult resolve(AssertionList&, const Assertion&) override {
+    return SolverResult::Unknown;
+  }
+  void interrupt() override {}
+};
+} // namespace
+
+class PortfolioSolverTests : public ::testing::Test {
+public:
+  std::shared_ptr<Solver> solver;
+
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+
+  void SetUp() override {
+    Z3SolverOptions incremental;
+    incremental.incremental = true;
+    Z3SolverOptions qfbv;
+    qfbv.tactic = "qfbv";
+
+    solver = std::make_shared<PortfolioSolver>(
+        std::vector<Z3SolverOptions>{Z3SolverOptions(), incremental, qfbv});
+  }
+};
+
+TEST_F(PortfolioSolverTests, sat_query) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(x, 7))};
+
+  auto result = solver->resolve(assertions);
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_NE(result.model(), nullptr);
+}
+
+TEST_F(PortfolioSolverTests, unsat_query) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(x, 10)),
+                           Assertion(ICmpOp::CreateICmpUGT(x, 20))};
+
+  ASSERT_EQ(solver->check(assertions), SolverResult::UNSAT);
+  // Repeated queries work after the losing members have been stopped.
+  ASSERT_EQ(solver->check(assertions), SolverResult::UNSAT);
+}
+
+TEST_F(PortfolioSolverTests, unknown_members_are_skipped) {
+  PortfolioSolver portfolio(std::vector<PortfolioSolver::Factory>{
+      [] { return std::make_shared<UnknownSolver>(); },
+      [] { return std::make_shared<Z3Solver>(); }});
+
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(x, 7))};
+  ASSERT_EQ(portfolio.check(assertions, Assertion()), SolverResult::SAT);
+}
+
+TEST_F(PortfolioSolverTests, model_outlives_portfolio) {
+  EGraph egraph;
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(x, 7))};
+
+  auto result = solver->resolve(assertions);
+  solver.reset();
+
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_EQ(result.evaluate(*x, egraph).apint(), 7);
+}
+
+TEST_F(PortfolioSolverTests, members_are_reused) {
+  size_t built = 0;
+  auto factory = [&]() -> std::shared_ptr<Solver> {
+    built += 1;
+    return std::make_shared<Z3Solver>();
+  };
+  PortfolioSolver portfolio(
+      std::vector<PortfolioSolver::Factory>{factory, factory});
+
+  AssertionList sat{Assertion(ICmpOp::CreateICmpEQ(x, 7))};
+  AssertionList unsat{Assertion(ICmpOp::CreateICmpULT(x, 10)),
+                      Assertion(ICmpOp::CreateICmpUGT(x, 20))};
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(portfolio.check(sat, Assertion()), SolverResult::SAT);
+    ASSERT_EQ(portfolio.check(unsat, Assertion()), SolverResult::UNSAT);
+  }
+
+  ASSERT_EQ(built, 2u);
+}
@@ -0,0 +1,90 @@
+#include "caffeine/Solver/ProfilingSolver.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/Solver/CachingSolver.h"
+#include "caffeine/Solver/Z3Solver.h"
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace caffeine;
+
+class ProfilingSolverTests : public ::testing::Test {
+public:
+  std::shared_ptr<QueryProfile> profile;
+  std::shared_ptr<Solver> solver;
+
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+  OpRef y = Constant::Create(Type::int_ty(32), "y");
+
+  void SetUp() override {
+    profile = std::make_shared<QueryProfile>(2);
+    solver = std::make_shared<ProfilingSolver>(std::make_shared<Z3Solver>(),
+                                               profile);
+  }
+};
+
+TEST_F(ProfilingSolverTests, queries_are_reported) {
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(x, 10)),
+                           Assertion(ICmpOp::CreateICmpULT(y, 10))};
+  assertions.mark_sat();
+
+  ASSERT_EQ(solver->check(assertions, Assertion(ICmpOp::CreateICmpEQ(x, 5))),
+            SolverResult::SAT);
+  ASSERT_EQ(solver->check(assertions, Assertion(ICmpOp::CreateICmpEQ(x, 50))),
+            SolverResult::UNSAT);
+  ASSERT_EQ(solver->resolve(assertions), SolverResult::SAT);
+
+  std::stringstream ss;
+  profile->report(ss);
+  std::string report = ss.str();
+
+  // All the queries were made outside of the interpreter.
+  EXPECT_NE(report.find("<unknown>"), std::string::npos);
+  EXPECT_NE(report.find("queries: 3"), std::string::npos);
+  EXPECT_NE(report.find("sat/unsat/unknown: 2/1/0"), std::string::npos);
+  // The proven y < 10 assertion is independent of extra.
+  EXPECT_NE(report.find("assertions: 3 (sliced: 2)"), std::string::npos);
+  EXPECT_NE(report.find("Top 2 most expensive queries"), std::string::npos);
+}
+
+TEST_F(ProfilingSolverTests, queries_are_logged) {
+  std::stringstream ss;
+  auto log = std::make_shared<QueryLog>(ss);
+  solver =
+      std::make_shared<QueryLoggingSolver>(std::make_shared<Z3Solver>(), log);
+
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(x, 10))};
+  ASSERT_EQ(solver->check(assertions, Assertion(ICmpOp::CreateICmpEQ(x, 5))),
+            SolverResult::SAT);
+
+  std::string line;
+  ASSERT_TRUE(std::getline(ss, line));
+
+  auto entry = QueryLog::parse(line);
+  ASSERT_TRUE(entry) << line;
+  // x and the constants 10 and 5 are distinct nodes of width 32.
+  EXPECT_EQ(entry->usage[Operation::ConstantNamed].count, 1u);
+  EXPECT_EQ(entry->usage[Operation::ConstantInt].count, 2u);
+  EXPECT_EQ(entry->usage[Operation::ConstantInt].bits, 64u);
+  EXPECT_EQ(entry->usage[Operation::ICmpUlt].count, 1u);
+  EXPECT_EQ(entry->usage[Operation::ICmpUlt].bits, 32u);
+  EXPECT_EQ(entry->usage[Operation::ICmpEq].count, 1u);
+
+  EXPECT_FALSE(QueryLog::parse("12 Add:1"));
+  EXPECT_FALSE(QueryLog::parse("12 Frobnicate:1:1"));
+}
+
+TEST_F(ProfilingSolverTests, cache_hits_are_not_logged) {
+  std::stringstream ss;
+  auto log = std::make_shared<QueryLog>(ss);
+  solver = std::make_shared<CachingSolver>(
+      std::make_shared<QueryLoggingSolver>(std::make_shared<Z3Solver>(), log));
+
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(x, 10))};
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+
+  std::string line;
+  ASSERT_TRUE(std::getline(ss, line));
+  ASSERT_FALSE(std::getline(ss, line));
+}
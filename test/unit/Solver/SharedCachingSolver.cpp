@@ -0,0 +1,82 @@
+#include "caffeine/Solver/SharedCachingSolver.h"
+#include "Util/CountingSolver.h"
+#include "caffeine/IR/Operation.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace caffeine;
+
+class SharedCachingSolverTests : public ::testing::Test {
+public:
+  std::shared_ptr<SharedQueryCache> cache;
+  EGraph egraph;
+
+  OpRef x = Constant::Create(Type::int_ty(32), "x");
+  OpRef y = Constant::Create(Type::int_ty(32), "y");
+
+  void SetUp() override {
+    cache = std::make_shared<SharedQueryCache>();
+  }
+};
+
+TEST_F(SharedCachingSolverTests, results_are_shared_between_solvers) {
+  auto counter1 = std::make_shared<CountingSolver>();
+  auto counter2 = std::make_shared<CountingSolver>();
+  std::shared_ptr<Solver> solver1 =
+      std::make_shared<SharedCachingSolver>(counter1, cache);
+  std::shared_ptr<Solver> solver2 =
+      std::make_shared<SharedCachingSolver>(counter2, cache);
+
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpEQ(x, 77))};
+  ASSERT_EQ(solver1->resolve(assertions), SolverResult::SAT);
+
+  // The model is computed on another thread to check that it doesn't depend
+  // on the solver that produced it.
+  std::thread thread([&] {
+    auto result = solver2->resolve(assertions);
+    ASSERT_EQ(result, SolverResult::SAT);
+    ASSERT_EQ(result.evaluate(*x, egraph).apint(), 77);
+  });
+  thread.join();
+
+  ASSERT_EQ(counter1->calls, 1u);
+  ASSERT_EQ(counter2->calls, 0u);
+}
+
+TEST_F(SharedCachingSolverTests, unsat_is_cached) {
+  auto counter = std::make_shared<CountingSolver>();
+  std::shared_ptr<Solver> solver =
+      std::make_shared<SharedCachingSolver>(counter, cache);
+
+  AssertionList assertions{Assertion(ICmpOp::CreateICmpULT(x, 10)),
+                           Assertion(ICmpOp::CreateICmpUGT(x, 20))};
+  ASSERT_EQ(solver->check(assertions), SolverResult::UNSAT);
+  ASSERT_EQ(solver->resolve(assertions), SolverResult::UNSAT);
+  ASSERT_EQ(counter->calls, 1u);
+}
+
+TEST_F(SharedCachingSolverTests, least_recently_used_is_evicted) {
+  SharedQueryCacheOptions options;
+  options.shards = 1;
+  options.max_entries = 2;
+  SharedQueryCache small(options);
+
+  auto key = [](const OpRef& op) {
+    return SharedQueryCache::Key{Assertion(op)};
+  };
+  auto a = key(ICmpOp::CreateICmpEQ(x, 1));
+  auto b = key(ICmpOp::CreateICmpEQ(x, 2));
+  auto c = key(ICmpOp::CreateICmpEQ(x, 3));
+
+  small.insert(SharedQueryCache::Key(a), {SolverResult::UNSAT, nullptr});
+  small.insert(SharedQueryCache::Key(b), {SolverResult::UNSAT, nullptr});
+  // Touch a so that b becomes the least recently used entry.
+  ASSERT_TRUE(small.lookup(a).has_value());
+  small.insert(SharedQueryCache::Key(c), {SolverResult::UNSAT, nullptr});
+
+  ASSERT_EQ(small.size(), 2u);
+  ASSERT_TRUE(small.lookup(a).has_value());
+  ASSERT_FALSE(small.lookup(b).has_value());
+  ASSERT_TRUE(small.lookup(c).has_value());
+}
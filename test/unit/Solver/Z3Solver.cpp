@@ -1,5 +1,6 @@
 
 #include "src/Solver/Z3Solver.h"
+#include "caffeine/IR/EGraph.h"
 #include "caffeine/IR/Operation.h"
 #include "caffeine/Solver/Z3/Convert.h"
 #include "caffeine/Support/LLVMFmt.h"
@@ -87,3 +88,128 @@ TEST_F(Z3ConversionTests, apfloat_f32_to_z3_roundtrip) {
 
   ASSERT_TRUE(flt == res) << fmt::format("{} != {}", flt, res);
 }
+
+class IncrementalZ3SolverTests : public ::testing::Test {
+public:
+  std::shared_ptr<Solver> solver;
+
+  void SetUp() override {
+    Z3SolverOptions options;
+    options.incremental = true;
+    solver = std::make_shared<Z3Solver>(options);
+  }
+};
+
+TEST_F(IncrementalZ3SolverTests, tail_is_rolled_back) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpULT(x, 10)));
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+  assertions.mark_sat();
+
+  size_t checkpoint = assertions.checkpoint();
+  assertions.insert(Assertion(ICmpOp::CreateICmpUGT(x, 20)));
+  ASSERT_EQ(solver->check(assertions), SolverResult::UNSAT);
+  assertions.restore(checkpoint);
+
+  assertions.insert(Assertion(ICmpOp::CreateICmpUGT(x, 5)));
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+}
+
+TEST_F(IncrementalZ3SolverTests, extra_does_not_persist) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpULT(x, 10)));
+
+  ASSERT_EQ(solver->check(assertions, Assertion(ICmpOp::CreateICmpEQ(x, 20))),
+            SolverResult::UNSAT);
+  ASSERT_EQ(solver->check(assertions, Assertion(ICmpOp::CreateICmpEQ(x, 5))),
+            SolverResult::SAT);
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+}
+
+TEST_F(IncrementalZ3SolverTests, fixed_array_survives_pop) {
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto array = FixedArray::Create(
+      Type::int_ty(32),
+      {ConstantInt::Create(llvm::APInt(8, 1)),
+       ConstantInt::Create(llvm::APInt(8, 2))});
+  auto load = LoadOp::Create(array, x);
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpULT(x, 2)));
+  assertions.mark_sat();
+
+  size_t checkpoint = assertions.checkpoint();
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(load, 2)));
+  ASSERT_EQ(solver->check(assertions), SolverResult::SAT);
+  assertions.restore(checkpoint);
+
+  assertions.insert(Assertion(ICmpOp::CreateICmpNE(x, 1)));
+  ASSERT_EQ(solver->check(assertions, Assertion(ICmpOp::CreateICmpEQ(load, 2))),
+            SolverResult::UNSAT);
+}
+
+TEST_F(IncrementalZ3SolverTests, model_covers_current_query) {
+  EGraph egraph;
+  auto x = Constant::Create(Type::int_ty(32), "x");
+  auto y = Constant::Create(Type::int_ty(32), "y");
+
+  AssertionList first{Assertion(ICmpOp::CreateICmpEQ(x, 1))};
+  ASSERT_EQ(solver->resolve(first), SolverResult::SAT);
+
+  AssertionList second{Assertion(ICmpOp::CreateICmpEQ(y, 7))};
+  auto result = solver->resolve(second, Assertion(ICmpOp::CreateICmpEQ(x, 3)));
+  ASSERT_EQ(result, SolverResult::SAT);
+  ASSERT_EQ(result.evaluate(*x, egraph).apint(), 3);
+  ASSERT_EQ(result.evaluate(*y, egraph).apint(), 7);
+}
+
+TEST(Z3ModelTests, large_array_is_read_from_interpretation) {
+  EGraph egraph;
+  Z3Solver solver;
+
+  size_t size = 1 << 16;
+  auto array = ConstantArray::Create(
+      Symbol("buffer"), ConstantInt::Create(llvm::APInt(32, size)));
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(
+      LoadOp::Create(array, ConstantInt::Create(llvm::APInt(32, 7))), 0xAB)));
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(
+      LoadOp::Create(array, ConstantInt::Create(llvm::APInt(32, size - 1))),
+      0xCD)));
+
+  auto result = solver.resolve(assertions, Assertion());
+  ASSERT_EQ(result, SolverResult::SAT);
+
+  const Value value = result.evaluate(*array, egraph);
+  ASSERT_EQ(value.array().size(), size);
+  ASSERT_EQ((uint8_t)value.array()[7], 0xAB);
+  ASSERT_EQ((uint8_t)value.array()[size - 1], 0xCD);
+}
+
+TEST(Z3ModelTests, multi_byte_load_uses_byte_order) {
+  EGraph egraph;
+  Z3Solver solver;
+
+  auto array = ConstantArray::Create(Symbol("buffer"),
+                                     ConstantInt::Create(llvm::APInt(32, 16)));
+  auto offset = ConstantInt::Create(llvm::APInt(32, 4));
+  auto little = MultiLoadOp::Create(Type::int_ty(32), array, offset, true);
+  auto big = MultiLoadOp::Create(Type::int_ty(32), array, offset, false);
+
+  AssertionList assertions;
+  assertions.insert(Assertion(ICmpOp::CreateICmpEQ(little, 0x11223344)));
+
+  auto result = solver.resolve(assertions, Assertion());
+  ASSERT_EQ(result, SolverResult::SAT);
+
+  const Value value = result.evaluate(*array, egraph);
+  ASSERT_EQ((uint8_t)value.array()[4], 0x44);
+  ASSERT_EQ((uint8_t)value.array()[7], 0x11);
+
+  ASSERT_EQ(result.evaluate(*big, egraph).apint(), 0x44332211);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "caffeine/Solver/Solver.h"
+#include "caffeine/Solver/Z3Solver.h"
+#include <memory>
+
+namespace caffeine {
+
+/**
+ * Solver which forwards every query to a Z3Solver and counts how many queries
+ * made it through. Used to check whether a solver layer answered a query
+ * itself.
+ */
+class CountingSolver : public Solver {
+public:
+  std::shared_ptr<Solver> inner = std::make_shared<Z3Solver>();
+  size_t calls = 0;
+
+  SolverResult check(AssertionList& assertions,
+                     const Assertion& extra) override {
+    calls += 1;
+    return inner->check(assertions, extra);
+  }
+  SolverResult resolve(AssertionList& assertions,
+                       const Assertion& extra) override {
+    calls += 1;
+    return inner->resolve(assertions, extra);
+  }
+  void interrupt() override {
+    inner->interrupt();
+  }
+};
+
+} // namespace caffeine
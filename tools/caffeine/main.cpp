@@ -1,4 +1,5 @@
 
+#include "caffeine/IR/EGraphCost.h"
 #include "caffeine/Interpreter/CaffeineContext.h"
 #include "caffeine/Interpreter/Context.h"
 #include "caffeine/Interpreter/DiskFailureLogger.h"
@@ -10,7 +11,11 @@
 #include "caffeine/Interpreter/ThreadQueueStore.h"
 #include "caffeine/Solver/InterruptSolver.h"
 #include "caffeine/Solver/LoggingSolver.h"
+#include "caffeine/Solver/PersistentCachingSolver.h"
+#include "caffeine/Solver/PortfolioSolver.h"
+#include "caffeine/Solver/ProfilingSolver.h"
 #include "caffeine/Solver/Solver.h"
+#include "caffeine/Solver/Z3Solver.h"
 #include "caffeine/Support/Coverage.h"
 #include "caffeine/Support/DiagnosticHandler.h"
 #include "caffeine/Support/Signal.h"
@@ -20,6 +25,7 @@
 #include <csignal>
 #include <cstdlib>
 #include <exception>
+#include <fstream>
 #include <iostream>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/PassManager.h>
@@ -112,6 +118,38 @@ cl::opt<uint64_t> limit_time_seconds{
     cl::desc("Instructs caffeine to stop symbolic execution after the given "
              "number of seconds have elapsed."),
     cl::value_desc("seconds"), cl::cat(caffeine_options), cl::init(0)};
+cl::list<std::string> portfolio{
+    "portfolio", cl::CommaSeparated,
+    cl::desc("Race several solver configurations against each other for "
+             "every query. Each entry is either 'incremental' or the name of "
+             "a z3 tactic (e.g. default, qfbv, qfabv, smt)."),
+    cl::value_desc("configs"), cl::cat(caffeine_options)};
+cl::opt<std::string> query_cache{
+    "query-cache",
+    cl::desc("Persist solver results to the given file and reuse them in "
+             "later runs."),
+    cl::value_desc("filename"), cl::cat(caffeine_options)};
+cl::opt<bool> profile_queries{
+    "profile-queries",
+    cl::desc("Measure every solver query and print a report of the most "
+             "expensive instructions and queries on exit."),
+    cl::cat(caffeine_options)};
+cl::opt<size_t> profile_top{
+    "profile-top",
+    cl::desc("The number of individual queries to list in the query profile."),
+    cl::cat(caffeine_options), cl::init(20)};
+cl::opt<std::string> query_log{
+    "query-log",
+    cl::desc("Write the duration and operations of every query that reaches "
+             "the underlying solver to the given file. This is the input for "
+             "cost-calibrate."),
+    cl::value_desc("filename"), cl::cat(caffeine_options)};
+cl::opt<std::string> extraction_costs{
+    "extraction-costs",
+    cl::desc("Load the per-opcode weights used to pick which expressions to "
+             "send to the solver from the given file (e.g. as written by "
+             "cost-calibrate)."),
+    cl::value_desc("filename"), cl::cat(caffeine_options)};
 cl::opt<std::string> test_output_dir{
     "test-output-dir", cl::desc("The directory to output test case files to."),
     cl::cat(caffeine_options)};
@@ -200,10 +238,80 @@ int main(int argc, char** argv) {
       std::make_shared<std::atomic_bool>(false);
 
   auto solver_builder = SolverBuilder::with_default();
+  if (!portfolio.empty()) {
+    std::vector<Z3SolverOptions> configs;
+    for (const std::string& name : portfolio) {
+      Z3SolverOptions options;
+      if (name == "incremental")
+        options.incremental = true;
+      else
+        options.tactic = name;
+      configs.push_back(options);
+    }
+
+    solver_builder = SolverBuilder::with_default(
+        [=] { return std::make_shared<PortfolioSolver>(configs); });
+  }
+  if (!query_cache.empty()) {
+    auto store = std::make_shared<PersistentQueryStore>(query_cache);
+    if (!store->is_open()) {
+      WithColor::error() << "unable to open query cache '" << query_cache
+                         << "'\n";
+      return 2;
+    }
+
+    solver_builder.with<PersistentCachingSolver>(store);
+  }
+
   if (log_queries)
     solver_builder.with<LoggingSolver>();
   solver_builder.with<InterruptSolver>(should_stop);
 
+  std::shared_ptr<QueryProfile> profile;
+  std::ofstream query_log_file;
+  if (!query_log.empty()) {
+    query_log_file.open(query_log);
+    if (!query_log_file) {
+      WithColor::error() << "unable to open query log '" << query_log
+                         << "'\n";
+      return 2;
+    }
+
+    // This ends up directly above the base solver so only the queries that
+    // actually make it there get logged.
+    auto query_logger = std::make_shared<QueryLog>(query_log_file);
+    solver_builder.with<QueryLoggingSolver>(query_logger);
+  }
+  if (profile_queries) {
+    profile = std::make_shared<QueryProfile>(profile_top);
+
+    // Layers added through with() end up below the ones that are already in
+    // the builder. The profiler needs to sit above all of them so that it
+    // sees each query once, before it has been sliced or cached.
+    SolverBuilder inner = std::move(solver_builder);
+    solver_builder = SolverBuilder([=] { return inner.build(); });
+    solver_builder.with<ProfilingSolver>(profile);
+  }
+
+  std::shared_ptr<const ExtractionCostModel> cost_model;
+  if (!extraction_costs.empty()) {
+    std::ifstream file(extraction_costs);
+    if (!file) {
+      WithColor::error() << "unable to open extraction costs '"
+                         << extraction_costs << "'\n";
+      return 2;
+    }
+
+    std::string error;
+    auto model = WeightedCostModel::load(file, error);
+    if (!model) {
+      WithColor::error() << extraction_costs << ": " << error << '\n';
+      return 2;
+    }
+
+    cost_model = std::make_shared<WeightedCostModel>(std::move(*model));
+  }
+
   auto counter = std::make_unique<CountingFailureLogger>();
   auto logger = counter.get();
 
@@ -235,6 +343,8 @@ int main(int argc, char** argv) {
 
   auto context = Context(function);
   context.heaps.set_concrete(!force_symbolic_allocator);
+  if (cost_model)
+    context.egraph.set_cost_model(cost_model);
   caffeine.store()->add_context(std::move(context));
 
   llvm::sys::SetInterruptFunction(&caffeine::signals::stop_context);
@@ -247,6 +357,9 @@ int main(int argc, char** argv) {
     caffeine.coverage()->report().print(std::cout);
   }
 
+  if (profile_queries)
+    profile->report(std::cout);
+
   if (invert_exitcode)
     exitcode = !exitcode;
 
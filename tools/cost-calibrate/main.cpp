@@ -0,0 +1,243 @@
+// Fit the weights of a WeightedCostModel to measured solver query times.
+//
+// This reads one or more query logs written by caffeine --query-log. Each
+// query is modelled as taking
+//
+//   overhead + sum over opcodes of (base * count + per_bit * bits)
+//
+// time and the weights are fitted by non-negative least squares. The fitted
+// weights are then scaled so that the average node costs 1 and written out in
+// the format read by caffeine --extraction-costs. Opcodes that appear in too
+// few queries to be fitted reliably keep their default weights.
+
+#include "caffeine/IR/EGraphCost.h"
+#include "caffeine/Solver/ProfilingSolver.h"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/WithColor.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace caffeine;
+
+namespace cl = llvm::cl;
+
+static cl::list<std::string> inputs(cl::Positional, cl::OneOrMore,
+                                    cl::desc("<query log>..."));
+static cl::opt<std::string> output("o", cl::desc("Output weights file"),
+                                   cl::value_desc("filename"), cl::init("-"));
+static cl::opt<unsigned> min_queries(
+    "min-queries",
+    cl::desc("Minimum number of queries an opcode must appear in to have its "
+             "weights fitted"),
+    cl::init(10));
+static cl::opt<unsigned> iterations("iterations",
+                                    cl::desc("Number of solver iterations"),
+                                    cl::init(1000));
+
+namespace {
+  using Opcode = Operation::Opcode;
+
+  // A dense least-squares problem min |Xw - y|^2 subject to w >= 0, stored as
+  // its normal equations.
+  class NNLS {
+  public:
+    explicit NNLS(size_t dims)
+        : dims(dims), gram(dims * dims, 0.0), rhs(dims, 0.0) {}
+
+    void add(const std::vector<double>& row, double target) {
+      for (size_t i = 0; i < dims; ++i) {
+        if (row[i] == 0.0)
+          continue;
+
+        rhs[i] += row[i] * target;
+        for (size_t j = 0; j < dims; ++j)
+          gram[i * dims + j] += row[i] * row[j];
+      }
+    }
+
+    // Projected coordinate descent. Each step exactly minimizes the objective
+    // along one coordinate and then clamps it to be non-negative.
+    std::vector<double> solve(unsigned iterations) const {
+      std::vector<double> w(dims, 0.0);
+
+      for (unsigned iter = 0; iter < iterations; ++iter) {
+        double delta = 0.0;
+
+        for (size_t i = 0; i < dims; ++i) {
+          double diag = gram[i * dims + i];
+          if (diag <= 0.0)
+            continue;
+
+          double grad = -rhs[i];
+          for (size_t j = 0; j < dims; ++j)
+            grad += gram[i * dims + j] * w[j];
+
+          double next = std::max(0.0, w[i] - grad / diag);
+          delta = std::max(delta, std::abs(next - w[i]));
+          w[i] = next;
+        }
+
+        if (delta < 1e-12)
+          break;
+      }
+
+      return w;
+    }
+
+  private:
+    size_t dims;
+    std::vector<double> gram;
+    std::vector<double> rhs;
+  };
+
+  bool read_log(const std::string& path, std::vector<QueryLog::Entry>& out) {
+    std::ifstream file(path);
+    if (!file) {
+      llvm::WithColor::error() << "unable to open '" << path << "'\n";
+      return false;
+    }
+
+    std::string line;
+    for (size_t lineno = 1; std::getline(file, line); ++lineno) {
+      if (line.empty())
+        continue;
+
+      auto entry = QueryLog::parse(line);
+      if (!entry) {
+        llvm::WithColor::warning()
+            << path << ":" << lineno << ": skipping malformed entry\n";
+        continue;
+      }
+
+      out.push_back(std::move(*entry));
+    }
+
+    return true;
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  llvm::InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv,
+                              "Fit extraction cost weights to query logs\n");
+
+  std::vector<QueryLog::Entry> entries;
+  for (const std::string& input : inputs) {
+    if (!read_log(input, entries))
+      return 2;
+  }
+
+  if (entries.empty()) {
+    llvm::WithColor::error() << "no queries to fit\n";
+    return 2;
+  }
+
+  // Only opcodes that show up often enough get their own columns. The time
+  // spent on the rest is absorbed by the per-query overhead.
+  std::map<Opcode, size_t> occurrences;
+  for (const auto& entry : entries) {
+    for (const auto& [opcode, usage] : entry.usage)
+      occurrences[opcode] += 1;
+  }
+
+  std::map<Opcode, size_t> columns;
+  for (const auto& [opcode, count] : occurrences) {
+    if (count >= min_queries)
+      columns.emplace(opcode, 1 + 2 * columns.size());
+  }
+
+  // Column 0 is the per-query overhead. Every opcode then has a column for
+  // its base weight followed by one for its per-bit weight.
+  size_t dims = 1 + 2 * columns.size();
+  NNLS problem(dims);
+  std::vector<std::vector<double>> rows;
+  std::vector<double> targets;
+  uint64_t total_nodes = 0;
+
+  for (const auto& entry : entries) {
+    std::vector<double> row(dims, 0.0);
+    row[0] = 1.0;
+
+    for (const auto& [opcode, usage] : entry.usage) {
+      auto it = columns.find(opcode);
+      if (it == columns.end())
+        continue;
+
+      total_nodes += usage.count;
+      row[it->second] = static_cast<double>(usage.count);
+      row[it->second + 1] = static_cast<double>(usage.bits);
+    }
+
+    // Fit in microseconds to keep the normal equations well scaled.
+    double target = entry.duration.count() / 1e3;
+    problem.add(row, target);
+    rows.push_back(std::move(row));
+    targets.push_back(target);
+  }
+
+  std::vector<double> w = problem.solve(iterations);
+
+  // Report how well the fitted model explains the measurements.
+  double mean = 0.0;
+  for (double target : targets)
+    mean += target;
+  mean /= targets.size();
+
+  double residual = 0.0, variance = 0.0, node_time = 0.0;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    double predicted = 0.0;
+    for (size_t j = 0; j < dims; ++j)
+      predicted += rows[i][j] * w[j];
+
+    node_time += predicted - w[0];
+    residual += (targets[i] - predicted) * (targets[i] - predicted);
+    variance += (targets[i] - mean) * (targets[i] - mean);
+  }
+
+  double r2 = variance > 0.0 ? 1.0 - residual / variance : 1.0;
+  fmt::print(stderr, "queries: {}  fitted opcodes: {}  R^2: {:.3f}\n",
+             entries.size(), columns.size(), r2);
+  fmt::print(stderr, "per-query overhead: {:.3f}us\n", w[0]);
+
+  if (node_time <= 0.0) {
+    llvm::WithColor::error() << "the fitted model attributes no time to any "
+                                "operation\n";
+    return 1;
+  }
+
+  // Scale weights so that the average node within the logged queries has a
+  // cost of 1, which puts them on the same scale as the default weights.
+  double scale = total_nodes / node_time;
+
+  WeightedCostModel model;
+  for (const auto& [opcode, column] : columns) {
+    WeightedCostModel::Weight weight{w[column] * scale,
+                                     w[column + 1] * scale};
+    model.set_weight(opcode, weight);
+
+    fmt::print(stderr, "  {:<16} base: {:>10.4f}  per-bit: {:>10.4f}\n",
+               WeightedCostModel::opcode_name(opcode), weight.base,
+               weight.per_bit);
+  }
+
+  if (output == "-") {
+    model.save(std::cout);
+    return 0;
+  }
+
+  std::ofstream file(output);
+  if (!file) {
+    llvm::WithColor::error() << "unable to open '" << output << "'\n";
+    return 2;
+  }
+
+  model.save(file);
+  return 0;
+}
@@ -0,0 +1,149 @@
+// Microbenchmark for the core EGraph operations on synthetic graphs.
+//
+// This builds a random DAG of integer operations over a set of symbolic
+// constants and then times
+//   - adding every expression to an empty e-graph,
+//   - merging random pairs of e-classes and rebuilding, and
+//   - extracting every root expression,
+// reporting the best time of several runs of each.
+
+#include "caffeine/IR/EGraph.h"
+#include "caffeine/IR/Operation.h"
+#include "caffeine/IR/OperationData.h"
+#include <algorithm>
+#include <chrono>
+#include <fmt/format.h>
+#include <limits>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/InitLLVM.h>
+#include <random>
+#include <vector>
+
+using namespace caffeine;
+
+namespace cl = llvm::cl;
+
+static cl::opt<unsigned> num_nodes("nodes", cl::desc("Number of expressions"),
+                                   cl::init(100000));
+static cl::opt<unsigned> num_symbols("symbols",
+                                     cl::desc("Number of symbolic constants"),
+                                     cl::init(64));
+static cl::opt<unsigned> num_merges(
+    "merges", cl::desc("Number of merges to perform per run"), cl::init(1000));
+static cl::opt<unsigned> num_runs("runs", cl::desc("Number of runs"),
+                                  cl::init(5));
+static cl::opt<uint64_t> seed("seed", cl::desc("Random seed"), cl::init(0));
+
+namespace {
+  // An e-node for an expression along with the indices of its operands within
+  // the list of expressions. Each operation is given its own copy of the
+  // operation data, as is the case for e-nodes created by rewrite rules.
+  struct Expr {
+    std::shared_ptr<OperationData> data;
+    llvm::SmallVector<size_t, 2> operands;
+  };
+
+  std::vector<Expr> build_exprs(std::mt19937_64& rng) {
+    std::vector<Expr> exprs;
+    exprs.reserve(num_symbols + num_nodes);
+
+    for (unsigned i = 0; i < num_symbols; ++i)
+      exprs.push_back({Constant::Create(Type::int_ty(32), i)->data(), {}});
+
+    for (unsigned i = 0; i < num_nodes; ++i) {
+      std::uniform_int_distribution<size_t> pick(0, exprs.size() - 1);
+      size_t lhs = pick(rng);
+      size_t rhs = pick(rng);
+
+      Operation::Opcode opcode;
+      switch (rng() % 4) {
+      case 0:
+        opcode = Operation::Add;
+        break;
+      case 1:
+        opcode = Operation::Mul;
+        break;
+      case 2:
+        opcode = Operation::Xor;
+        break;
+      default:
+        opcode = Operation::Not;
+        break;
+      }
+
+      auto data = std::make_shared<OperationData>(opcode, Type::int_ty(32));
+      if (opcode == Operation::Not)
+        exprs.push_back({std::move(data), {lhs}});
+      else
+        exprs.push_back({std::move(data), {lhs, rhs}});
+    }
+
+    return exprs;
+  }
+
+  template <typename F>
+  double best_of(F&& func) {
+    double best = std::numeric_limits<double>::infinity();
+
+    for (unsigned run = 0; run < num_runs; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      func();
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+
+    return best;
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  llvm::InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "EGraph microbenchmark\n");
+
+  std::mt19937_64 rng{seed};
+  std::vector<Expr> exprs = build_exprs(rng);
+
+  EGraph base;
+  std::vector<size_t> ids;
+  ids.reserve(exprs.size());
+
+  double add = best_of([&] {
+    base = EGraph();
+    ids.clear();
+    for (const Expr& expr : exprs) {
+      llvm::SmallVector<size_t, 2> operands;
+      for (size_t operand : expr.operands)
+        operands.push_back(ids[operand]);
+      ids.push_back(base.add(ENode{expr.data, operands}));
+    }
+  });
+
+  std::vector<std::pair<size_t, size_t>> merges;
+  for (unsigned i = 0; i < num_merges; ++i) {
+    std::uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+    merges.emplace_back(ids[pick(rng)], ids[pick(rng)]);
+  }
+
+  double merge = best_of([&] {
+    EGraph egraph = base;
+    for (auto [lhs, rhs] : merges)
+      egraph.merge(lhs, rhs);
+    egraph.rebuild();
+  });
+
+  double extract = best_of([&] {
+    EGraph egraph = base;
+    EGraphExtractor extractor{&egraph};
+    for (size_t id : ids)
+      extractor.extract(id);
+  });
+
+  fmt::print("e-classes: {}\n", ids.size());
+  fmt::print("add:             {:10.3f} ms\n", add);
+  fmt::print("merge + rebuild: {:10.3f} ms\n", merge);
+  fmt::print("extract:         {:10.3f} ms\n", extract);
+
+  return 0;
+}